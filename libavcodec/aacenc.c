@@ -550,19 +550,182 @@ static void copy_input_samples(AACEncContext *s, const AVFrame *frame)
     }
 }
 
+/* state shared by the per-channel jobs of a frame */
+typedef struct ChannelJobs {
+    const AVFrame *frame;
+    FFPsyWindowInfo *windows;
+    uint8_t element[AAC_MAX_CHANNELS];      ///< channel element of each channel
+    uint8_t element_ch[AAC_MAX_CHANNELS];   ///< index of each channel within its element
+    int first_channel;                      ///< channel handled by job 0
+    int alloc[AAC_MAX_CHANNELS];            ///< psy bit allocation of each channel element
+    int cutoff[AAC_MAX_CHANNELS];           ///< psy cutoff left by the quantizer search
+} ChannelJobs;
+
+/**
+ * Refresh the per-thread contexts with the current encoder state. Only the
+ * fields before the scratch buffers are copied; the coders only write to
+ * the scratch buffers and to the channel element they are given.
+ */
+static void update_thread_contexts(AVCodecContext *avctx, AACEncContext *s)
+{
+    int i;
+
+    if (!s->thread_ctx)
+        return;
+    for (i = 0; i < avctx->thread_count; i++)
+        memcpy(&s->thread_ctx[i], s, offsetof(AACEncContext, afq));
+}
+
+static AACEncContext *thread_context(AACEncContext *s, int threadnr)
+{
+    return s->thread_ctx ? &s->thread_ctx[threadnr] : s;
+}
+
+/* window decision, MDCT and clipping analysis of one channel */
+static int window_and_mdct_channel(AVCodecContext *avctx, void *arg,
+                                   int channel, int threadnr)
+{
+    AACEncContext *s = thread_context(avctx->priv_data, threadnr);
+    ChannelJobs *jobs = arg;
+    const int ch   = jobs->element_ch[channel];
+    const int tag  = s->chan_map[jobs->element[channel] + 1];
+    ChannelElement *cpe = &s->cpe[jobs->element[channel]];
+    SingleChannelElement *sce = &cpe->ch[ch];
+    IndividualChannelStream *ics = &sce->ics;
+    FFPsyWindowInfo *wi = jobs->windows + channel - ch;
+    float *overlap, *samples2, *la;
+    float clip_avoidance_factor;
+    int k, w;
+
+    s->cur_channel = channel;
+    overlap  = &s->planar_samples[s->cur_channel][0];
+    samples2 = overlap + 1024;
+    la       = samples2 + (448+64);
+    if (!jobs->frame)
+        la = NULL;
+    if (tag == TYPE_LFE) {
+        wi[ch].window_type[0] = wi[ch].window_type[1] = ONLY_LONG_SEQUENCE;
+        wi[ch].window_shape   = 0;
+        wi[ch].num_windows    = 1;
+        wi[ch].grouping[0]    = 1;
+        wi[ch].clipping[0]    = 0;
+
+        /* Only the lowest 12 coefficients are used in a LFE channel.
+         * The expression below results in only the bottom 8 coefficients
+         * being used for 11.025kHz to 16kHz sample rates.
+         */
+        ics->num_swb = s->samplerate_index >= 8 ? 1 : 3;
+    } else {
+        wi[ch] = s->psy.model->window(&s->psy, samples2, la, s->cur_channel,
+                                      ics->window_sequence[0]);
+    }
+    ics->window_sequence[1] = ics->window_sequence[0];
+    ics->window_sequence[0] = wi[ch].window_type[0];
+    ics->use_kb_window[1]   = ics->use_kb_window[0];
+    ics->use_kb_window[0]   = wi[ch].window_shape;
+    ics->num_windows        = wi[ch].num_windows;
+    ics->swb_sizes          = s->psy.bands    [ics->num_windows == 8];
+    ics->num_swb            = tag == TYPE_LFE ? ics->num_swb : s->psy.num_bands[ics->num_windows == 8];
+    ics->max_sfb            = FFMIN(ics->max_sfb, ics->num_swb);
+    ics->swb_offset         = wi[ch].window_type[0] == EIGHT_SHORT_SEQUENCE ?
+                                ff_swb_offset_128 [s->samplerate_index]:
+                                ff_swb_offset_1024[s->samplerate_index];
+    ics->tns_max_bands      = wi[ch].window_type[0] == EIGHT_SHORT_SEQUENCE ?
+                                ff_tns_max_bands_128 [s->samplerate_index]:
+                                ff_tns_max_bands_1024[s->samplerate_index];
+
+    for (w = 0; w < ics->num_windows; w++)
+        ics->group_len[w] = wi[ch].grouping[w];
+
+    /* Calculate input sample maximums and evaluate clipping risk */
+    clip_avoidance_factor = 0.0f;
+    for (w = 0; w < ics->num_windows; w++) {
+        const float *wbuf = overlap + w * 128;
+        const int wlen = 2048 / ics->num_windows;
+        float max = 0;
+        int j;
+        /* mdct input is 2 * output */
+        for (j = 0; j < wlen; j++)
+            max = FFMAX(max, fabsf(wbuf[j]));
+        wi[ch].clipping[w] = max;
+    }
+    for (w = 0; w < ics->num_windows; w++) {
+        if (wi[ch].clipping[w] > CLIP_AVOIDANCE_FACTOR) {
+            ics->window_clipping[w] = 1;
+            clip_avoidance_factor = FFMAX(clip_avoidance_factor, wi[ch].clipping[w]);
+        } else {
+            ics->window_clipping[w] = 0;
+        }
+    }
+    if (clip_avoidance_factor > CLIP_AVOIDANCE_FACTOR) {
+        ics->clip_avoidance_factor = CLIP_AVOIDANCE_FACTOR / clip_avoidance_factor;
+    } else {
+        ics->clip_avoidance_factor = 1.0f;
+    }
+
+    apply_window_and_mdct(s, sce, overlap);
+
+    if (s->options.ltp && s->coder->update_ltp) {
+        s->coder->update_ltp(s, sce);
+        apply_window[sce->ics.window_sequence[0]](s->fdsp, sce, &sce->ltp_state[0]);
+        s->mdct1024.mdct_calc(&s->mdct1024, sce->lcoeffs, sce->ret_buf);
+    }
+
+    for (k = 0; k < 1024; k++) {
+        if (!(fabs(cpe->ch[ch].coeffs[k]) < 1E16)) { // Ensure headroom for energy calculation
+            av_log(avctx, AV_LOG_ERROR, "Input contains (near) NaN/+-Inf\n");
+            return AVERROR(EINVAL);
+        }
+    }
+    avoid_clipping(s, sce);
+
+    return 0;
+}
+
+static int search_channel_quantizers(AVCodecContext *avctx, void *arg,
+                                     int jobnr, int threadnr)
+{
+    AACEncContext *s = thread_context(avctx->priv_data, threadnr);
+    ChannelJobs *jobs = arg;
+    const int channel = jobs->first_channel + jobnr;
+    const int i = jobs->element[channel];
+
+    s->cur_channel = channel;
+    s->cur_type    = s->chan_map[i + 1];
+    s->psy.bitres.alloc = jobs->alloc[i];
+    s->coder->search_for_quantizers(avctx, s, &s->cpe[i].ch[jobs->element_ch[channel]],
+                                    s->lambda);
+    jobs->cutoff[channel] = s->psy.cutoff;
+
+    return 0;
+}
+
+/* run the quantizer search for channels [start, end[ */
+static void search_quantizers(AVCodecContext *avctx, AACEncContext *s,
+                              ChannelJobs *jobs, int start, int end)
+{
+    if (start >= end)
+        return;
+    update_thread_contexts(avctx, s);
+    jobs->first_channel = start;
+    avctx->execute2(avctx, search_channel_quantizers, jobs, NULL, end - start);
+    /* what the last search of a serial run would have left for psy */
+    s->psy.cutoff = jobs->cutoff[end - 1];
+}
+
 static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                             const AVFrame *frame, int *got_packet_ptr)
 {
     AACEncContext *s = avctx->priv_data;
-    float **samples = s->planar_samples, *samples2, *la, *overlap;
     ChannelElement *cpe;
     SingleChannelElement *sce;
-    IndividualChannelStream *ics;
     int i, its, ch, w, chans, tag, start_ch, ret, frame_bits;
     int target_bits, rate_bits, too_many_bits, too_few_bits;
     int ms_mode = 0, is_mode = 0, tns_mode = 0, pred_mode = 0;
     int chan_el_counter[4];
     FFPsyWindowInfo windows[AAC_MAX_CHANNELS];
+    ChannelJobs jobs = { .frame = frame, .windows = windows };
+    int job_ret[AAC_MAX_CHANNELS];
 
     /* add current frame to queue */
     if (frame) {
@@ -582,99 +745,20 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
 
     start_ch = 0;
     for (i = 0; i < s->chan_map[0]; i++) {
-        FFPsyWindowInfo* wi = windows + start_ch;
-        tag      = s->chan_map[i+1];
-        chans    = tag == TYPE_CPE ? 2 : 1;
-        cpe      = &s->cpe[i];
+        chans = s->chan_map[i+1] == TYPE_CPE ? 2 : 1;
         for (ch = 0; ch < chans; ch++) {
-            int k;
-            float clip_avoidance_factor;
-            sce = &cpe->ch[ch];
-            ics = &sce->ics;
-            s->cur_channel = start_ch + ch;
-            overlap  = &samples[s->cur_channel][0];
-            samples2 = overlap + 1024;
-            la       = samples2 + (448+64);
-            if (!frame)
-                la = NULL;
-            if (tag == TYPE_LFE) {
-                wi[ch].window_type[0] = wi[ch].window_type[1] = ONLY_LONG_SEQUENCE;
-                wi[ch].window_shape   = 0;
-                wi[ch].num_windows    = 1;
-                wi[ch].grouping[0]    = 1;
-                wi[ch].clipping[0]    = 0;
-
-                /* Only the lowest 12 coefficients are used in a LFE channel.
-                 * The expression below results in only the bottom 8 coefficients
-                 * being used for 11.025kHz to 16kHz sample rates.
-                 */
-                ics->num_swb = s->samplerate_index >= 8 ? 1 : 3;
-            } else {
-                wi[ch] = s->psy.model->window(&s->psy, samples2, la, s->cur_channel,
-                                              ics->window_sequence[0]);
-            }
-            ics->window_sequence[1] = ics->window_sequence[0];
-            ics->window_sequence[0] = wi[ch].window_type[0];
-            ics->use_kb_window[1]   = ics->use_kb_window[0];
-            ics->use_kb_window[0]   = wi[ch].window_shape;
-            ics->num_windows        = wi[ch].num_windows;
-            ics->swb_sizes          = s->psy.bands    [ics->num_windows == 8];
-            ics->num_swb            = tag == TYPE_LFE ? ics->num_swb : s->psy.num_bands[ics->num_windows == 8];
-            ics->max_sfb            = FFMIN(ics->max_sfb, ics->num_swb);
-            ics->swb_offset         = wi[ch].window_type[0] == EIGHT_SHORT_SEQUENCE ?
-                                        ff_swb_offset_128 [s->samplerate_index]:
-                                        ff_swb_offset_1024[s->samplerate_index];
-            ics->tns_max_bands      = wi[ch].window_type[0] == EIGHT_SHORT_SEQUENCE ?
-                                        ff_tns_max_bands_128 [s->samplerate_index]:
-                                        ff_tns_max_bands_1024[s->samplerate_index];
-
-            for (w = 0; w < ics->num_windows; w++)
-                ics->group_len[w] = wi[ch].grouping[w];
-
-            /* Calculate input sample maximums and evaluate clipping risk */
-            clip_avoidance_factor = 0.0f;
-            for (w = 0; w < ics->num_windows; w++) {
-                const float *wbuf = overlap + w * 128;
-                const int wlen = 2048 / ics->num_windows;
-                float max = 0;
-                int j;
-                /* mdct input is 2 * output */
-                for (j = 0; j < wlen; j++)
-                    max = FFMAX(max, fabsf(wbuf[j]));
-                wi[ch].clipping[w] = max;
-            }
-            for (w = 0; w < ics->num_windows; w++) {
-                if (wi[ch].clipping[w] > CLIP_AVOIDANCE_FACTOR) {
-                    ics->window_clipping[w] = 1;
-                    clip_avoidance_factor = FFMAX(clip_avoidance_factor, wi[ch].clipping[w]);
-                } else {
-                    ics->window_clipping[w] = 0;
-                }
-            }
-            if (clip_avoidance_factor > CLIP_AVOIDANCE_FACTOR) {
-                ics->clip_avoidance_factor = CLIP_AVOIDANCE_FACTOR / clip_avoidance_factor;
-            } else {
-                ics->clip_avoidance_factor = 1.0f;
-            }
-
-            apply_window_and_mdct(s, sce, overlap);
-
-            if (s->options.ltp && s->coder->update_ltp) {
-                s->coder->update_ltp(s, sce);
-                apply_window[sce->ics.window_sequence[0]](s->fdsp, sce, &sce->ltp_state[0]);
-                s->mdct1024.mdct_calc(&s->mdct1024, sce->lcoeffs, sce->ret_buf);
-            }
-
-            for (k = 0; k < 1024; k++) {
-                if (!(fabs(cpe->ch[ch].coeffs[k]) < 1E16)) { // Ensure headroom for energy calculation
-                    av_log(avctx, AV_LOG_ERROR, "Input contains (near) NaN/+-Inf\n");
-                    return AVERROR(EINVAL);
-                }
-            }
-            avoid_clipping(s, sce);
+            jobs.element   [start_ch + ch] = i;
+            jobs.element_ch[start_ch + ch] = ch;
         }
         start_ch += chans;
     }
+
+    update_thread_contexts(avctx, s);
+    avctx->execute2(avctx, window_and_mdct_channel, &jobs, job_ret, s->channels);
+    for (ch = 0; ch < s->channels; ch++)
+        if (job_ret[ch] < 0)
+            return job_ret[ch];
+
     if ((ret = ff_alloc_packet2(avctx, avpkt, 8192 * s->channels, 0)) < 0)
         return ret;
     frame_bits = its = 0;
@@ -686,6 +770,10 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
         start_ch = 0;
         target_bits = 0;
         memset(chan_el_counter, 0, sizeof(chan_el_counter));
+        /* Psy analysis has to run on the channel elements in order, the
+         * quantizer searches are independent and run in parallel. The
+         * first element is searched before analysing the others, as the
+         * search updates the cutoff used by the psy model. */
         for (i = 0; i < s->chan_map[0]; i++) {
             FFPsyWindowInfo* wi = windows + start_ch;
             const float *coeffs[2];
@@ -695,8 +783,6 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
             cpe->common_window = 0;
             memset(cpe->is_mask, 0, sizeof(cpe->is_mask));
             memset(cpe->ms_mask, 0, sizeof(cpe->ms_mask));
-            put_bits(&s->pb, 3, tag);
-            put_bits(&s->pb, 4, chan_el_counter[tag]++);
             for (ch = 0; ch < chans; ch++) {
                 sce = &cpe->ch[ch];
                 coeffs[ch] = sce->coeffs;
@@ -718,13 +804,30 @@ static int aac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                     * (s->lambda / (avctx->global_quality ? avctx->global_quality : 120));
                 s->psy.bitres.alloc /= chans;
             }
+            jobs.alloc[i] = s->psy.bitres.alloc;
             s->cur_type = tag;
             for (ch = 0; ch < chans; ch++) {
                 s->cur_channel = start_ch + ch;
                 if (s->options.pns && s->coder->mark_pns)
                     s->coder->mark_pns(s, avctx, &cpe->ch[ch]);
-                s->coder->search_for_quantizers(avctx, s, &cpe->ch[ch], s->lambda);
             }
+            start_ch += chans;
+            if (!i)
+                search_quantizers(avctx, s, &jobs, 0, start_ch);
+        }
+        search_quantizers(avctx, s, &jobs, s->chan_map[1] == TYPE_CPE ? 2 : 1,
+                          s->channels);
+
+        start_ch = 0;
+        for (i = 0; i < s->chan_map[0]; i++) {
+            FFPsyWindowInfo* wi = windows + start_ch;
+            tag      = s->chan_map[i+1];
+            chans    = tag == TYPE_CPE ? 2 : 1;
+            cpe      = &s->cpe[i];
+            put_bits(&s->pb, 3, tag);
+            put_bits(&s->pb, 4, chan_el_counter[tag]++);
+            s->cur_type = tag;
+            s->psy.bitres.alloc = jobs.alloc[i];
             if (chans > 1
                 && wi[0].window_type[0] == wi[1].window_type[0]
                 && wi[0].window_shape   == wi[1].window_shape) {
@@ -908,6 +1011,7 @@ static av_cold int aac_encode_end(AVCodecContext *avctx)
     av_freep(&s->buffer.samples);
     av_freep(&s->cpe);
     av_freep(&s->fdsp);
+    av_freep(&s->thread_ctx);
     ff_af_queue_close(&s->afq);
     return 0;
 }
@@ -1095,6 +1199,16 @@ static av_cold int aac_encode_init(AVCodecContext *avctx)
     if (HAVE_MIPSDSP)
         ff_aac_coder_init_mips(s);
 
+    if (avctx->active_thread_type & FF_THREAD_SLICE && avctx->thread_count > 1) {
+        s->thread_ctx = av_mallocz_array(avctx->thread_count, sizeof(*s->thread_ctx));
+        if (!s->thread_ctx)
+            return AVERROR(ENOMEM);
+        for (i = 0; i < avctx->thread_count; i++) {
+            s->thread_ctx[i].abs_pow34   = s->abs_pow34;
+            s->thread_ctx[i].quant_bands = s->quant_bands;
+        }
+    }
+
     ff_af_queue_init(avctx, &s->afq);
     ff_aac_tableinit();
 
@@ -1142,7 +1256,8 @@ AVCodec ff_aac_encoder = {
     .defaults       = aac_encode_defaults,
     .supported_samplerates = mpeg4audio_sample_rates,
     .caps_internal  = FF_CODEC_CAP_INIT_THREADSAFE | FF_CODEC_CAP_INIT_CLEANUP,
-    .capabilities   = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_DELAY,
+    .capabilities   = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_DELAY |
+                      AV_CODEC_CAP_SLICE_THREADS,
     .sample_fmts    = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_FLTP,
                                                      AV_SAMPLE_FMT_NONE },
     .priv_class     = &aacenc_class,
@@ -420,6 +420,8 @@ typedef struct AACEncContext {
     struct {
         float *samples;
     } buffer;
+
+    struct AACEncContext *thread_ctx;            ///< per-thread copies used by the channel jobs
 } AACEncContext;
 
 void ff_aac_dsp_init_x86(AACEncContext *s);
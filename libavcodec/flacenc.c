@@ -118,6 +118,8 @@ typedef struct FlacEncodeContext {
     CompressionOptions options;
     AVCodecContext *avctx;
     LPCContext lpc_ctx;
+    LPCContext *thread_lpc_ctx; ///< per-thread LPC contexts for slice threading
+    int nb_thread_lpc_ctx;
     struct AVMD5 *md5ctx;
     uint8_t *md5_buffer;
     unsigned int md5_buffer_size;
@@ -456,6 +458,27 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
     ret = ff_lpc_init(&s->lpc_ctx, avctx->frame_size,
                       s->options.max_prediction_order, FF_LPC_TYPE_LEVINSON);
+    if (ret < 0)
+        return ret;
+
+    /* Subframes are independent once the channels are decorrelated, so
+       they can be searched concurrently, each thread with its own LPC
+       scratch buffers. */
+    if (avctx->active_thread_type & FF_THREAD_SLICE &&
+        avctx->thread_count > 1 && channels > 1) {
+        int nb_threads = FFMIN(avctx->thread_count, channels);
+
+        s->thread_lpc_ctx = av_mallocz_array(nb_threads, sizeof(*s->thread_lpc_ctx));
+        if (!s->thread_lpc_ctx)
+            return AVERROR(ENOMEM);
+        for (i = 0; i < nb_threads; i++) {
+            ret = ff_lpc_init(&s->thread_lpc_ctx[i], avctx->frame_size,
+                              s->options.max_prediction_order, FF_LPC_TYPE_LEVINSON);
+            if (ret < 0)
+                return ret;
+            s->nb_thread_lpc_ctx++;
+        }
+    }
 
     ff_bswapdsp_init(&s->bdsp);
     ff_flacdsp_init(&s->flac_dsp, avctx->sample_fmt, channels,
@@ -819,7 +842,7 @@ static void encode_residual_fixed(int32_t *res, const int32_t *smp, int n,
 }
 
 
-static int encode_residual_ch(FlacEncodeContext *s, int ch)
+static int encode_residual_ch(FlacEncodeContext *s, LPCContext *lpc_ctx, int ch)
 {
     int i, n;
     int min_order, max_order, opt_order, omethod;
@@ -882,7 +905,7 @@ static int encode_residual_ch(FlacEncodeContext *s, int ch)
 
     /* LPC */
     sub->type = FLAC_SUBFRAME_LPC;
-    opt_order = ff_lpc_calc_coefs(&s->lpc_ctx, smp, n, min_order, max_order,
+    opt_order = ff_lpc_calc_coefs(lpc_ctx, smp, n, min_order, max_order,
                                   s->options.lpc_coeff_precision, coefs, shift, s->options.lpc_type,
                                   s->options.lpc_passes, omethod,
                                   MIN_LPC_SHIFT, MAX_LPC_SHIFT, 0);
@@ -1054,6 +1077,15 @@ static int count_frame_header(FlacEncodeContext *s)
 }
 
 
+static int encode_residual_job(AVCodecContext *avctx, void *arg,
+                               int ch, int threadnr)
+{
+    FlacEncodeContext *s = avctx->priv_data;
+
+    return encode_residual_ch(s, &s->thread_lpc_ctx[threadnr], ch);
+}
+
+
 static int encode_frame(FlacEncodeContext *s)
 {
     int ch;
@@ -1061,8 +1093,17 @@ static int encode_frame(FlacEncodeContext *s)
 
     count = count_frame_header(s);
 
-    for (ch = 0; ch < s->channels; ch++)
-        count += encode_residual_ch(s, ch);
+    if (s->thread_lpc_ctx) {
+        int ch_count[FLAC_MAX_CHANNELS];
+
+        s->avctx->execute2(s->avctx, encode_residual_job, NULL, ch_count,
+                           s->channels);
+        for (ch = 0; ch < s->channels; ch++)
+            count += ch_count[ch];
+    } else {
+        for (ch = 0; ch < s->channels; ch++)
+            count += encode_residual_ch(s, &s->lpc_ctx, ch);
+    }
 
     count += (8 - (count & 7)) & 7; // byte alignment
     count += 16;                    // CRC-16
@@ -1454,6 +1495,9 @@ static av_cold int flac_encode_close(AVCodecContext *avctx)
         av_freep(&s->md5ctx);
         av_freep(&s->md5_buffer);
         ff_lpc_end(&s->lpc_ctx);
+        while (s->nb_thread_lpc_ctx > 0)
+            ff_lpc_end(&s->thread_lpc_ctx[--s->nb_thread_lpc_ctx]);
+        av_freep(&s->thread_lpc_ctx);
     }
     av_freep(&avctx->extradata);
     avctx->extradata_size = 0;
@@ -1508,7 +1552,9 @@ AVCodec ff_flac_encoder = {
     .init           = flac_encode_init,
     .encode2        = flac_encode_frame,
     .close          = flac_encode_close,
-    .capabilities   = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_DELAY,
+    .capabilities   = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_DELAY |
+                      AV_CODEC_CAP_SLICE_THREADS,
+    .caps_internal  = FF_CODEC_CAP_INIT_CLEANUP,
     .sample_fmts    = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_S16,
                                                      AV_SAMPLE_FMT_S32,
                                                      AV_SAMPLE_FMT_NONE },
@@ -28,6 +28,7 @@
 #include "internal.h"
 #include "lzw.h"
 #include "gif.h"
+#include "thread.h"
 
 /* This value is intentionally set to "transparent white" color.
  * It is much better to have white background instead of black
@@ -37,7 +38,8 @@
 
 typedef struct GifState {
     const AVClass *class;
-    AVFrame *frame;
+    ThreadFrame frame;
+    ThreadFrame last_frame;
     int screen_width;
     int screen_height;
     int has_global_palette;
@@ -48,8 +50,8 @@ typedef struct GifState {
     int color_resolution;
     /* intermediate buffer for storing color indices
      * obtained from lzw-encoded data stream */
-    uint8_t *idx_line;
-    int idx_line_size;
+    uint8_t *idx_buf;
+    unsigned int idx_buf_size;
 
     /* after the frame is displayed, the disposal method is used */
     int gce_prev_disposal;
@@ -59,8 +61,7 @@ typedef struct GifState {
     /* depending on disposal method we store either part of the image
      * drawn on the canvas or background color that
      * should be used upon disposal */
-    uint32_t * stored_img;
-    int stored_img_size;
+    AVBufferRef *stored_img;
     int stored_bg_color;
 
     GetByteContext gb;
@@ -76,6 +77,26 @@ typedef struct GifState {
     int trans_color;    /**< color value that is used instead of transparent color */
 } GifState;
 
+/* One image of the stream and the disposal of the image preceding it,
+ * kept apart from GifState so that the next frame thread can start as
+ * soon as the headers are parsed. */
+typedef struct GifImage {
+    int left, top, width, height;
+    int pw;                     ///< visible width of the image
+    int is_interleaved;
+    int transparent_color_index;
+    const uint32_t *pal;
+    int nb_lines;               ///< number of lines decoded into idx_buf
+    int fill;                   ///< whether to fill the canvas with fill_color first
+    uint32_t fill_color;
+
+    int prev_disposal;
+    int prev_l, prev_t, prev_w, prev_h;
+    uint32_t prev_bg_color;
+    AVBufferRef *prev_img;      ///< area to restore for GCE_DISPOSAL_RESTORE
+    uint8_t *store;             ///< where to save the area this image covers, or NULL
+} GifImage;
+
 static void gif_read_palette(GifState *s, uint32_t *pal, int nb)
 {
     int i;
@@ -109,31 +130,22 @@ static void gif_fill_rect(AVFrame *picture, uint32_t color, int l, int t, int w,
     }
 }
 
-static void gif_copy_img_rect(const uint32_t *src, uint32_t *dst,
-                              int linesize, int l, int t, int w, int h)
+static void gif_copy_img_rect(const uint32_t *src, int src_linesize,
+                              uint32_t *dst, int dst_linesize, int w, int h)
 {
-    const int y_start = t * linesize;
-    const uint32_t *src_px,
-                   *src_py = src + y_start,
-                   *dst_py = dst + y_start;
-    const uint32_t *src_pb = src_py + h * linesize;
-    uint32_t *dst_px;
-
-    for (; src_py < src_pb; src_py += linesize, dst_py += linesize) {
-        src_px = src_py + l;
-        dst_px = (uint32_t *)dst_py + l;
-
-        memcpy(dst_px, src_px, w * sizeof(uint32_t));
-    }
+    for (; h > 0; h--, src += src_linesize, dst += dst_linesize)
+        memcpy(dst, src, w * sizeof(uint32_t));
 }
 
-static int gif_read_image(GifState *s, AVFrame *frame)
+/**
+ * Parse the image descriptor and set up the disposal of the previous image.
+ * Leaves the LZW state at the start of the image data.
+ */
+static int gif_read_image(GifState *s, GifImage *img)
 {
     int left, top, width, height, bits_per_pixel, code_size, flags, pw;
-    int is_interleaved, has_local_palette, y, pass, y1, linesize, pal_size, lzwed_len;
-    uint32_t *ptr, *pal, *px, *pr, *ptr1;
+    int has_local_palette, pal_size;
     int ret;
-    uint8_t *idx;
 
     /* At least 9 bytes of Image Descriptor. */
     if (bytestream2_get_bytes_left(&s->gb) < 9)
@@ -144,7 +156,7 @@ static int gif_read_image(GifState *s, AVFrame *frame)
     width  = bytestream2_get_le16u(&s->gb);
     height = bytestream2_get_le16u(&s->gb);
     flags  = bytestream2_get_byteu(&s->gb);
-    is_interleaved = flags & 0x40;
+    img->is_interleaved = flags & 0x40;
     has_local_palette = flags & 0x80;
     bits_per_pixel = (flags & 0x07) + 1;
 
@@ -157,24 +169,25 @@ static int gif_read_image(GifState *s, AVFrame *frame)
             return AVERROR_INVALIDDATA;
 
         gif_read_palette(s, s->local_palette, pal_size);
-        pal = s->local_palette;
+        img->pal = s->local_palette;
     } else {
         if (!s->has_global_palette) {
             av_log(s->avctx, AV_LOG_ERROR, "picture doesn't have either global or local palette.\n");
             return AVERROR_INVALIDDATA;
         }
 
-        pal = s->global_palette;
+        img->pal = s->global_palette;
     }
 
     if (s->keyframe) {
+        img->fill = 1;
         if (s->transparent_color_index == -1 && s->has_global_palette) {
             /* transparency wasn't set before the first frame, fill with background color */
-            gif_fill(frame, s->bg_color);
+            img->fill_color = s->bg_color;
         } else {
             /* otherwise fill with transparent color.
              * this is necessary since by default picture filled with 0x80808080. */
-            gif_fill(frame, s->trans_color);
+            img->fill_color = s->trans_color;
         }
     }
 
@@ -210,12 +223,22 @@ static int gif_read_image(GifState *s, AVFrame *frame)
         height = s->screen_height - top;
     }
 
+    img->left   = left;
+    img->top    = top;
+    img->width  = width;
+    img->height = height;
+    img->pw     = pw;
+    img->transparent_color_index = s->transparent_color_index;
+
     /* process disposal method */
-    if (s->gce_prev_disposal == GCE_DISPOSAL_BACKGROUND) {
-        gif_fill_rect(frame, s->stored_bg_color, s->gce_l, s->gce_t, s->gce_w, s->gce_h);
-    } else if (s->gce_prev_disposal == GCE_DISPOSAL_RESTORE) {
-        gif_copy_img_rect(s->stored_img, (uint32_t *)frame->data[0],
-            frame->linesize[0] / sizeof(uint32_t), s->gce_l, s->gce_t, s->gce_w, s->gce_h);
+    img->prev_disposal = s->gce_prev_disposal;
+    img->prev_l = s->gce_l;  img->prev_t = s->gce_t;
+    img->prev_w = s->gce_w;  img->prev_h = s->gce_h;
+    img->prev_bg_color = s->stored_bg_color;
+    if (s->gce_prev_disposal == GCE_DISPOSAL_RESTORE && s->stored_img) {
+        img->prev_img = av_buffer_ref(s->stored_img);
+        if (!img->prev_img)
+            return AVERROR(ENOMEM);
     }
 
     s->gce_prev_disposal = s->gce_disposal;
@@ -230,12 +253,13 @@ static int gif_read_image(GifState *s, AVFrame *frame)
             else
                 s->stored_bg_color = s->bg_color;
         } else if (s->gce_disposal == GCE_DISPOSAL_RESTORE) {
-            av_fast_malloc(&s->stored_img, &s->stored_img_size, frame->linesize[0] * frame->height);
+            /* the previous buffer may still be referenced by another
+             * frame thread, so always use a new one */
+            av_buffer_unref(&s->stored_img);
+            s->stored_img = av_buffer_allocz(pw * height * sizeof(uint32_t));
             if (!s->stored_img)
                 return AVERROR(ENOMEM);
-
-            gif_copy_img_rect((uint32_t *)frame->data[0], s->stored_img,
-                frame->linesize[0] / sizeof(uint32_t), left, top, pw, height);
+            img->store = s->stored_img->data;
         }
     }
 
@@ -251,28 +275,80 @@ static int gif_read_image(GifState *s, AVFrame *frame)
         return ret;
     }
 
-    /* read all the image */
-    linesize = frame->linesize[0] / sizeof(uint32_t);
-    ptr1 = (uint32_t *)frame->data[0] + top * linesize + left;
-    ptr = ptr1;
-    pass = 0;
-    y1 = 0;
-    for (y = 0; y < height; y++) {
-        int count = ff_lzw_decode(s->lzw, s->idx_line, width);
-        if (count != width) {
+    /* Graphic Control Extension's scope is single frame.
+     * Remove its influence. */
+    s->transparent_color_index = -1;
+    s->gce_disposal = GCE_DISPOSAL_NONE;
+
+    return 0;
+}
+
+/**
+ * Decode the color indices of all the visible lines of the image.
+ * This does not depend on the previous frame.
+ */
+static void gif_decode_indices(GifState *s, GifImage *img)
+{
+    uint8_t *idx = s->idx_buf;
+    int y, lzwed_len;
+
+    for (y = 0; y < img->height; y++, idx += img->width) {
+        int count = ff_lzw_decode(s->lzw, idx, img->width);
+        if (count != img->width) {
             if (count)
                 av_log(s->avctx, AV_LOG_ERROR, "LZW decode failed\n");
-            goto decode_tail;
+            break;
         }
+    }
+    img->nb_lines = y;
+
+    /* read the garbage data until end marker is found */
+    lzwed_len = ff_lzw_decode_tail(s->lzw);
+    bytestream2_skipu(&s->gb, lzwed_len);
+}
+
+/**
+ * Dispose of the previous image and draw the decoded one on the canvas.
+ */
+static void gif_draw_image(GifState *s, GifImage *img, AVFrame *frame)
+{
+    int linesize = frame->linesize[0] / sizeof(uint32_t);
+    int y, pass, y1;
+    uint32_t *ptr, *ptr1, *px, *pr;
+    const uint8_t *idx;
+
+    if (img->fill)
+        gif_fill(frame, img->fill_color);
+
+    if (img->prev_disposal == GCE_DISPOSAL_BACKGROUND) {
+        gif_fill_rect(frame, img->prev_bg_color, img->prev_l, img->prev_t, img->prev_w, img->prev_h);
+    } else if (img->prev_disposal == GCE_DISPOSAL_RESTORE && img->prev_img) {
+        gif_copy_img_rect((const uint32_t *)img->prev_img->data, img->prev_w,
+                          (uint32_t *)frame->data[0] + img->prev_t * linesize + img->prev_l,
+                          linesize, img->prev_w, img->prev_h);
+    }
 
-        pr = ptr + pw;
+    ptr1 = (uint32_t *)frame->data[0] + img->top * linesize + img->left;
 
-        for (px = ptr, idx = s->idx_line; px < pr; px++, idx++) {
-            if (*idx != s->transparent_color_index)
-                *px = pal[*idx];
+    if (img->store)
+        gif_copy_img_rect(ptr1, linesize, (uint32_t *)img->store, img->pw,
+                          img->pw, img->height);
+
+    /* draw all the decoded lines */
+    ptr = ptr1;
+    pass = 0;
+    y1 = 0;
+    for (y = 0, idx = s->idx_buf; y < img->nb_lines; y++, idx += img->width) {
+        const uint8_t *id = idx;
+
+        pr = ptr + img->pw;
+
+        for (px = ptr; px < pr; px++, id++) {
+            if (*id != img->transparent_color_index)
+                *px = img->pal[*id];
         }
 
-        if (is_interleaved) {
+        if (img->is_interleaved) {
             switch(pass) {
             default:
             case 0:
@@ -289,7 +365,7 @@ static int gif_read_image(GifState *s, AVFrame *frame)
                 ptr += linesize * 2;
                 break;
             }
-            while (y1 >= height) {
+            while (y1 >= img->height) {
                 y1  = 4 >> pass;
                 ptr = ptr1 + linesize * y1;
                 pass++;
@@ -298,18 +374,6 @@ static int gif_read_image(GifState *s, AVFrame *frame)
             ptr += linesize;
         }
     }
-
- decode_tail:
-    /* read the garbage data until end marker is found */
-    lzwed_len = ff_lzw_decode_tail(s->lzw);
-    bytestream2_skipu(&s->gb, lzwed_len);
-
-    /* Graphic Control Extension's scope is single frame.
-     * Remove its influence. */
-    s->transparent_color_index = -1;
-    s->gce_disposal = GCE_DISPOSAL_NONE;
-
-    return 0;
 }
 
 static int gif_read_extension(GifState *s)
@@ -422,7 +486,7 @@ static int gif_read_header1(GifState *s)
     return 0;
 }
 
-static int gif_parse_next_image(GifState *s, AVFrame *frame)
+static int gif_parse_next_image(GifState *s, GifImage *img)
 {
     while (bytestream2_get_bytes_left(&s->gb) > 0) {
         int code = bytestream2_get_byte(&s->gb);
@@ -432,7 +496,7 @@ static int gif_parse_next_image(GifState *s, AVFrame *frame)
 
         switch (code) {
         case GIF_IMAGE_SEPARATOR:
-            return gif_read_image(s, frame);
+            return gif_read_image(s, img);
         case GIF_EXTENSION_INTRODUCER:
             if ((ret = gif_read_extension(s)) < 0)
                 return ret;
@@ -455,8 +519,9 @@ static av_cold int gif_decode_init(AVCodecContext *avctx)
     s->avctx = avctx;
 
     avctx->pix_fmt = AV_PIX_FMT_RGB32;
-    s->frame = av_frame_alloc();
-    if (!s->frame)
+    s->frame.f      = av_frame_alloc();
+    s->last_frame.f = av_frame_alloc();
+    if (!s->frame.f || !s->last_frame.f)
         return AVERROR(ENOMEM);
     ff_lzw_decode_open(&s->lzw);
     if (!s->lzw)
@@ -467,19 +532,12 @@ static av_cold int gif_decode_init(AVCodecContext *avctx)
 static int gif_decode_frame(AVCodecContext *avctx, void *data, int *got_frame, AVPacket *avpkt)
 {
     GifState *s = avctx->priv_data;
+    GifImage img = { 0 };
+    AVFrame *frame;
     int ret;
 
     bytestream2_init(&s->gb, avpkt->data, avpkt->size);
 
-    s->frame->pts     = avpkt->pts;
-#if FF_API_PKT_PTS
-FF_DISABLE_DEPRECATION_WARNINGS
-    s->frame->pkt_pts = avpkt->pts;
-FF_ENABLE_DEPRECATION_WARNINGS
-#endif
-    s->frame->pkt_dts = avpkt->dts;
-    s->frame->pkt_duration = avpkt->duration;
-
     if (avpkt->size >= 6) {
         s->keyframe = memcmp(avpkt->data, gif87a_sig, 6) == 0 ||
                       memcmp(avpkt->data, gif89a_sig, 6) == 0;
@@ -496,49 +554,120 @@ FF_ENABLE_DEPRECATION_WARNINGS
         if ((ret = ff_set_dimensions(avctx, s->screen_width, s->screen_height)) < 0)
             return ret;
 
-        av_frame_unref(s->frame);
-        if ((ret = ff_get_buffer(avctx, s->frame, 0)) < 0)
-            return ret;
-
-        av_fast_malloc(&s->idx_line, &s->idx_line_size, s->screen_width);
-        if (!s->idx_line)
-            return AVERROR(ENOMEM);
-
-        s->frame->pict_type = AV_PICTURE_TYPE_I;
-        s->frame->key_frame = 1;
         s->keyframe_ok = 1;
     } else {
         if (!s->keyframe_ok) {
             av_log(avctx, AV_LOG_ERROR, "cannot decode frame without keyframe\n");
             return AVERROR_INVALIDDATA;
         }
+    }
 
-        if ((ret = ff_reget_buffer(avctx, s->frame, 0)) < 0)
-            return ret;
+    av_fast_malloc(&s->idx_buf, &s->idx_buf_size, (size_t)s->screen_width * s->screen_height);
+    if (!s->idx_buf)
+        return AVERROR(ENOMEM);
+
+    ret = gif_parse_next_image(s, &img);
+    if (ret < 0)
+        goto end;
 
-        s->frame->pict_type = AV_PICTURE_TYPE_P;
-        s->frame->key_frame = 0;
+    if (!s->keyframe && !s->frame.f->buf[0]) {
+        ret = AVERROR_INVALIDDATA;
+        goto end;
     }
 
-    ret = gif_parse_next_image(s, s->frame);
+    /* the previous canvas, onto which this image is drawn */
+    ff_thread_release_buffer(avctx, &s->last_frame);
+    FFSWAP(ThreadFrame, s->frame, s->last_frame);
+    if ((ret = ff_thread_get_buffer(avctx, &s->frame, AV_GET_BUFFER_FLAG_REF)) < 0)
+        goto end;
+    frame = s->frame.f;
+
+    frame->pts     = avpkt->pts;
+#if FF_API_PKT_PTS
+FF_DISABLE_DEPRECATION_WARNINGS
+    frame->pkt_pts = avpkt->pts;
+FF_ENABLE_DEPRECATION_WARNINGS
+#endif
+    frame->pkt_dts = avpkt->dts;
+    frame->pkt_duration = avpkt->duration;
+    frame->pict_type = s->keyframe ? AV_PICTURE_TYPE_I : AV_PICTURE_TYPE_P;
+    frame->key_frame = s->keyframe;
+
+    ff_thread_finish_setup(avctx);
+
+    gif_decode_indices(s, &img);
+
+    if (!s->keyframe) {
+        ff_thread_await_progress(&s->last_frame, INT_MAX, 0);
+        ret = av_frame_copy(frame, s->last_frame.f);
+    }
+    if (ret >= 0)
+        gif_draw_image(s, &img, frame);
+    ff_thread_report_progress(&s->frame, INT_MAX, 0);
     if (ret < 0)
+        goto end;
+
+    if ((ret = av_frame_ref(data, frame)) < 0)
+        goto end;
+    *got_frame = 1;
+    ret = bytestream2_tell(&s->gb);
+
+end:
+    av_buffer_unref(&img.prev_img);
+    return ret;
+}
+
+#if HAVE_THREADS
+static int gif_update_thread_context(AVCodecContext *dst, const AVCodecContext *src)
+{
+    GifState *d = dst->priv_data;
+    const GifState *s = src->priv_data;
+    int ret;
+
+    if (dst == src)
+        return 0;
+
+    d->screen_width           = s->screen_width;
+    d->screen_height          = s->screen_height;
+    d->has_global_palette     = s->has_global_palette;
+    d->bits_per_pixel         = s->bits_per_pixel;
+    d->bg_color               = s->bg_color;
+    d->background_color_index = s->background_color_index;
+    d->transparent_color_index = s->transparent_color_index;
+    d->color_resolution       = s->color_resolution;
+    d->gce_prev_disposal      = s->gce_prev_disposal;
+    d->gce_disposal           = s->gce_disposal;
+    d->gce_l = s->gce_l;  d->gce_t = s->gce_t;
+    d->gce_w = s->gce_w;  d->gce_h = s->gce_h;
+    d->stored_bg_color        = s->stored_bg_color;
+    d->keyframe_ok            = s->keyframe_ok;
+    memcpy(d->global_palette, s->global_palette, sizeof(d->global_palette));
+
+    if ((ret = av_buffer_replace(&d->stored_img, s->stored_img)) < 0)
         return ret;
 
-    if ((ret = av_frame_ref(data, s->frame)) < 0)
+    ff_thread_release_buffer(dst, &d->frame);
+    if (s->frame.f->buf[0] &&
+        (ret = ff_thread_ref_frame(&d->frame, &s->frame)) < 0)
         return ret;
-    *got_frame = 1;
 
-    return bytestream2_tell(&s->gb);
+    return 0;
 }
+#endif
 
 static av_cold int gif_decode_close(AVCodecContext *avctx)
 {
     GifState *s = avctx->priv_data;
 
     ff_lzw_decode_close(&s->lzw);
-    av_frame_free(&s->frame);
-    av_freep(&s->idx_line);
-    av_freep(&s->stored_img);
+    if (s->frame.f)
+        ff_thread_release_buffer(avctx, &s->frame);
+    if (s->last_frame.f)
+        ff_thread_release_buffer(avctx, &s->last_frame);
+    av_frame_free(&s->frame.f);
+    av_frame_free(&s->last_frame.f);
+    av_freep(&s->idx_buf);
+    av_buffer_unref(&s->stored_img);
 
     return 0;
 }
@@ -568,8 +697,10 @@ AVCodec ff_gif_decoder = {
     .init           = gif_decode_init,
     .close          = gif_decode_close,
     .decode         = gif_decode_frame,
-    .capabilities   = AV_CODEC_CAP_DR1,
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(gif_update_thread_context),
+    .capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS,
     .caps_internal  = FF_CODEC_CAP_INIT_THREADSAFE |
-                      FF_CODEC_CAP_INIT_CLEANUP,
+                      FF_CODEC_CAP_INIT_CLEANUP |
+                      FF_CODEC_CAP_ALLOCATE_PROGRESS,
     .priv_class     = &decoder_class,
 };
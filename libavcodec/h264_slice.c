@@ -2577,6 +2577,18 @@ static void er_add_slice(H264SliceContext *sl,
     }
 }
 
+static void report_decoded_rows(AVCodecContext *avctx, int mb_y)
+{
+#if HAVE_THREADS
+    H264Context *h = avctx->priv_data;
+
+    pthread_mutex_lock(&h->row_progress_mutex);
+    h->rows_decoded = mb_y;
+    pthread_cond_signal(&h->row_progress_cond);
+    pthread_mutex_unlock(&h->row_progress_mutex);
+#endif
+}
+
 static int decode_slice(struct AVCodecContext *avctx, void *arg)
 {
     H264SliceContext *sl = arg;
@@ -2596,7 +2608,7 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
 
     av_assert0(h->block_offset[15] == (4 * ((scan8[15] - scan8[0]) & 7) << h->pixel_shift) + 4 * sl->linesize * ((scan8[15] - scan8[0]) >> 3));
 
-    if (h->postpone_filter)
+    if (h->postpone_filter || h->row_pipeline)
         sl->deblocking_filter = 0;
 
     sl->is_complex = FRAME_MBAFF(h) || h->picture_structure != PICT_FRAME ||
@@ -2675,7 +2687,10 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
             if (++sl->mb_x >= h->mb_width) {
                 loop_filter(h, sl, lf_x_start, sl->mb_x);
                 sl->mb_x = lf_x_start = 0;
-                decode_finish_row(h, sl);
+                if (h->row_pipeline)
+                    report_decoded_rows(avctx, sl->mb_y + 1);
+                else
+                    decode_finish_row(h, sl);
                 ++sl->mb_y;
                 if (FIELD_OR_MBAFF_PICTURE(h)) {
                     ++sl->mb_y;
@@ -2732,7 +2747,10 @@ static int decode_slice(struct AVCodecContext *avctx, void *arg)
             if (++sl->mb_x >= h->mb_width) {
                 loop_filter(h, sl, lf_x_start, sl->mb_x);
                 sl->mb_x = lf_x_start = 0;
-                decode_finish_row(h, sl);
+                if (h->row_pipeline)
+                    report_decoded_rows(avctx, sl->mb_y + 1);
+                else
+                    decode_finish_row(h, sl);
                 ++sl->mb_y;
                 if (FIELD_OR_MBAFF_PICTURE(h)) {
                     ++sl->mb_y;
@@ -2784,6 +2802,98 @@ finish:
     return 0;
 }
 
+#if HAVE_THREADS
+static int decode_slice_rows(AVCodecContext *avctx, void *arg,
+                             int jobnr, int threadnr)
+{
+    H264Context *h = avctx->priv_data;
+    int ret = decode_slice(avctx, &h->slice_ctx[0]);
+
+    report_decoded_rows(avctx, INT_MAX);
+    return ret;
+}
+
+/**
+ * Deblock the MB rows of slice_ctx[0] while they are being decoded.
+ * Row y is filtered once row y + 1 is complete: the vertical edges of
+ * row y reach its bottom line, which row y + 1 uses for intra prediction.
+ */
+static int loop_filter_rows(AVCodecContext *avctx)
+{
+    H264Context *h = avctx->priv_data;
+    H264SliceContext *sl = &h->slice_ctx[1];
+    int mb_y, rows;
+
+    for (mb_y = sl->resync_mb_y; mb_y < h->mb_height; mb_y++) {
+        pthread_mutex_lock(&h->row_progress_mutex);
+        while ((rows = h->rows_decoded) < mb_y + 2)
+            pthread_cond_wait(&h->row_progress_cond, &h->row_progress_mutex);
+        pthread_mutex_unlock(&h->row_progress_mutex);
+        if (rows == INT_MAX)
+            break;
+
+        sl->mb_y = mb_y;
+        loop_filter(h, sl, mb_y > sl->resync_mb_y ? 0 : sl->resync_mb_x,
+                    h->mb_width);
+        decode_finish_row(h, sl);
+    }
+    h->lf_next_row = mb_y;
+
+    return 0;
+}
+
+/**
+ * Decode a lone slice with slice threads: one thread decodes the MBs with
+ * the loop filter disabled, the calling thread deblocks the completed rows.
+ */
+static int execute_row_pipeline(H264Context *h)
+{
+    H264SliceContext *sl  = &h->slice_ctx[0];
+    H264SliceContext *fsl = &h->slice_ctx[1];
+    int y_end, x_end, mb_y, ret;
+
+    fsl->linesize   = h->cur_pic_ptr->f->linesize[0];
+    fsl->uvlinesize = h->cur_pic_ptr->f->linesize[1];
+
+    ret = alloc_scratch_buffers(fsl, fsl->linesize);
+    if (ret < 0)
+        return ret;
+
+    fsl->slice_num              = sl->slice_num;
+    fsl->slice_type             = sl->slice_type;
+    fsl->list_count             = sl->list_count;
+    fsl->qscale                 = sl->qscale;
+    fsl->qp_thresh              = sl->qp_thresh;
+    fsl->deblocking_filter      = sl->deblocking_filter;
+    fsl->slice_alpha_c0_offset  = sl->slice_alpha_c0_offset;
+    fsl->slice_beta_offset      = sl->slice_beta_offset;
+    fsl->resync_mb_x            = sl->resync_mb_x;
+    fsl->resync_mb_y            = sl->resync_mb_y;
+    fsl->mb_mbaff               = 0;
+    fsl->mb_field_decoding_flag = 0;
+
+    h->rows_decoded = 0;
+    h->row_pipeline = 1;
+    ff_slice_thread_execute_with_mainfunc(h->avctx, decode_slice_rows,
+                                          loop_filter_rows, NULL, &ret, 1);
+    h->row_pipeline = 0;
+
+    /* the last rows, and a partial row at the end of a slice which was
+     * decoded successfully, are left to be filtered here */
+    y_end = FFMIN(sl->mb_y + (ret >= 0), h->mb_height);
+    x_end = (sl->mb_y >= h->mb_height) ? h->mb_width : sl->mb_x;
+    for (mb_y = h->lf_next_row; mb_y < y_end; mb_y++) {
+        fsl->mb_y = mb_y;
+        loop_filter(h, fsl, mb_y > fsl->resync_mb_y ? 0 : fsl->resync_mb_x,
+                    mb_y < sl->mb_y ? h->mb_width : x_end);
+        if (mb_y < sl->mb_y)
+            decode_finish_row(h, fsl);
+    }
+
+    return ret;
+}
+#endif
+
 /**
  * Call decode_slice() for each context.
  *
@@ -2809,6 +2919,12 @@ int ff_h264_execute_decode_slices(H264Context *h)
         h->slice_ctx[0].next_slice_idx = h->mb_width * h->mb_height;
         h->postpone_filter = 0;
 
+#if HAVE_THREADS
+        if (h->nb_slice_ctx > 1 && h->slice_ctx[0].deblocking_filter &&
+            h->picture_structure == PICT_FRAME && !FRAME_MBAFF(h))
+            ret = execute_row_pipeline(h);
+        else
+#endif
         ret = decode_slice(avctx, &h->slice_ctx[0]);
         h->mb_y = h->slice_ctx[0].mb_y;
         if (ret < 0)
@@ -277,11 +277,25 @@ int ff_h264_slice_context_init(H264Context *h, H264SliceContext *sl)
 
 static int h264_init_context(AVCodecContext *avctx, H264Context *h)
 {
-    int i;
+    int i, ret;
 
     h->avctx                 = avctx;
     h->cur_chroma_format_idc = -1;
 
+#if HAVE_THREADS
+    if (avctx->active_thread_type & FF_THREAD_SLICE) {
+        ret = pthread_mutex_init(&h->row_progress_mutex, NULL);
+        if (ret)
+            return AVERROR(ret);
+        ret = pthread_cond_init(&h->row_progress_cond, NULL);
+        if (ret) {
+            pthread_mutex_destroy(&h->row_progress_mutex);
+            return AVERROR(ret);
+        }
+        h->row_progress_inited = 1;
+    }
+#endif
+
     h->width_from_caller     = avctx->width;
     h->height_from_caller    = avctx->height;
 
@@ -356,6 +370,14 @@ static av_cold int h264_decode_end(AVCodecContext *avctx)
     ff_h264_unref_picture(h, &h->last_pic_for_ec);
     av_frame_free(&h->last_pic_for_ec.f);
 
+#if HAVE_THREADS
+    if (h->row_progress_inited) {
+        pthread_mutex_destroy(&h->row_progress_mutex);
+        pthread_cond_destroy(&h->row_progress_cond);
+        h->row_progress_inited = 0;
+    }
+#endif
+
     return 0;
 }
 
@@ -1079,7 +1101,8 @@ AVCodec ff_h264_decoder = {
                                NULL
                            },
     .caps_internal         = FF_CODEC_CAP_INIT_THREADSAFE | FF_CODEC_CAP_EXPORTS_CROPPING |
-                             FF_CODEC_CAP_ALLOCATE_PROGRESS | FF_CODEC_CAP_INIT_CLEANUP,
+                             FF_CODEC_CAP_ALLOCATE_PROGRESS | FF_CODEC_CAP_INIT_CLEANUP |
+                             FF_CODEC_CAP_SLICE_THREAD_HAS_MF,
     .flush                 = h264_decode_flush,
     .update_thread_context = ONLY_IF_THREADS_ENABLED(ff_h264_update_thread_context),
     .profiles              = NULL_IF_CONFIG_SMALL(ff_h264_profiles),
@@ -379,6 +379,19 @@ typedef struct H264Context {
      */
     int postpone_filter;
 
+    /* Set when a frame made of a single slice is decoded with slice threading.
+     * The slice is then decoded without the loop filter, and the deblocking
+     * is run by the main thread on slice_ctx[1], two MB rows behind.
+     */
+    int row_pipeline;
+    int lf_next_row;            ///< first MB row not deblocked by the filter job
+    int rows_decoded;           ///< MB rows fully decoded, INT_MAX at slice end
+#if HAVE_THREADS
+    pthread_mutex_t row_progress_mutex;
+    pthread_cond_t  row_progress_cond;
+    int row_progress_inited;
+#endif
+
     /*
      * Set to 1 when the current picture is IDR, 0 otherwise.
      */
@@ -2443,6 +2443,17 @@ static void hls_decode_neighbour(HEVCContext *s, int x_ctb, int y_ctb,
     lc->ctb_up_left_flag = ((x_ctb > 0) && (y_ctb > 0)  && (ctb_addr_in_slice-1 >= s->ps.sps->ctb_width) && (s->ps.pps->tile_id[ctb_addr_ts] == s->ps.pps->tile_id[s->ps.pps->ctb_addr_rs_to_ts[ctb_addr_rs-1 - s->ps.sps->ctb_width]]));
 }
 
+static void report_ctb_progress(HEVCContext *s, int ctb_addr_ts, int end)
+{
+#if HAVE_THREADS
+    pthread_mutex_lock(&s->ctb_progress_mutex);
+    s->ctb_decoded    = ctb_addr_ts;
+    s->ctb_decode_end = end;
+    pthread_cond_signal(&s->ctb_progress_cond);
+    pthread_mutex_unlock(&s->ctb_progress_mutex);
+#endif
+}
+
 static int hls_decode_entry(AVCodecContext *avctxt, void *isFilterThread)
 {
     HEVCContext *s  = avctxt->priv_data;
@@ -2494,16 +2505,97 @@ static int hls_decode_entry(AVCodecContext *avctxt, void *isFilterThread)
 
         ctb_addr_ts++;
         ff_hevc_save_states(s, ctb_addr_ts);
+        if (s->filter_pipeline) {
+            report_ctb_progress(s, ctb_addr_ts, 0);
+            continue;
+        }
         ff_hevc_hls_filters(s, x_ctb, y_ctb, ctb_size);
     }
 
     if (x_ctb + ctb_size >= s->ps.sps->width &&
-        y_ctb + ctb_size >= s->ps.sps->height)
+        y_ctb + ctb_size >= s->ps.sps->height && !s->filter_pipeline)
         ff_hevc_hls_filter(s, x_ctb, y_ctb, ctb_size);
 
     return ctb_addr_ts;
 }
 
+static int alloc_thread_contexts(HEVCContext *s)
+{
+    int i;
+
+    for (i = 1; i < s->threads_number; i++) {
+        HEVCLocalContext *lc;
+        HEVCContext *sc;
+
+        if (s->sList[i])
+            continue;
+        lc = av_mallocz(sizeof(*lc));
+        sc = av_malloc(sizeof(*sc));
+        if (!lc || !sc) {
+            av_free(lc);
+            av_free(sc);
+            return AVERROR(ENOMEM);
+        }
+        memcpy(sc, s, sizeof(*sc));
+        sc->HEVClc       = lc;
+        s->HEVClcList[i] = lc;
+        s->sList[i]      = sc;
+    }
+    return 0;
+}
+
+#if HAVE_THREADS
+static int hls_decode_entry_pipeline(AVCodecContext *avctxt, void *arg,
+                                     int job, int self_id)
+{
+    HEVCContext *s = avctxt->priv_data;
+    int ret = hls_decode_entry(avctxt, NULL);
+
+    report_ctb_progress(s, s->ctb_decoded, ret < 0 ? -1 : 1);
+    return ret;
+}
+
+/**
+ * Run the deblocking and SAO of the CTBs decoded by
+ * hls_decode_entry_pipeline(), in the same order as hls_decode_entry()
+ * would. The filters of a CTB only touch the CTBs above and to its left,
+ * which the following CTBs no longer read for prediction.
+ */
+static int hls_filter_entry(AVCodecContext *avctxt)
+{
+    HEVCContext *s1 = avctxt->priv_data;
+    HEVCContext *s  = s1->sList[1];
+    const HEVCSPS *sps = s->ps.sps;
+    int ctb_size    = 1 << sps->log2_ctb_size;
+    int ctb_addr_ts = s->ps.pps->ctb_addr_rs_to_ts[s->sh.slice_ctb_addr_rs];
+    int x_ctb = 0, y_ctb = 0, ctb_decoded, end;
+
+    do {
+        pthread_mutex_lock(&s1->ctb_progress_mutex);
+        while ((ctb_decoded = s1->ctb_decoded) <= ctb_addr_ts &&
+               !s1->ctb_decode_end)
+            pthread_cond_wait(&s1->ctb_progress_cond, &s1->ctb_progress_mutex);
+        end = s1->ctb_decode_end;
+        pthread_mutex_unlock(&s1->ctb_progress_mutex);
+
+        for (; ctb_addr_ts < ctb_decoded; ctb_addr_ts++) {
+            int ctb_addr_rs = s->ps.pps->ctb_addr_ts_to_rs[ctb_addr_ts];
+
+            x_ctb = (ctb_addr_rs % sps->ctb_width) << sps->log2_ctb_size;
+            y_ctb = (ctb_addr_rs / sps->ctb_width) << sps->log2_ctb_size;
+            ff_hevc_hls_filters(s, x_ctb, y_ctb, ctb_size);
+        }
+    } while (!end);
+
+    if (end > 0 &&
+        x_ctb + ctb_size >= sps->width &&
+        y_ctb + ctb_size >= sps->height)
+        ff_hevc_hls_filter(s, x_ctb, y_ctb, ctb_size);
+
+    return 0;
+}
+#endif
+
 static int hls_slice_data(HEVCContext *s)
 {
     int arg[2];
@@ -2512,6 +2604,24 @@ static int hls_slice_data(HEVCContext *s)
     arg[0] = 0;
     arg[1] = 1;
 
+#if HAVE_THREADS
+    if (s->threads_number > 1 && !s->ps.pps->tiles_enabled_flag) {
+        ret[0] = alloc_thread_contexts(s);
+        if (ret[0] < 0)
+            return ret[0];
+        memcpy(s->sList[1], s, sizeof(HEVCContext));
+        s->sList[1]->HEVClc = s->HEVClcList[1];
+
+        s->ctb_decoded     = s->ps.pps->ctb_addr_rs_to_ts[s->sh.slice_ctb_addr_rs];
+        s->ctb_decode_end  = 0;
+        s->filter_pipeline = 1;
+        ff_slice_thread_execute_with_mainfunc(s->avctx, hls_decode_entry_pipeline,
+                                              hls_filter_entry, arg, ret, 1);
+        s->filter_pipeline = 0;
+        return ret[0];
+    }
+#endif
+
     s->avctx->execute(s->avctx, hls_decode_entry, arg, ret , 1, sizeof(int));
     return ret[0];
 }
@@ -2624,14 +2734,9 @@ static int hls_slice_data_wpp(HEVCContext *s, const H2645NAL *nal)
 
     ff_alloc_entries(s->avctx, s->sh.num_entry_point_offsets + 1);
 
-    if (!s->sList[1]) {
-        for (i = 1; i < s->threads_number; i++) {
-            s->sList[i] = av_malloc(sizeof(HEVCContext));
-            memcpy(s->sList[i], s, sizeof(HEVCContext));
-            s->HEVClcList[i] = av_mallocz(sizeof(HEVCLocalContext));
-            s->sList[i]->HEVClc = s->HEVClcList[i];
-        }
-    }
+    res = alloc_thread_contexts(s);
+    if (res < 0)
+        goto error;
 
     offset = (lc->gb.index >> 3);
 
@@ -3430,6 +3535,14 @@ static av_cold int hevc_decode_free(AVCodecContext *avctx)
     av_freep(&s->HEVClcList);
     av_freep(&s->sList);
 
+#if HAVE_THREADS
+    if (s->ctb_progress_inited) {
+        pthread_mutex_destroy(&s->ctb_progress_mutex);
+        pthread_cond_destroy(&s->ctb_progress_cond);
+        s->ctb_progress_inited = 0;
+    }
+#endif
+
     ff_h2645_packet_uninit(&s->pkt);
 
     ff_hevc_reset_sei(&s->sei);
@@ -3608,6 +3721,20 @@ static av_cold int hevc_decode_init(AVCodecContext *avctx)
     else
         s->threads_type = FF_THREAD_SLICE;
 
+#if HAVE_THREADS
+    if (avctx->active_thread_type & FF_THREAD_SLICE) {
+        ret = pthread_mutex_init(&s->ctb_progress_mutex, NULL);
+        if (ret)
+            return AVERROR(ret);
+        ret = pthread_cond_init(&s->ctb_progress_cond, NULL);
+        if (ret) {
+            pthread_mutex_destroy(&s->ctb_progress_mutex);
+            return AVERROR(ret);
+        }
+        s->ctb_progress_inited = 1;
+    }
+#endif
+
     ret = hevc_init_context(avctx);
     if (ret < 0)
         return ret;
@@ -3673,7 +3800,7 @@ AVCodec ff_hevc_decoder = {
     .capabilities          = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_DELAY |
                              AV_CODEC_CAP_SLICE_THREADS | AV_CODEC_CAP_FRAME_THREADS,
     .caps_internal         = FF_CODEC_CAP_INIT_THREADSAFE | FF_CODEC_CAP_EXPORTS_CROPPING |
-                             FF_CODEC_CAP_ALLOCATE_PROGRESS,
+                             FF_CODEC_CAP_ALLOCATE_PROGRESS | FF_CODEC_CAP_SLICE_THREAD_HAS_MF,
     .profiles              = NULL_IF_CONFIG_SMALL(ff_hevc_profiles),
     .hw_configs            = (const AVCodecHWConfigInternal *const []) {
 #if CONFIG_HEVC_DXVA2_HWACCEL
@@ -28,6 +28,7 @@
 #include "libavutil/buffer.h"
 #include "libavutil/md5.h"
 #include "libavutil/mem_internal.h"
+#include "libavutil/thread.h"
 
 #include "avcodec.h"
 #include "bswapdsp.h"
@@ -557,6 +558,18 @@ typedef struct HEVCContext {
     int enable_parallel_tiles;
     atomic_int wpp_err;
 
+    /* Set when a slice segment without entry points is decoded with slice
+     * threading: the in-loop filters then run in sList[1] on the calling
+     * thread, trailing the CTB decoding. */
+    int filter_pipeline;
+    int ctb_decoded;            ///< CTBs decoded so far, in tile scan
+    int ctb_decode_end;         ///< 1 once the decoding job is done, -1 on error
+#if HAVE_THREADS
+    pthread_mutex_t ctb_progress_mutex;
+    pthread_cond_t  ctb_progress_cond;
+    int ctb_progress_inited;
+#endif
+
     const uint8_t *data;
 
     H2645Packet pkt;
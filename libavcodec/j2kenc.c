@@ -105,6 +105,11 @@ typedef struct {
    double *layer_rates;
 } Jpeg2000Tile;
 
+/* a row of code-blocks in one band, the unit of parallel tier-1 coding */
+typedef struct {
+    int tileno, compno, reslevelno, bandno, cblky;
+} Jpeg2000CblkRow;
+
 typedef struct {
     AVClass *class;
     AVCodecContext *avctx;
@@ -129,6 +134,9 @@ typedef struct {
     Jpeg2000QuantStyle  qntsty;
 
     Jpeg2000Tile *tile;
+    Jpeg2000CblkRow *cblk_rows;
+    int nb_cblk_rows;
+    int *job_ret; ///< return values of the DWT and tier-1 jobs
     int layer_rates[100];
     uint8_t compression_rate_enc; ///< Is compression done using compression ratio?
 
@@ -502,6 +510,54 @@ static int init_tiles(Jpeg2000EncoderContext *s)
     return 0;
 }
 
+static int init_cblk_rows(Jpeg2000EncoderContext *s)
+{
+    int tileno, compno, reslevelno, bandno, cblky, n, pass;
+    Jpeg2000CodingStyle *codsty = &s->codsty;
+
+    // count the rows first, then fill them in
+    for (pass = 0; pass < 2; pass++) {
+        n = 0;
+        for (tileno = 0; tileno < s->numXtiles * s->numYtiles; tileno++) {
+            for (compno = 0; compno < s->ncomponents; compno++) {
+                Jpeg2000Component *comp = s->tile[tileno].comp + compno;
+
+                for (reslevelno = 0; reslevelno < codsty->nreslevels; reslevelno++) {
+                    Jpeg2000ResLevel *reslevel = comp->reslevel + reslevelno;
+
+                    for (bandno = 0; bandno < reslevel->nbands; bandno++) {
+                        Jpeg2000Band *band = reslevel->band + bandno;
+
+                        if (band->coord[0][0] == band->coord[0][1] ||
+                            band->coord[1][0] == band->coord[1][1])
+                            continue;
+
+                        for (cblky = 0; cblky < band->prec->nb_codeblocks_height; cblky++, n++) {
+                            if (pass) {
+                                Jpeg2000CblkRow *row = s->cblk_rows + n;
+                                row->tileno     = tileno;
+                                row->compno     = compno;
+                                row->reslevelno = reslevelno;
+                                row->bandno     = bandno;
+                                row->cblky      = cblky;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        if (!pass) {
+            s->nb_cblk_rows = n;
+            s->cblk_rows    = av_malloc_array(n, sizeof(*s->cblk_rows));
+            s->job_ret      = av_malloc_array(FFMAX(n, s->numXtiles * s->numYtiles * s->ncomponents),
+                                              sizeof(*s->job_ret));
+            if (!s->cblk_rows || !s->job_ret)
+                return AVERROR(ENOMEM);
+        }
+    }
+    return 0;
+}
+
 #define COPY_FRAME(D, PIXEL)                                                                                                \
     static void copy_frame_ ##D(Jpeg2000EncoderContext *s)                                                                  \
     {                                                                                                                       \
@@ -1399,84 +1455,117 @@ static void truncpasses(Jpeg2000EncoderContext *s, Jpeg2000Tile *tile)
     }
 }
 
-static int encode_tile(Jpeg2000EncoderContext *s, Jpeg2000Tile *tile, int tileno)
+static int encode_cblk_row(Jpeg2000EncoderContext *s, const Jpeg2000CblkRow *row)
 {
-    int compno, reslevelno, bandno, ret;
-    Jpeg2000T1Context t1;
     Jpeg2000CodingStyle *codsty = &s->codsty;
-    for (compno = 0; compno < s->ncomponents; compno++){
-        Jpeg2000Component *comp = s->tile[tileno].comp + compno;
-
-        t1.stride = (1<<codsty->log2_cblk_width) + 2;
-
-        av_log(s->avctx, AV_LOG_DEBUG,"dwt\n");
-        if ((ret = ff_dwt_encode(&comp->dwt, comp->i_data)) < 0)
-            return ret;
-        av_log(s->avctx, AV_LOG_DEBUG,"after dwt -> tier1\n");
+    Jpeg2000Tile *tile = s->tile + row->tileno;
+    Jpeg2000Component *comp = tile->comp + row->compno;
+    int reslevelno = row->reslevelno, bandno = row->bandno;
+    Jpeg2000ResLevel *reslevel = comp->reslevel + reslevelno;
+    Jpeg2000Band *band = reslevel->band + bandno;
+    Jpeg2000Prec *prec = band->prec; // we support only 1 precinct per band ATM in the encoder
+    Jpeg2000T1Context t1;
+    int cblkx, cblkno, xx0, x0, xx1, y0, yy0, yy1, bandpos;
 
-        for (reslevelno = 0; reslevelno < codsty->nreslevels; reslevelno++){
-            Jpeg2000ResLevel *reslevel = comp->reslevel + reslevelno;
+    t1.stride = (1<<codsty->log2_cblk_width) + 2;
 
-            for (bandno = 0; bandno < reslevel->nbands ; bandno++){
-                Jpeg2000Band *band = reslevel->band + bandno;
-                Jpeg2000Prec *prec = band->prec; // we support only 1 precinct per band ATM in the encoder
-                int cblkx, cblky, cblkno=0, xx0, x0, xx1, y0, yy0, yy1, bandpos;
-                yy0 = bandno == 0 ? 0 : comp->reslevel[reslevelno-1].coord[1][1] - comp->reslevel[reslevelno-1].coord[1][0];
-                y0 = yy0;
-                yy1 = FFMIN(ff_jpeg2000_ceildivpow2(band->coord[1][0] + 1, band->log2_cblk_height) << band->log2_cblk_height,
-                            band->coord[1][1]) - band->coord[1][0] + yy0;
+    y0  = bandno == 0 ? 0 : comp->reslevel[reslevelno-1].coord[1][1] - comp->reslevel[reslevelno-1].coord[1][0];
+    yy0 = y0;
+    yy1 = FFMIN(ff_jpeg2000_ceildivpow2(band->coord[1][0] + 1, band->log2_cblk_height) << band->log2_cblk_height,
+                band->coord[1][1]) - band->coord[1][0] + yy0;
+    if (row->cblky) {
+        yy0 = yy1 + ((row->cblky - 1) << band->log2_cblk_height);
+        yy1 = FFMIN(yy0 + (1 << band->log2_cblk_height), band->coord[1][1] - band->coord[1][0] + y0);
+    }
 
-                if (band->coord[0][0] == band->coord[0][1] || band->coord[1][0] == band->coord[1][1])
-                    continue;
+    bandpos = bandno + (reslevelno > 0);
 
-                bandpos = bandno + (reslevelno > 0);
-
-                for (cblky = 0; cblky < prec->nb_codeblocks_height; cblky++){
-                    if (reslevelno == 0 || bandno == 1)
-                        xx0 = 0;
-                    else
-                        xx0 = comp->reslevel[reslevelno-1].coord[0][1] - comp->reslevel[reslevelno-1].coord[0][0];
-                    x0 = xx0;
-                    xx1 = FFMIN(ff_jpeg2000_ceildivpow2(band->coord[0][0] + 1, band->log2_cblk_width) << band->log2_cblk_width,
-                                band->coord[0][1]) - band->coord[0][0] + xx0;
-
-                    for (cblkx = 0; cblkx < prec->nb_codeblocks_width; cblkx++, cblkno++){
-                        int y, x;
-                        if (codsty->transform == FF_DWT53){
-                            for (y = yy0; y < yy1; y++){
-                                int *ptr = t1.data + (y-yy0)*t1.stride;
-                                for (x = xx0; x < xx1; x++){
-                                    *ptr++ = comp->i_data[(comp->coord[0][1] - comp->coord[0][0]) * y + x] * (1 << NMSEDEC_FRACBITS);
-                                }
-                            }
-                        } else{
-                            for (y = yy0; y < yy1; y++){
-                                int *ptr = t1.data + (y-yy0)*t1.stride;
-                                for (x = xx0; x < xx1; x++){
-                                    *ptr = (comp->i_data[(comp->coord[0][1] - comp->coord[0][0]) * y + x]);
-                                    *ptr = (int64_t)*ptr * (int64_t)(16384 * 65536 / band->i_stepsize) >> 15 - NMSEDEC_FRACBITS;
-                                    ptr++;
-                                }
-                            }
-                        }
-                        if (!prec->cblk[cblkno].data)
-                            prec->cblk[cblkno].data = av_malloc(1 + 8192);
-                        if (!prec->cblk[cblkno].passes)
-                            prec->cblk[cblkno].passes = av_malloc_array(JPEG2000_MAX_PASSES, sizeof (*prec->cblk[cblkno].passes));
-                        if (!prec->cblk[cblkno].data || !prec->cblk[cblkno].passes)
-                            return AVERROR(ENOMEM);
-                        encode_cblk(s, &t1, prec->cblk + cblkno, tile, xx1 - xx0, yy1 - yy0,
-                                    bandpos, codsty->nreslevels - reslevelno - 1);
-                        xx0 = xx1;
-                        xx1 = FFMIN(xx1 + (1 << band->log2_cblk_width), band->coord[0][1] - band->coord[0][0] + x0);
-                    }
-                    yy0 = yy1;
-                    yy1 = FFMIN(yy1 + (1 << band->log2_cblk_height), band->coord[1][1] - band->coord[1][0] + y0);
+    if (reslevelno == 0 || bandno == 1)
+        xx0 = 0;
+    else
+        xx0 = comp->reslevel[reslevelno-1].coord[0][1] - comp->reslevel[reslevelno-1].coord[0][0];
+    x0 = xx0;
+    xx1 = FFMIN(ff_jpeg2000_ceildivpow2(band->coord[0][0] + 1, band->log2_cblk_width) << band->log2_cblk_width,
+                band->coord[0][1]) - band->coord[0][0] + xx0;
+
+    cblkno = row->cblky * prec->nb_codeblocks_width;
+    for (cblkx = 0; cblkx < prec->nb_codeblocks_width; cblkx++, cblkno++){
+        int y, x;
+        if (codsty->transform == FF_DWT53){
+            for (y = yy0; y < yy1; y++){
+                int *ptr = t1.data + (y-yy0)*t1.stride;
+                for (x = xx0; x < xx1; x++){
+                    *ptr++ = comp->i_data[(comp->coord[0][1] - comp->coord[0][0]) * y + x] * (1 << NMSEDEC_FRACBITS);
+                }
+            }
+        } else{
+            for (y = yy0; y < yy1; y++){
+                int *ptr = t1.data + (y-yy0)*t1.stride;
+                for (x = xx0; x < xx1; x++){
+                    *ptr = (comp->i_data[(comp->coord[0][1] - comp->coord[0][0]) * y + x]);
+                    *ptr = (int64_t)*ptr * (int64_t)(16384 * 65536 / band->i_stepsize) >> 15 - NMSEDEC_FRACBITS;
+                    ptr++;
                 }
             }
         }
-        av_log(s->avctx, AV_LOG_DEBUG, "after tier1\n");
+        if (!prec->cblk[cblkno].data)
+            prec->cblk[cblkno].data = av_malloc(1 + 8192);
+        if (!prec->cblk[cblkno].passes)
+            prec->cblk[cblkno].passes = av_malloc_array(JPEG2000_MAX_PASSES, sizeof (*prec->cblk[cblkno].passes));
+        if (!prec->cblk[cblkno].data || !prec->cblk[cblkno].passes)
+            return AVERROR(ENOMEM);
+        encode_cblk(s, &t1, prec->cblk + cblkno, tile, xx1 - xx0, yy1 - yy0,
+                    bandpos, codsty->nreslevels - reslevelno - 1);
+        xx0 = xx1;
+        xx1 = FFMIN(xx1 + (1 << band->log2_cblk_width), band->coord[0][1] - band->coord[0][0] + x0);
     }
+    return 0;
+}
+
+static int dwt_job(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    Jpeg2000EncoderContext *s = avctx->priv_data;
+    Jpeg2000Component *comp = s->tile[jobnr / s->ncomponents].comp + jobnr % s->ncomponents;
+
+    return ff_dwt_encode(&comp->dwt, comp->i_data);
+}
+
+static int tier1_job(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    Jpeg2000EncoderContext *s = avctx->priv_data;
+
+    return encode_cblk_row(s, s->cblk_rows + jobnr);
+}
+
+/**
+ * Transform all tile components, then code all their code-blocks.
+ * Both steps are independent between their jobs, so they run in
+ * parallel with slice threading.
+ */
+static int encode_tier1(Jpeg2000EncoderContext *s)
+{
+    AVCodecContext *avctx = s->avctx;
+    int i, nb_jobs = s->numXtiles * s->numYtiles * s->ncomponents;
+
+    av_log(avctx, AV_LOG_DEBUG, "dwt\n");
+    avctx->execute2(avctx, dwt_job, NULL, s->job_ret, nb_jobs);
+    for (i = 0; i < nb_jobs; i++)
+        if (s->job_ret[i] < 0)
+            return s->job_ret[i];
+
+    av_log(avctx, AV_LOG_DEBUG, "after dwt -> tier1\n");
+    avctx->execute2(avctx, tier1_job, NULL, s->job_ret, s->nb_cblk_rows);
+    for (i = 0; i < s->nb_cblk_rows; i++)
+        if (s->job_ret[i] < 0)
+            return s->job_ret[i];
+    av_log(avctx, AV_LOG_DEBUG, "after tier1\n");
+
+    return 0;
+}
+
+static int encode_tile(Jpeg2000EncoderContext *s, Jpeg2000Tile *tile, int tileno)
+{
+    int ret;
 
     av_log(s->avctx, AV_LOG_DEBUG, "rate control\n");
     if (s->compression_rate_enc)
@@ -1508,6 +1597,8 @@ static void cleanup(Jpeg2000EncoderContext *s)
         av_freep(&s->tile[tileno].layer_rates);
     }
     av_freep(&s->tile);
+    av_freep(&s->cblk_rows);
+    av_freep(&s->job_ret);
 }
 
 static void reinit(Jpeg2000EncoderContext *s)
@@ -1638,6 +1729,9 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
     if ((ret = put_com(s, 0)) < 0)
         return ret;
 
+    if ((ret = encode_tier1(s)) < 0)
+        return ret;
+
     for (tileno = 0; tileno < s->numXtiles * s->numYtiles; tileno++){
         uint8_t *psotptr;
         if (!(psotptr = put_sot(s, tileno)))
@@ -1793,6 +1887,8 @@ FF_ENABLE_DEPRECATION_WARNINGS
     init_quantization(s);
     if ((ret=init_tiles(s)) < 0)
         return ret;
+    if ((ret = init_cblk_rows(s)) < 0)
+        return ret;
 
     av_log(s->avctx, AV_LOG_DEBUG, "after init\n");
 
@@ -1856,6 +1952,7 @@ AVCodec ff_jpeg2000_encoder = {
         AV_PIX_FMT_RGB48, AV_PIX_FMT_GRAY16,
         AV_PIX_FMT_NONE
     },
+    .capabilities   = AV_CODEC_CAP_SLICE_THREADS,
     .priv_class     = &j2k_class,
     .caps_internal  = FF_CODEC_CAP_INIT_CLEANUP,
 };
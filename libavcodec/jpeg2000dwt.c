@@ -25,6 +25,7 @@
  * Discrete wavelet transform
  */
 
+#include "config.h"
 #include "libavutil/avassert.h"
 #include "libavutil/common.h"
 #include "libavutil/mem.h"
@@ -38,14 +39,6 @@
 #define F_LFTG_GAMMA  0.882911075530934f
 #define F_LFTG_DELTA  0.443506852043971f
 
-/* Lifting parameters in integer format.
- * Computed as param = (float param) * (1 << 16) */
-#define I_LFTG_ALPHA  103949ll
-#define I_LFTG_BETA     3472ll
-#define I_LFTG_GAMMA   57862ll
-#define I_LFTG_DELTA   29066ll
-#define I_LFTG_K       80621ll
-#define I_LFTG_X       53274ll
 #define I_PRESHIFT 8
 
 static inline void extend53(int *p, int i0, int i1)
@@ -76,22 +69,74 @@ static inline void extend97_int(int32_t *p, int i0, int i1)
     }
 }
 
-static void sd_1d53(int *p, int i0, int i1)
+/* The forward lifting steps below work on a strip of cols adjacent columns,
+ * with consecutive samples of a column stride elements apart, so that the
+ * vertical pass can filter several columns at once instead of copying
+ * them out one by one. The horizontal pass uses stride = cols = 1. */
+static av_always_inline void lift53_strip(int *p, int i0, int i1,
+                                          ptrdiff_t stride, int cols)
 {
-    int i;
+    int i, c;
+
+    for (i = ((i0+1)>>1) - 1; i < (i1+1)>>1; i++) {
+        int *x = p + (2 * i + 1) * stride;
+        for (c = 0; c < cols; c++)
+            x[c] -= (x[c - stride] + x[c + stride]) >> 1;
+    }
+    for (i = ((i0+1)>>1); i < (i1+1)>>1; i++) {
+        int *x = p + 2 * i * stride;
+        for (c = 0; c < cols; c++)
+            x[c] += (x[c - stride] + x[c + stride] + 2) >> 2;
+    }
+}
+
+static av_always_inline void extend53_strip(int *p, int i0, int i1,
+                                            ptrdiff_t stride, int cols)
+{
+    int c;
+
+    for (c = 0; c < cols; c++) {
+        p[(i0 - 1) * stride + c] = p[(i0 + 1) * stride + c];
+        p[ i1      * stride + c] = p[(i1 - 2) * stride + c];
+        p[(i0 - 2) * stride + c] = p[(i0 + 2) * stride + c];
+        p[(i1 + 1) * stride + c] = p[(i1 - 3) * stride + c];
+    }
+}
+
+static av_always_inline void sd_1d53_strip(int *p, int i0, int i1,
+                                           ptrdiff_t stride, int cols)
+{
+    int c;
 
     if (i1 <= i0 + 1) {
         if (i0 == 1)
-            p[1] <<= 1;
+            for (c = 0; c < cols; c++)
+                p[stride + c] <<= 1;
         return;
     }
 
-    extend53(p, i0, i1);
+    extend53_strip(p, i0, i1, stride, cols);
+    lift53_strip(p, i0, i1, stride, cols);
+}
+
+static void sd_1d53(int *p, int i0, int i1)
+{
+    sd_1d53_strip(p, i0, i1, 1, 1);
+}
 
-    for (i = ((i0+1)>>1) - 1; i < (i1+1)>>1; i++)
-        p[2*i+1] -= (p[2*i] + p[2*i+2]) >> 1;
-    for (i = ((i0+1)>>1); i < (i1+1)>>1; i++)
-        p[2*i] += (p[2*i-1] + p[2*i+1] + 2) >> 2;
+/* only the first cols columns of the last strip of a band hold samples */
+static void sd_1d53_cols(const DWTDSPContext *dsp, int *p, int i0, int i1, int cols)
+{
+    if (cols == FF_DWT_STRIP_COLS && i1 > i0 + 1) {
+        extend53_strip(p, i0, i1, FF_DWT_STRIP_COLS, FF_DWT_STRIP_COLS);
+        dsp->sd_lift53(p, i0, i1);
+    } else
+        sd_1d53_strip(p, i0, i1, FF_DWT_STRIP_COLS, cols);
+}
+
+static void sd_lift53_c(int32_t *p, int i0, int i1)
+{
+    lift53_strip(p, i0, i1, FF_DWT_STRIP_COLS, FF_DWT_STRIP_COLS);
 }
 
 static void dwt_encode53(DWTContext *s, int *t)
@@ -99,6 +144,7 @@ static void dwt_encode53(DWTContext *s, int *t)
     int lev,
         w = s->linelen[s->ndeclevels-1][0];
     int *line = s->i_linebuf;
+    int *strip = s->i_stripbuf + 3 * FF_DWT_STRIP_COLS;
     line += 3;
 
     for (lev = s->ndeclevels-1; lev >= 0; lev--){
@@ -110,20 +156,23 @@ static void dwt_encode53(DWTContext *s, int *t)
         int *l;
 
         // VER_SD
-        l = line + mv;
-        for (lp = 0; lp < lh; lp++) {
-            int i, j = 0;
+        l = strip + mv * FF_DWT_STRIP_COLS;
+        for (lp = 0; lp < lh; lp += FF_DWT_STRIP_COLS) {
+            int i, j = 0, c, cols = FFMIN(FF_DWT_STRIP_COLS, lh - lp);
 
             for (i = 0; i < lv; i++)
-                l[i] = t[w*i + lp];
+                for (c = 0; c < cols; c++)
+                    l[i * FF_DWT_STRIP_COLS + c] = t[w*i + lp + c];
 
-            sd_1d53(line, mv, mv + lv);
+            sd_1d53_cols(&s->dsp, strip, mv, mv + lv, cols);
 
             // copy back and deinterleave
             for (i =   mv; i < lv; i+=2, j++)
-                t[w*j + lp] = l[i];
+                for (c = 0; c < cols; c++)
+                    t[w*j + lp + c] = l[i * FF_DWT_STRIP_COLS + c];
             for (i = 1-mv; i < lv; i+=2, j++)
-                t[w*j + lp] = l[i];
+                for (c = 0; c < cols; c++)
+                    t[w*j + lp + c] = l[i * FF_DWT_STRIP_COLS + c];
         }
 
         // HOR_SD
@@ -220,29 +269,85 @@ static void dwt_encode97_float(DWTContext *s, float *t)
     }
 }
 
-static void sd_1d97_int(int *p, int i0, int i1)
+static av_always_inline void lift97_int_strip(int *p, int i0, int i1,
+                                              ptrdiff_t stride, int cols)
 {
-    int i;
+    int i, c;
+
+    i0++; i1++;
+
+    for (i = (i0>>1) - 2; i < (i1>>1) + 1; i++) {
+        int *x = p + (2 * i + 1) * stride;
+        for (c = 0; c < cols; c++)
+            x[c] -= (I_LFTG_ALPHA * (x[c - stride] + x[c + stride]) + (1 << 15)) >> 16;
+    }
+    for (i = (i0>>1) - 1; i < (i1>>1) + 1; i++) {
+        int *x = p + 2 * i * stride;
+        for (c = 0; c < cols; c++)
+            x[c] -= (I_LFTG_BETA  * (x[c - stride] + x[c + stride]) + (1 << 15)) >> 16;
+    }
+    for (i = (i0>>1) - 1; i < (i1>>1); i++) {
+        int *x = p + (2 * i + 1) * stride;
+        for (c = 0; c < cols; c++)
+            x[c] += (I_LFTG_GAMMA * (x[c - stride] + x[c + stride]) + (1 << 15)) >> 16;
+    }
+    for (i = (i0>>1); i < (i1>>1); i++) {
+        int *x = p + 2 * i * stride;
+        for (c = 0; c < cols; c++)
+            x[c] += (I_LFTG_DELTA * (x[c - stride] + x[c + stride]) + (1 << 15)) >> 16;
+    }
+}
+
+static av_always_inline void extend97_int_strip(int *p, int i0, int i1,
+                                                ptrdiff_t stride, int cols)
+{
+    int i, c;
+
+    for (i = 1; i <= 4; i++) {
+        for (c = 0; c < cols; c++) {
+            p[(i0 - i)     * stride + c] = p[(i0 + i)     * stride + c];
+            p[(i1 + i - 1) * stride + c] = p[(i1 - i - 1) * stride + c];
+        }
+    }
+}
+
+static av_always_inline void sd_1d97_int_strip(int *p, int i0, int i1,
+                                               ptrdiff_t stride, int cols)
+{
+    int c;
 
     if (i1 <= i0 + 1) {
         if (i0 == 1)
-            p[1] = (p[1] * I_LFTG_X + (1<<14)) >> 15;
+            for (c = 0; c < cols; c++)
+                p[stride + c] = (p[stride + c] * I_LFTG_X + (1<<14)) >> 15;
         else
-            p[0] = (p[0] * I_LFTG_K + (1<<15)) >> 16;
+            for (c = 0; c < cols; c++)
+                p[c] = (p[c] * I_LFTG_K + (1<<15)) >> 16;
         return;
     }
 
-    extend97_int(p, i0, i1);
-    i0++; i1++;
+    extend97_int_strip(p, i0, i1, stride, cols);
+    lift97_int_strip(p, i0, i1, stride, cols);
+}
 
-    for (i = (i0>>1) - 2; i < (i1>>1) + 1; i++)
-        p[2 * i + 1] -= (I_LFTG_ALPHA * (p[2 * i]     + p[2 * i + 2]) + (1 << 15)) >> 16;
-    for (i = (i0>>1) - 1; i < (i1>>1) + 1; i++)
-        p[2 * i]     -= (I_LFTG_BETA  * (p[2 * i - 1] + p[2 * i + 1]) + (1 << 15)) >> 16;
-    for (i = (i0>>1) - 1; i < (i1>>1); i++)
-        p[2 * i + 1] += (I_LFTG_GAMMA * (p[2 * i]     + p[2 * i + 2]) + (1 << 15)) >> 16;
-    for (i = (i0>>1); i < (i1>>1); i++)
-        p[2 * i]     += (I_LFTG_DELTA * (p[2 * i - 1] + p[2 * i + 1]) + (1 << 15)) >> 16;
+static void sd_1d97_int(int *p, int i0, int i1)
+{
+    sd_1d97_int_strip(p, i0, i1, 1, 1);
+}
+
+/* only the first cols columns of the last strip of a band hold samples */
+static void sd_1d97_int_cols(const DWTDSPContext *dsp, int *p, int i0, int i1, int cols)
+{
+    if (cols == FF_DWT_STRIP_COLS && i1 > i0 + 1) {
+        extend97_int_strip(p, i0, i1, FF_DWT_STRIP_COLS, FF_DWT_STRIP_COLS);
+        dsp->sd_lift97_int(p, i0, i1);
+    } else
+        sd_1d97_int_strip(p, i0, i1, FF_DWT_STRIP_COLS, cols);
+}
+
+static void sd_lift97_int_c(int32_t *p, int i0, int i1)
+{
+    lift97_int_strip(p, i0, i1, FF_DWT_STRIP_COLS, FF_DWT_STRIP_COLS);
 }
 
 static void dwt_encode97_int(DWTContext *s, int *t)
@@ -252,6 +357,7 @@ static void dwt_encode97_int(DWTContext *s, int *t)
     int h = s->linelen[s->ndeclevels-1][1];
     int i;
     int *line = s->i_linebuf;
+    int *strip = s->i_stripbuf + 5 * FF_DWT_STRIP_COLS;
     line += 5;
 
     for (i = 0; i < w * h; i++)
@@ -266,20 +372,23 @@ static void dwt_encode97_int(DWTContext *s, int *t)
         int *l;
 
         // VER_SD
-        l = line + mv;
-        for (lp = 0; lp < lh; lp++) {
-            int i, j = 0;
+        l = strip + mv * FF_DWT_STRIP_COLS;
+        for (lp = 0; lp < lh; lp += FF_DWT_STRIP_COLS) {
+            int i, j = 0, c, cols = FFMIN(FF_DWT_STRIP_COLS, lh - lp);
 
             for (i = 0; i < lv; i++)
-                l[i] = t[w*i + lp];
+                for (c = 0; c < cols; c++)
+                    l[i * FF_DWT_STRIP_COLS + c] = t[w*i + lp + c];
 
-            sd_1d97_int(line, mv, mv + lv);
+            sd_1d97_int_cols(&s->dsp, strip, mv, mv + lv, cols);
 
             // copy back and deinterleave
             for (i =   mv; i < lv; i+=2, j++)
-                t[w*j + lp] = ((l[i] * I_LFTG_X) + (1 << 15)) >> 16;
+                for (c = 0; c < cols; c++)
+                    t[w*j + lp + c] = ((l[i * FF_DWT_STRIP_COLS + c] * I_LFTG_X) + (1 << 15)) >> 16;
             for (i = 1-mv; i < lv; i+=2, j++)
-                t[w*j + lp] = l[i];
+                for (c = 0; c < cols; c++)
+                    t[w*j + lp + c] = l[i * FF_DWT_STRIP_COLS + c];
         }
 
         // HOR_SD
@@ -543,6 +652,8 @@ int ff_jpeg2000_dwt_init(DWTContext *s, int border[2][2],
     s->ndeclevels = decomp_levels;
     s->type       = type;
 
+    ff_jpeg2000dwt_dsp_init(&s->dsp);
+
     for (i = 0; i < 2; i++)
         for (j = 0; j < 2; j++)
             b[i][j] = border[i][j];
@@ -583,6 +694,15 @@ int ff_dwt_encode(DWTContext *s, void *t)
     if (s->ndeclevels == 0)
         return 0;
 
+    if (s->type != FF_DWT97 && !s->i_stripbuf) {
+        int maxlen = FFMAX(s->linelen[s->ndeclevels - 1][0],
+                           s->linelen[s->ndeclevels - 1][1]);
+        s->i_stripbuf = av_mallocz_array((maxlen + 12) * FF_DWT_STRIP_COLS,
+                                         sizeof(*s->i_stripbuf));
+        if (!s->i_stripbuf)
+            return AVERROR(ENOMEM);
+    }
+
     switch(s->type){
         case FF_DWT97:
             dwt_encode97_float(s, t); break;
@@ -617,8 +737,18 @@ int ff_dwt_decode(DWTContext *s, void *t)
     return 0;
 }
 
+av_cold void ff_jpeg2000dwt_dsp_init(DWTDSPContext *c)
+{
+    c->sd_lift53     = sd_lift53_c;
+    c->sd_lift97_int = sd_lift97_int_c;
+
+    if (ARCH_X86)
+        ff_jpeg2000dwt_dsp_init_x86(c);
+}
+
 void ff_dwt_destroy(DWTContext *s)
 {
     av_freep(&s->f_linebuf);
     av_freep(&s->i_linebuf);
+    av_freep(&s->i_stripbuf);
 }
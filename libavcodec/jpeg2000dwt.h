@@ -33,6 +33,15 @@
 #define F_LFTG_K      1.230174104914001f
 #define F_LFTG_X      0.812893066115961f
 
+/* Lifting parameters in integer format.
+ * Computed as param = (float param) * (1 << 16) */
+#define I_LFTG_ALPHA  103949ll
+#define I_LFTG_BETA     3472ll
+#define I_LFTG_GAMMA   57862ll
+#define I_LFTG_DELTA   29066ll
+#define I_LFTG_K       80621ll
+#define I_LFTG_X       53274ll
+
 enum DWTType {
     FF_DWT97,
     FF_DWT53,
@@ -40,6 +49,20 @@ enum DWTType {
     FF_DWT_NB
 };
 
+/// number of columns filtered together by the forward vertical transform
+#define FF_DWT_STRIP_COLS 16
+
+typedef struct DWTDSPContext {
+    /**
+     * Forward lifting steps of the vertical transform, on FF_DWT_STRIP_COLS
+     * columns stored one row after the other. Rows i0 to i1 - 1 hold the
+     * samples, i1 > i0 + 1, and the rows around them must already hold the
+     * symmetric extension (2 rows on each side for 5/3, 4 for 9/7).
+     */
+    void (*sd_lift53)(int32_t *p, int i0, int i1);
+    void (*sd_lift97_int)(int32_t *p, int i0, int i1);
+} DWTDSPContext;
+
 typedef struct DWTContext {
     /// line lengths { horizontal, vertical } in consecutive decomposition levels
     int linelen[FF_DWT_MAX_DECLVLS][2];
@@ -48,6 +71,8 @@ typedef struct DWTContext {
     uint8_t type;                        ///< 0 for 9/7; 1 for 5/3
     int32_t *i_linebuf;                  ///< int buffer used by transform
     float   *f_linebuf;                  ///< float buffer used by transform
+    int32_t *i_stripbuf;                 ///< int buffer used by the forward vertical transform
+    DWTDSPContext dsp;
 } DWTContext;
 
 /**
@@ -65,4 +90,7 @@ int ff_dwt_decode(DWTContext *s, void *t);
 
 void ff_dwt_destroy(DWTContext *s);
 
+void ff_jpeg2000dwt_dsp_init(DWTDSPContext *c);
+void ff_jpeg2000dwt_dsp_init_x86(DWTDSPContext *c);
+
 #endif /* AVCODEC_JPEG2000DWT_H */
@@ -32,18 +32,18 @@
 
 #define LZW_MAXBITS 12
 #define LZW_SIZTABLE (1<<LZW_MAXBITS)
-#define LZW_HASH_SIZE 16411
-#define LZW_HASH_SHIFT 6
+#define LZW_HASH_BITS 14
+#define LZW_HASH_SIZE (1 << LZW_HASH_BITS)
+#define LZW_GEN_SHIFT 20 ///< keys hold the prefix code and suffix below this bit
 
 #define LZW_PREFIX_EMPTY -1
-#define LZW_PREFIX_FREE -2
 
 /** One code in hash table */
 typedef struct Code{
-    /// Hash code of prefix, LZW_PREFIX_EMPTY if empty prefix, or LZW_PREFIX_FREE if no code
-    int hash_prefix;
+    /// Table generation, prefix code and last character of the block,
+    /// only valid if the generation is the current one
+    uint32_t key;
     int code;               ///< LZW code
-    uint8_t suffix;         ///< Last character in code block
 }Code;
 
 /** LZW encode state */
@@ -51,6 +51,7 @@ typedef struct LZWEncodeState {
     int clear_code;          ///< Value of clear code
     int end_code;            ///< Value of end code
     Code tab[LZW_HASH_SIZE]; ///< Hash table
+    unsigned generation;     ///< Generation of the valid entries of tab
     int tabsize;             ///< Number of values in hash table
     int bits;                ///< Actual bits code
     int bufsize;             ///< Size of output buffer
@@ -67,42 +68,14 @@ typedef struct LZWEncodeState {
 const int ff_lzw_encode_state_size = sizeof(LZWEncodeState);
 
 /**
- * Hash function adding character
- * @param head LZW code for prefix
- * @param add Character to add
- * @return New hash value
- */
-static inline int hash(int head, const int add)
-{
-    head ^= (add << LZW_HASH_SHIFT);
-    if (head >= LZW_HASH_SIZE)
-        head -= LZW_HASH_SIZE;
-    av_assert2(head >= 0 && head < LZW_HASH_SIZE);
-    return head;
-}
-
-/**
- * Hash function calculates next hash value
- * @param head Actual hash code
- * @param offset Offset calculated by hashOffset
- * @return New hash value
- */
-static inline int hashNext(int head, const int offset)
-{
-    head -= offset;
-    if(head < 0)
-        head += LZW_HASH_SIZE;
-    return head;
-}
-
-/**
- * Hash function calculates hash offset
- * @param head Actual hash code
- * @return Hash offset
+ * Hash function for a block
+ * @param prefix LZW code for prefix
+ * @param c Last character in block
+ * @return Hash value
  */
-static inline int hashOffset(const int head)
+static inline int hash(int prefix, uint8_t c)
 {
-    return head ? LZW_HASH_SIZE - head : 1;
+    return ((uint32_t)(prefix << 8 | c) * 0x9E3779B1U) >> (32 - LZW_HASH_BITS);
 }
 
 /**
@@ -124,19 +97,19 @@ static inline void writeCode(LZWEncodeState * s, int c)
  * Find LZW code for block
  * @param s LZW state
  * @param c Last character in block
- * @param hash_prefix LZW code for prefix
- * @return LZW code for block or -1 if not found in table
+ * @param prefix LZW code for prefix
+ * @param key Set to the key of the block
+ * @return Index of the block in the table, or of the free entry to add it to
  */
-static inline int findCode(LZWEncodeState * s, uint8_t c, int hash_prefix)
+static inline int findCode(LZWEncodeState * s, uint8_t c, int prefix, uint32_t *key)
 {
-    int h = hash(FFMAX(hash_prefix, 0), c);
-    int hash_offset = hashOffset(h);
+    int h = hash(prefix, c);
 
-    while (s->tab[h].hash_prefix != LZW_PREFIX_FREE) {
-        if ((s->tab[h].suffix == c)
-            && (s->tab[h].hash_prefix == hash_prefix))
+    *key = s->generation << LZW_GEN_SHIFT | prefix << 8 | c;
+    while (s->tab[h].key >> LZW_GEN_SHIFT == s->generation) {
+        if (s->tab[h].key == *key)
             return h;
-        h = hashNext(h, hash_offset);
+        h = (h + 1) & (LZW_HASH_SIZE - 1);
     }
 
     return h;
@@ -145,15 +118,13 @@ static inline int findCode(LZWEncodeState * s, uint8_t c, int hash_prefix)
 /**
  * Add block to LZW code table
  * @param s LZW state
- * @param c Last character in block
- * @param hash_prefix LZW code for prefix
- * @param hash_code LZW code for bytes block
+ * @param h Free table entry returned by findCode()
+ * @param key Key of the block
  */
-static inline void addCode(LZWEncodeState * s, uint8_t c, int hash_prefix, int hash_code)
+static inline void addCode(LZWEncodeState * s, int h, uint32_t key)
 {
-    s->tab[hash_code].code = s->tabsize;
-    s->tab[hash_code].suffix = c;
-    s->tab[hash_code].hash_prefix = hash_prefix;
+    s->tab[h].code = s->tabsize;
+    s->tab[h].key  = key;
 
     s->tabsize++;
 
@@ -167,18 +138,13 @@ static inline void addCode(LZWEncodeState * s, uint8_t c, int hash_prefix, int h
  */
 static void clearTable(LZWEncodeState * s)
 {
-    int i, h;
-
     writeCode(s, s->clear_code);
     s->bits = 9;
-    for (i = 0; i < LZW_HASH_SIZE; i++) {
-        s->tab[i].hash_prefix = LZW_PREFIX_FREE;
-    }
-    for (i = 0; i < 256; i++) {
-        h = hash(0, i);
-        s->tab[h].code = i;
-        s->tab[h].suffix = i;
-        s->tab[h].hash_prefix = LZW_PREFIX_EMPTY;
+    /* Single characters are their own codes and are not stored, so moving
+     * to a new generation is enough to empty the table. */
+    if (++s->generation >= 1U << (32 - LZW_GEN_SHIFT)) {
+        memset(s->tab, 0, sizeof(s->tab));
+        s->generation = 1;
     }
     s->tabsize = 258;
 }
@@ -197,6 +163,7 @@ static int writtenBytes(LZWEncodeState *s){
 
 /**
  * Initialize LZW encoder. Please set s->clear_code, s->end_code and s->maxbits before run.
+ * The state must have been zeroed before its first initialization.
  * @param s LZW state
  * @param outbuf Output buffer
  * @param outsize Size of output buffer
@@ -217,6 +184,10 @@ void ff_lzw_encode_init(LZWEncodeState *s, uint8_t *outbuf, int outsize,
     s->bits = 9;
     s->mode = mode;
     s->little_endian = little_endian;
+    if (!s->generation || s->generation >= 1U << (32 - LZW_GEN_SHIFT)) {
+        memset(s->tab, 0, sizeof(s->tab));
+        s->generation = 0;
+    }
 }
 
 /**
@@ -237,15 +208,21 @@ int ff_lzw_encode(LZWEncodeState * s, const uint8_t * inbuf, int insize)
     if (s->last_code == LZW_PREFIX_EMPTY)
         clearTable(s);
 
-    for (i = 0; i < insize; i++) {
-        uint8_t c = *inbuf++;
-        int code = findCode(s, c, s->last_code);
-        if (s->tab[code].hash_prefix == LZW_PREFIX_FREE) {
+    i = 0;
+    if (s->last_code == LZW_PREFIX_EMPTY && insize > 0)
+        s->last_code = inbuf[i++];
+
+    for (; i < insize; i++) {
+        uint8_t c = inbuf[i];
+        uint32_t key;
+        int h = findCode(s, c, s->last_code, &key);
+        if (s->tab[h].key != key) {
             writeCode(s, s->last_code);
-            addCode(s, c, s->last_code, code);
-            code= hash(0, c);
+            addCode(s, h, key);
+            s->last_code = c;
+        } else {
+            s->last_code = s->tab[h].code;
         }
-        s->last_code = s->tab[code].code;
         if (s->tabsize >= s->maxcode - 1) {
             clearTable(s);
         }
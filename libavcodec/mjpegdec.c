@@ -163,6 +163,13 @@ av_cold int ff_mjpeg_decode_init(AVCodecContext *avctx)
     if (!s->pkt)
         return AVERROR(ENOMEM);
 
+    if (avctx->active_thread_type & FF_THREAD_SLICE && avctx->thread_count > 1) {
+        s->slice_ctx = av_malloc_array(avctx->thread_count, sizeof(*s->slice_ctx));
+        s->slice_ret = av_malloc_array(avctx->thread_count, sizeof(*s->slice_ret));
+        if (!s->slice_ctx || !s->slice_ret)
+            return AVERROR(ENOMEM);
+    }
+
     s->avctx = avctx;
     ff_blockdsp_init(&s->bdsp, avctx);
     ff_hpeldsp_init(&s->hdsp, avctx->flags);
@@ -1440,12 +1447,14 @@ static void shift_output(MJpegDecodeContext *s, uint8_t *ptr, int linesize)
     }
 }
 
-static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
-                             int Al, const uint8_t *mb_bitmask,
-                             int mb_bitmask_size,
-                             const AVFrame *reference)
+/* decode the MCUs [mcu_start, mcu_end[ of a scan, starting at a restart
+ * interval boundary */
+static int mjpeg_decode_scan_mcus(MJpegDecodeContext *s, int nb_components, int Ah,
+                                  int Al, const uint8_t *mb_bitmask,
+                                  const AVFrame *reference,
+                                  int mcu_start, int mcu_end)
 {
-    int i, mb_x, mb_y, chroma_h_shift, chroma_v_shift, chroma_width, chroma_height;
+    int i, mb_x, mb_y, mcu, chroma_h_shift, chroma_v_shift, chroma_width, chroma_height;
     uint8_t *data[MAX_COMPONENTS];
     const uint8_t *reference_data[MAX_COMPONENTS];
     int linesize[MAX_COMPONENTS];
@@ -1453,11 +1462,8 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
     int bytes_per_pixel = 1 + (s->bits > 8);
 
     if (mb_bitmask) {
-        if (mb_bitmask_size != (s->mb_width * s->mb_height + 7)>>3) {
-            av_log(s->avctx, AV_LOG_ERROR, "mb_bitmask_size mismatches\n");
-            return AVERROR_INVALIDDATA;
-        }
         init_get_bits(&mb_bitmask_gb, mb_bitmask, s->mb_width * s->mb_height);
+        skip_bits_long(&mb_bitmask_gb, mcu_start);
     }
 
     s->restart_count = 0;
@@ -1472,11 +1478,12 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
         data[c] = s->picture_ptr->data[c];
         reference_data[c] = reference ? reference->data[c] : NULL;
         linesize[c] = s->linesize[c];
-        s->coefs_finished[c] |= 1;
     }
 
-    for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
-        for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
+    mcu  = mcu_start;
+    mb_x = mcu_start % s->mb_width;
+    for (mb_y = mcu_start / s->mb_width; mcu < mcu_end; mb_y++, mb_x = 0) {
+        for (; mb_x < s->mb_width && mcu < mcu_end; mb_x++, mcu++) {
             const int copy_mb = mb_bitmask && !get_bits1(&mb_bitmask_gb);
 
             if (s->restart_interval && !s->restart_count)
@@ -1561,6 +1568,124 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
     return 0;
 }
 
+typedef struct ScanSliceArg {
+    int nb_components, Ah, Al;
+    const uint8_t *mb_bitmask;
+    const AVFrame *reference;
+    const int *restart_offsets;     ///< start of the restart intervals after the first one
+    int start;                      ///< bit position of the first restart interval
+    int nb_intervals;
+    int nb_mcus;
+    int nb_jobs;
+    GetBitContext end_gb;           ///< reader state after the last interval
+} ScanSliceArg;
+
+static int mjpeg_decode_scan_slice(AVCodecContext *avctx, void *arg,
+                                   int jobnr, int threadnr)
+{
+    MJpegDecodeContext *s = avctx->priv_data;
+    MJpegDecodeContext *t = &s->slice_ctx[threadnr];
+    ScanSliceArg *sa = arg;
+    const int first = (int64_t)sa->nb_intervals *  jobnr      / sa->nb_jobs;
+    const int last  = (int64_t)sa->nb_intervals * (jobnr + 1) / sa->nb_jobs;
+    int i, ret;
+
+    *t = *s;
+    skip_bits_long(&t->gb, (first ? (sa->restart_offsets[first - 1] >> 3) * 8 : sa->start) -
+                           get_bits_count(&s->gb));
+    for (i = 0; i < sa->nb_components; i++)
+        t->last_dc[i] = 4 << t->bits;
+
+    ret = mjpeg_decode_scan_mcus(t, sa->nb_components, sa->Ah, sa->Al,
+                                 sa->mb_bitmask, sa->reference,
+                                 first * s->restart_interval,
+                                 FFMIN((int64_t)last * s->restart_interval, sa->nb_mcus));
+    if (jobnr == sa->nb_jobs - 1)
+        sa->end_gb = t->gb;
+    s->slice_ret[jobnr] = ret;
+
+    return ret;
+}
+
+/**
+ * Check whether the scan can be split at its restart markers, and if so
+ * return the index of the first entry of restart_offsets that belongs to it.
+ */
+static int find_scan_restart_offsets(MJpegDecodeContext *s, int nb_intervals)
+{
+    const int start = get_bits_count(&s->gb);
+    int i, first;
+
+    if (start & 7 || s->gb.buffer != s->buffer ||
+        s->avctx->codec_id == AV_CODEC_ID_THP)
+        return -1;
+
+    for (first = 0; first < s->nb_restart_offsets; first++)
+        if ((s->restart_offsets[first] >> 3) * 8 > start)
+            break;
+    if (s->nb_restart_offsets - first < nb_intervals - 1)
+        return -1;
+
+    /* RSTn markers count modulo 8 from the start of the scan, anything else
+     * means a damaged stream, which is left to the serial error handling */
+    for (i = 0; i < nb_intervals - 1; i++)
+        if ((s->restart_offsets[first + i] & 7) != (i & 7))
+            return -1;
+
+    return first;
+}
+
+static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
+                             int Al, const uint8_t *mb_bitmask,
+                             int mb_bitmask_size,
+                             const AVFrame *reference)
+{
+    const int nb_mcus = s->mb_width * s->mb_height;
+    int i;
+
+    if (mb_bitmask) {
+        if (mb_bitmask_size != (s->mb_width * s->mb_height + 7)>>3) {
+            av_log(s->avctx, AV_LOG_ERROR, "mb_bitmask_size mismatches\n");
+            return AVERROR_INVALIDDATA;
+        }
+    }
+
+    for (i = 0; i < nb_components; i++)
+        s->coefs_finished[s->comp_index[i]] |= 1;
+
+    if (s->slice_ctx && s->restart_interval) {
+        const int nb_intervals = (nb_mcus + s->restart_interval - 1) / s->restart_interval;
+        int first;
+
+        if (nb_intervals > 1 &&
+            (first = find_scan_restart_offsets(s, nb_intervals)) >= 0) {
+            ScanSliceArg sa = {
+                .nb_components   = nb_components,
+                .Ah              = Ah,
+                .Al              = Al,
+                .mb_bitmask      = mb_bitmask,
+                .reference       = reference,
+                .restart_offsets = s->restart_offsets + first,
+                .start           = get_bits_count(&s->gb),
+                .nb_intervals    = nb_intervals,
+                .nb_mcus         = nb_mcus,
+                .nb_jobs         = FFMIN(nb_intervals, s->avctx->thread_count),
+            };
+
+            s->avctx->execute2(s->avctx, mjpeg_decode_scan_slice, &sa, NULL, sa.nb_jobs);
+
+            for (i = 0; i < sa.nb_jobs; i++)
+                if (s->slice_ret[i] < 0)
+                    return s->slice_ret[i];
+            s->gb = sa.end_gb;
+            return 0;
+        }
+    }
+
+    return mjpeg_decode_scan_mcus(s, nb_components, Ah, Al, mb_bitmask,
+                                  reference, 0, nb_mcus);
+}
+
 static int mjpeg_decode_scan_progressive_ac(MJpegDecodeContext *s, int ss,
                                             int se, int Ah, int Al)
 {
@@ -2220,6 +2345,23 @@ found:
     return val;
 }
 
+static void add_restart_offset(MJpegDecodeContext *s, ptrdiff_t offset, int n)
+{
+    int *offsets;
+
+    if (s->nb_restart_offsets < 0 || offset > INT_MAX >> 3)
+        return;
+    offsets = av_fast_realloc(s->restart_offsets, &s->restart_offsets_size,
+                              (s->nb_restart_offsets + 1) * sizeof(*offsets));
+    if (!offsets) {
+        /* fall back to decoding the scan in one piece */
+        s->nb_restart_offsets = -1;
+        return;
+    }
+    s->restart_offsets = offsets;
+    s->restart_offsets[s->nb_restart_offsets++] = offset << 3 | n;
+}
+
 int ff_mjpeg_find_marker(MJpegDecodeContext *s,
                          const uint8_t **buf_ptr, const uint8_t *buf_end,
                          const uint8_t **unescaped_buf_ptr,
@@ -2232,6 +2374,8 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
     if (!s->buffer)
         return AVERROR(ENOMEM);
 
+    s->nb_restart_offsets = 0;
+
     /* unescape buffer of SOS, use special treatment for JPEG-LS */
     if (start_code == SOS && !s->ls) {
         const uint8_t *src = *buf_ptr;
@@ -2275,6 +2419,10 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
                         copy_data_segment(1);
                         if (x)
                             break;
+                    } else if (s->slice_ctx && s->restart_interval) {
+                        /* remember where each restart interval begins, the
+                         * marker cannot be told apart from data once unescaped */
+                        add_restart_offset(s, (dst - s->buffer) + (ptr - src), x - RST0);
                     }
                 }
             }
@@ -2928,6 +3076,10 @@ av_cold int ff_mjpeg_decode_end(AVCodecContext *avctx)
     av_frame_free(&s->smv_frame);
 
     av_freep(&s->buffer);
+    av_freep(&s->slice_ctx);
+    av_freep(&s->slice_ret);
+    av_freep(&s->restart_offsets);
+    s->restart_offsets_size = 0;
     av_freep(&s->stereo3d);
     av_freep(&s->ljpeg_buffer);
     s->ljpeg_buffer_size = 0;
@@ -2984,7 +3136,7 @@ AVCodec ff_mjpeg_decoder = {
     .close          = ff_mjpeg_decode_end,
     .receive_frame  = ff_mjpeg_receive_frame,
     .flush          = decode_flush,
-    .capabilities   = AV_CODEC_CAP_DR1,
+    .capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_SLICE_THREADS,
     .max_lowres     = 3,
     .priv_class     = &mjpegdec_class,
     .profiles       = NULL_IF_CONFIG_SMALL(ff_mjpeg_profiles),
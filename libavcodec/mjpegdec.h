@@ -156,6 +156,13 @@ typedef struct MJpegDecodeContext {
     uint8_t raw_huffman_lengths[2][4][16];
     uint8_t raw_huffman_values[2][4][256];
 
+    /* restart interval slice threading */
+    struct MJpegDecodeContext *slice_ctx; ///< per-thread copies of the context
+    int *slice_ret;
+    int *restart_offsets;      ///< (offset after RSTn in the unescaped SOS buffer) << 3 | n
+    unsigned int restart_offsets_size;
+    int nb_restart_offsets;
+
     enum AVPixelFormat hwaccel_sw_pix_fmt;
     enum AVPixelFormat hwaccel_pix_fmt;
     void *hwaccel_picture_private;
@@ -379,26 +379,76 @@ static int bands_dist(OpusPsyContext *s, CeltFrame *f, float *total_dist)
     return 0;
 }
 
+typedef struct StereoSearchJobs {
+    OpusPsyContext *s;
+    CeltFrame *f;
+    int intensity_stereo[CELT_MAX_BANDS + 1];
+    int dual_stereo[CELT_MAX_BANDS + 1];
+    float dist[CELT_MAX_BANDS + 1];
+} StereoSearchJobs;
+
+/* Measure one stereo configuration on a private copy of the frame, so the
+ * candidates neither share PVQ scratch nor each other's noise seed */
+static int stereo_candidate_dist(AVCodecContext *avctx, void *arg,
+                                 int jobnr, int threadnr)
+{
+    StereoSearchJobs *jobs = arg;
+    OpusPsySearchContext *sc = &jobs->s->search[threadnr];
+    CeltFrame *f = &sc->frame;
+    /* The blocks only change between searches, the rest on every candidate */
+    const size_t state = offsetof(CeltFrame, pvq);
+
+    if (sc->gen != jobs->s->search_gen) {
+        memcpy(f, jobs->f, sizeof(*f));
+        sc->gen = jobs->s->search_gen;
+    } else {
+        memcpy((uint8_t *)f + state, (const uint8_t *)jobs->f + state,
+               sizeof(*f) - state);
+    }
+    f->pvq              = sc->pvq;
+    f->intensity_stereo = jobs->intensity_stereo[jobnr];
+    f->dual_stereo      = jobs->dual_stereo[jobnr];
+
+    return bands_dist(jobs->s, f, &jobs->dist[jobnr]);
+}
+
+static void search_stereo_candidates(OpusPsyContext *s, StereoSearchJobs *jobs,
+                                     int nb_candidates)
+{
+    /* 0 marks a context without a frame copy, so restart from 1 and drop
+     * all copies on wraparound, a stale generation must never match */
+    if (!++s->search_gen) {
+        for (int i = 0; i < s->nb_search_ctx; i++)
+            s->search[i].gen = 0;
+        s->search_gen = 1;
+    }
+    s->avctx->execute2(s->avctx, stereo_candidate_dist, jobs, NULL, nb_candidates);
+}
+
 static void celt_search_for_dual_stereo(OpusPsyContext *s, CeltFrame *f)
 {
-    float td1, td2;
+    StereoSearchJobs jobs = { .s = s, .f = f };
+    int i;
     f->dual_stereo = 0;
 
     if (s->avctx->channels < 2)
         return;
 
-    bands_dist(s, f, &td1);
-    f->dual_stereo = 1;
-    bands_dist(s, f, &td2);
+    for (i = 0; i < 2; i++) {
+        jobs.intensity_stereo[i] = f->intensity_stereo;
+        jobs.dual_stereo[i]      = i;
+    }
+    search_stereo_candidates(s, &jobs, 2);
 
-    f->dual_stereo = td2 < td1;
-    s->dual_stereo_used += td2 < td1;
+    f->dual_stereo = jobs.dist[1] < jobs.dist[0];
+    s->dual_stereo_used += jobs.dist[1] < jobs.dist[0];
 }
 
 static void celt_search_for_intensity(OpusPsyContext *s, CeltFrame *f)
 {
-    int i, best_band = CELT_MAX_BANDS - 1;
-    float dist, best_dist = FLT_MAX;
+    StereoSearchJobs jobs = { .s = s, .f = f };
+    int i, nb_candidates = 0, best_band = CELT_MAX_BANDS - 1;
+    float best_dist = FLT_MAX;
     /* TODO: fix, make some heuristic up here using the lambda value */
     float end_band = 0;
 
@@ -406,11 +456,15 @@ static void celt_search_for_intensity(OpusPsyContext *s, CeltFrame *f)
         return;
 
     for (i = f->end_band; i >= end_band; i--) {
-        f->intensity_stereo = i;
-        bands_dist(s, f, &dist);
-        if (best_dist > dist) {
-            best_dist = dist;
-            best_band = i;
+        jobs.intensity_stereo[nb_candidates] = i;
+        jobs.dual_stereo[nb_candidates++]    = f->dual_stereo;
+    }
+    search_stereo_candidates(s, &jobs, nb_candidates);
+
+    for (i = 0; i < nb_candidates; i++) {
+        if (best_dist > jobs.dist[i]) {
+            best_dist = jobs.dist[i];
+            best_band = jobs.intensity_stereo[i];
         }
     }
 
@@ -555,6 +609,21 @@ av_cold int ff_opus_psy_init(OpusPsyContext *s, AVCodecContext *avctx,
         }
     }
 
+    if (avctx->channels > 1) {
+        int nb_threads = avctx->active_thread_type & FF_THREAD_SLICE ?
+                         FFMAX(avctx->thread_count, 1) : 1;
+
+        s->search = av_mallocz_array(nb_threads, sizeof(*s->search));
+        if (!s->search) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        for (; s->nb_search_ctx < nb_threads; s->nb_search_ctx++) {
+            if ((ret = ff_celt_pvq_init(&s->search[s->nb_search_ctx].pvq, 1)) < 0)
+                goto fail;
+        }
+    }
+
     for (i = 0; i < CELT_BLOCK_NB; i++) {
         float tmp;
         const int len = OPUS_BLOCK_SIZE(i);
@@ -574,6 +643,10 @@ fail:
     av_freep(&s->inflection_points);
     av_freep(&s->dsp);
 
+    while (s->nb_search_ctx > 0)
+        ff_celt_pvq_uninit(&s->search[--s->nb_search_ctx].pvq);
+    av_freep(&s->search);
+
     for (i = 0; i < CELT_BLOCK_NB; i++) {
         ff_mdct15_uninit(&s->mdct[i]);
         av_freep(&s->window[i]);
@@ -597,6 +670,10 @@ av_cold int ff_opus_psy_end(OpusPsyContext *s)
     av_freep(&s->inflection_points);
     av_freep(&s->dsp);
 
+    while (s->nb_search_ctx > 0)
+        ff_celt_pvq_uninit(&s->search[--s->nb_search_ctx].pvq);
+    av_freep(&s->search);
+
     for (i = 0; i < CELT_BLOCK_NB; i++) {
         ff_mdct15_uninit(&s->mdct[i]);
         av_freep(&s->window[i]);
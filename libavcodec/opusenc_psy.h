@@ -53,6 +53,13 @@ typedef struct PsyChain {
     int end;
 } PsyChain;
 
+/* Private state of a thread running the stereo decision searches */
+typedef struct OpusPsySearchContext {
+    CeltFrame frame;    /* Copy of the frame being analysed */
+    CeltPVQ *pvq;       /* PVQ scratch buffers */
+    unsigned gen;       /* Search the frame copy was made for, 0 for none */
+} OpusPsySearchContext;
+
 typedef struct OpusPsyContext {
     AVCodecContext *avctx;
     AVFloatDSPContext *dsp;
@@ -75,6 +82,10 @@ typedef struct OpusPsyContext {
 
     DECLARE_ALIGNED(32, float, scratch)[2048];
 
+    OpusPsySearchContext *search;
+    int nb_search_ctx;
+    unsigned search_gen;
+
     /* Stats */
     float rc_waste;
     float avg_is_band;
@@ -121,9 +121,14 @@ static int thread_execute2(AVCodecContext *avctx, action_func2* func2, void *arg
 int ff_slice_thread_execute_with_mainfunc(AVCodecContext *avctx, action_func2* func2, main_func *mainfunc, void *arg, int *ret, int job_count)
 {
     SliceThreadContext *c = avctx->internal->thread_ctx;
+    int err;
+
     c->func2 = func2;
     c->mainfunc = mainfunc;
-    return thread_execute(avctx, NULL, arg, ret, job_count, 0);
+    err = thread_execute(avctx, NULL, arg, ret, job_count, 0);
+    /* later plain execute() calls must run their jobs on this thread too */
+    c->mainfunc = NULL;
+    return err;
 }
 
 int ff_slice_thread_init(AVCodecContext *avctx)
@@ -495,13 +495,19 @@ av_cold int ff_snow_common_init(AVCodecContext *avctx){
     width= s->avctx->width;
     height= s->avctx->height;
 
+    s->nb_threads = avctx->active_thread_type & FF_THREAD_SLICE ? avctx->thread_count : 1;
+
     if (!FF_ALLOCZ_TYPED_ARRAY(s->spatial_idwt_buffer, width * height) ||
         !FF_ALLOCZ_TYPED_ARRAY(s->spatial_dwt_buffer,  width * height) ||  //FIXME this does not belong here
-        !FF_ALLOCZ_TYPED_ARRAY(s->temp_dwt_buffer,     width)          ||
-        !FF_ALLOCZ_TYPED_ARRAY(s->temp_idwt_buffer,    width)          ||
+        !FF_ALLOCZ_TYPED_ARRAY(s->temp_dwt_buffer,     width * s->nb_threads) ||
+        !FF_ALLOCZ_TYPED_ARRAY(s->temp_idwt_buffer,    width * s->nb_threads) ||
         !FF_ALLOCZ_TYPED_ARRAY(s->run_buffer, ((width + 1) >> 1) * ((height + 1) >> 1)))
         return AVERROR(ENOMEM);
 
+    if (s->nb_threads > 1 && av_codec_is_decoder(avctx->codec) &&
+        !FF_ALLOCZ_TYPED_ARRAY(s->frame_sb.line, height))
+        return AVERROR(ENOMEM);
+
     for(i=0; i<MAX_REF_FRAMES; i++) {
         s->last_picture[i] = av_frame_alloc();
         if (!s->last_picture[i])
@@ -528,7 +534,8 @@ int ff_snow_common_init_after_header(AVCodecContext *avctx) {
                                  AV_GET_BUFFER_FLAG_REF)) < 0)
             return ret;
         emu_buf_size = FFMAX(s->mconly_picture->linesize[0], 2*avctx->width+256) * (2 * MB_SIZE + HTAPS_MAX - 1);
-        if (!FF_ALLOCZ_TYPED_ARRAY(s->scratchbuf,      FFMAX(s->mconly_picture->linesize[0], 2*avctx->width+256) * 7 * MB_SIZE) ||
+        s->scratchbuf_size = FFMAX(s->mconly_picture->linesize[0], 2*avctx->width+256) * 7 * MB_SIZE;
+        if (!FF_ALLOCZ_TYPED_ARRAY(s->scratchbuf,      s->scratchbuf_size * s->nb_threads) ||
             !FF_ALLOCZ_TYPED_ARRAY(s->emu_edge_buffer, emu_buf_size))
             return AVERROR(ENOMEM);
     }
@@ -696,6 +703,161 @@ int ff_snow_frame_start(SnowContext *s){
     return 0;
 }
 
+typedef struct SnowDWTJob {
+    DWTELEM  *buffer;
+    IDWTELEM *ibuffer;
+    int width, height, stride;
+    int nb_jobs;
+} SnowDWTJob;
+
+static void job_range(int size, int align, int jobnr, int nb_jobs,
+                      int *start, int *end)
+{
+    *start = jobnr                ? (size * jobnr       / nb_jobs) & ~(align - 1) : 0;
+    *end   = jobnr + 1 != nb_jobs ? (size * (jobnr + 1) / nb_jobs) & ~(align - 1) : size;
+}
+
+static int dwt_horizontal_job(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    SnowContext *s = avctx->priv_data;
+    SnowDWTJob *job = arg;
+    int start, end;
+
+    job_range(job->height, 1, jobnr, job->nb_jobs, &start, &end);
+    ff_spatial_dwt_horizontal(job->buffer, s->temp_dwt_buffer + threadnr * avctx->width,
+                              job->width, job->stride, s->spatial_decomposition_type,
+                              start, end);
+    return 0;
+}
+
+static int dwt_vertical_job(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    SnowContext *s = avctx->priv_data;
+    SnowDWTJob *job = arg;
+    int start, end;
+
+    job_range(job->width, 8, jobnr, job->nb_jobs, &start, &end);
+    ff_spatial_dwt_vertical(job->buffer, job->height, job->stride,
+                            s->spatial_decomposition_type, start, end);
+    return 0;
+}
+
+static int idwt_vertical_job(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    SnowContext *s = avctx->priv_data;
+    SnowDWTJob *job = arg;
+    int start, end;
+
+    job_range(job->width, 16, jobnr, job->nb_jobs, &start, &end);
+    ff_spatial_idwt_vertical(job->ibuffer, job->height, job->stride,
+                             s->spatial_decomposition_type, start, end);
+    return 0;
+}
+
+static int idwt_horizontal_job(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    SnowContext *s = avctx->priv_data;
+    SnowDWTJob *job = arg;
+    int start, end;
+
+    job_range(job->height, 1, jobnr, job->nb_jobs, &start, &end);
+    ff_spatial_idwt_horizontal(job->ibuffer, s->temp_idwt_buffer + threadnr * avctx->width,
+                               job->width, job->stride, s->spatial_decomposition_type,
+                               start, end);
+    return 0;
+}
+
+void ff_snow_spatial_dwt(SnowContext *s, DWTELEM *buffer, int width, int height, int stride)
+{
+    AVCodecContext *avctx = s->avctx;
+    SnowDWTJob job = { .buffer = buffer };
+    int level;
+
+    if (s->nb_threads <= 1) {
+        ff_spatial_dwt(buffer, s->temp_dwt_buffer, width, height, stride,
+                       s->spatial_decomposition_type, s->spatial_decomposition_count);
+        return;
+    }
+
+    for (level = 0; level < s->spatial_decomposition_count; level++) {
+        job.width  = width  >> level;
+        job.height = height >> level;
+        job.stride = stride << level;
+
+        job.nb_jobs = FFMIN(s->nb_threads, job.height);
+        avctx->execute2(avctx, dwt_horizontal_job, &job, NULL, job.nb_jobs);
+        job.nb_jobs = FFMIN(s->nb_threads, (job.width + 7) >> 3);
+        avctx->execute2(avctx, dwt_vertical_job, &job, NULL, job.nb_jobs);
+    }
+}
+
+void ff_snow_spatial_idwt(SnowContext *s, IDWTELEM *buffer, int width, int height, int stride)
+{
+    AVCodecContext *avctx = s->avctx;
+    SnowDWTJob job = { .ibuffer = buffer };
+    int level;
+
+    if (s->nb_threads <= 1) {
+        ff_spatial_idwt(buffer, s->temp_idwt_buffer, width, height, stride,
+                        s->spatial_decomposition_type, s->spatial_decomposition_count);
+        return;
+    }
+
+    for (level = s->spatial_decomposition_count - 1; level >= 0; level--) {
+        job.width  = width  >> level;
+        job.height = height >> level;
+        job.stride = stride << level;
+
+        job.nb_jobs = FFMIN(s->nb_threads, (job.width + 15) >> 4);
+        avctx->execute2(avctx, idwt_vertical_job, &job, NULL, job.nb_jobs);
+        job.nb_jobs = FFMIN(s->nb_threads, job.height);
+        avctx->execute2(avctx, idwt_horizontal_job, &job, NULL, job.nb_jobs);
+    }
+}
+
+typedef struct SnowPredictJob {
+    IDWTELEM *buf;
+    int plane_index;
+    int add;
+    int nb_jobs;
+} SnowPredictJob;
+
+static int predict_plane_job(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    SnowContext *s = avctx->priv_data;
+    SnowPredictJob *job = arg;
+    uint8_t *tmp = s->scratchbuf + threadnr * s->scratchbuf_size;
+    int mb_y, start, end;
+
+    // every block row only writes its own lines, there are mb_h + 1 of them
+    job_range((s->b_height << s->block_max_depth) + 1, 1, jobnr, job->nb_jobs, &start, &end);
+    for (mb_y = start; mb_y < end; mb_y++) {
+        if (job->add)
+            predict_slice(s, tmp, job->buf, job->plane_index, 1, mb_y);
+        else
+            predict_slice(s, tmp, job->buf, job->plane_index, 0, mb_y);
+    }
+    return 0;
+}
+
+void ff_snow_predict_plane(SnowContext *s, IDWTELEM *buf, int plane_index, int add)
+{
+    const int mb_h = s->b_height << s->block_max_depth;
+    SnowPredictJob job = {
+        .buf         = buf,
+        .plane_index = plane_index,
+        .add         = add,
+        .nb_jobs     = FFMIN(s->nb_threads, mb_h + 1),
+    };
+
+    if (s->nb_threads <= 1) {
+        predict_plane(s, buf, plane_index, add);
+        return;
+    }
+
+    s->avctx->execute2(s->avctx, predict_plane_job, &job, NULL, job.nb_jobs);
+}
+
 av_cold void ff_snow_common_end(SnowContext *s)
 {
     int plane_index, level, orientation, i;
@@ -705,6 +867,7 @@ av_cold void ff_snow_common_end(SnowContext *s)
     av_freep(&s->spatial_idwt_buffer);
     av_freep(&s->temp_idwt_buffer);
     av_freep(&s->run_buffer);
+    av_freep(&s->frame_sb.line);
 
     s->m.me.temp= NULL;
     av_freep(&s->m.me.scratchpad);
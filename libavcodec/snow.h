@@ -183,8 +183,12 @@ typedef struct SnowContext{
     MpegEncContext m; // needed for motion estimation, should not be used for anything else, the idea is to eventually make the motion estimation independent of MpegEncContext, so this will be removed then (FIXME/XXX)
 
     uint8_t *scratchbuf;
+    int scratchbuf_size;    ///< size of the scratchbuf part owned by each slice thread
     uint8_t *emu_edge_buffer;
 
+    int nb_threads;         ///< number of slice threads the DWT and OBMC are split over
+    slice_buffer frame_sb;  ///< maps every line onto spatial_idwt_buffer, for threaded decoding
+
     AVMotionVector *avmv;
     int avmv_index;
     uint64_t encoding_error[AV_NUM_DATA_POINTERS];
@@ -248,6 +252,9 @@ void ff_snow_pred_block(SnowContext *s, uint8_t *dst, uint8_t *tmp, ptrdiff_t st
                      int sx, int sy, int b_w, int b_h, const BlockNode *block,
                      int plane_index, int w, int h);
 int ff_snow_get_buffer(SnowContext *s, AVFrame *frame);
+void ff_snow_spatial_dwt(SnowContext *s, DWTELEM *buffer, int width, int height, int stride);
+void ff_snow_spatial_idwt(SnowContext *s, IDWTELEM *buffer, int width, int height, int stride);
+void ff_snow_predict_plane(SnowContext *s, IDWTELEM *buf, int plane_index, int add);
 /* common inline functions */
 //XXX doublecheck all of them should stay inlined
 
@@ -277,7 +284,7 @@ static av_always_inline int same_block(BlockNode *a, BlockNode *b){
 
 //FIXME name cleanup (b_w, block_w, b_width stuff)
 //XXX should we really inline it?
-static av_always_inline void add_yblock(SnowContext *s, int sliced, slice_buffer *sb, IDWTELEM *dst, uint8_t *dst8, const uint8_t *obmc, int src_x, int src_y, int b_w, int b_h, int w, int h, int dst_stride, int src_stride, int obmc_stride, int b_x, int b_y, int add, int offset_dst, int plane_index){
+static av_always_inline void add_yblock(SnowContext *s, uint8_t *tmp, int sliced, slice_buffer *sb, IDWTELEM *dst, uint8_t *dst8, const uint8_t *obmc, int src_x, int src_y, int b_w, int b_h, int w, int h, int dst_stride, int src_stride, int obmc_stride, int b_x, int b_y, int add, int offset_dst, int plane_index){
     const int b_width = s->b_width  << s->block_max_depth;
     const int b_height= s->b_height << s->block_max_depth;
     const int b_stride= b_width;
@@ -289,7 +296,6 @@ static av_always_inline void add_yblock(SnowContext *s, int sliced, slice_buffer
     // When src_stride is large enough, it is possible to interleave the blocks.
     // Otherwise the blocks are written sequentially in the tmp buffer.
     int tmp_step= src_stride >= 7*MB_SIZE ? MB_SIZE : MB_SIZE*src_stride;
-    uint8_t *tmp = s->scratchbuf;
     uint8_t *ptmp;
     int x,y;
 
@@ -401,7 +407,7 @@ static av_always_inline void add_yblock(SnowContext *s, int sliced, slice_buffer
     }
 }
 
-static av_always_inline void predict_slice(SnowContext *s, IDWTELEM *buf, int plane_index, int add, int mb_y){
+static av_always_inline void predict_slice(SnowContext *s, uint8_t *tmp, IDWTELEM *buf, int plane_index, int add, int mb_y){
     Plane *p= &s->plane[plane_index];
     const int mb_w= s->b_width  << s->block_max_depth;
     const int mb_h= s->b_height << s->block_max_depth;
@@ -441,7 +447,7 @@ static av_always_inline void predict_slice(SnowContext *s, IDWTELEM *buf, int pl
     }
 
     for(mb_x=0; mb_x<=mb_w; mb_x++){
-        add_yblock(s, 0, NULL, buf, dst8, obmc,
+        add_yblock(s, tmp, 0, NULL, buf, dst8, obmc,
                    block_w*mb_x - block_w/2,
                    block_h*mb_y - block_h/2,
                    block_w, block_h,
@@ -456,7 +462,7 @@ static av_always_inline void predict_plane(SnowContext *s, IDWTELEM *buf, int pl
     const int mb_h= s->b_height << s->block_max_depth;
     int mb_y;
     for(mb_y=0; mb_y<=mb_h; mb_y++)
-        predict_slice(s, buf, plane_index, add, mb_y);
+        predict_slice(s, s->scratchbuf, buf, plane_index, add, mb_y);
 }
 
 static inline void set_blocks(SnowContext *s, int level, int x, int y, int l, int cb, int cr, int mx, int my, int ref, int type){
@@ -337,6 +337,88 @@ void ff_spatial_dwt(DWTELEM *buffer, DWTELEM *temp, int width, int height,
     }
 }
 
+static void spatial_decompose53i_vertical(DWTELEM *buffer, int width,
+                                          int height, int stride)
+{
+    int y;
+    DWTELEM *b0 = buffer + avpriv_mirror(-2 - 1, height - 1) * stride;
+    DWTELEM *b1 = buffer + avpriv_mirror(-2,     height - 1) * stride;
+
+    for (y = -2; y < height; y += 2) {
+        DWTELEM *b2 = buffer + avpriv_mirror(y + 1, height - 1) * stride;
+        DWTELEM *b3 = buffer + avpriv_mirror(y + 2, height - 1) * stride;
+
+        if (y + 1 < (unsigned)height)
+            vertical_decompose53iH0(b1, b2, b3, width);
+        if (y + 0 < (unsigned)height)
+            vertical_decompose53iL0(b0, b1, b2, width);
+
+        b0 = b2;
+        b1 = b3;
+    }
+}
+
+static void spatial_decompose97i_vertical(DWTELEM *buffer, int width,
+                                          int height, int stride)
+{
+    int y;
+    DWTELEM *b0 = buffer + avpriv_mirror(-4 - 1, height - 1) * stride;
+    DWTELEM *b1 = buffer + avpriv_mirror(-4,     height - 1) * stride;
+    DWTELEM *b2 = buffer + avpriv_mirror(-4 + 1, height - 1) * stride;
+    DWTELEM *b3 = buffer + avpriv_mirror(-4 + 2, height - 1) * stride;
+
+    for (y = -4; y < height; y += 2) {
+        DWTELEM *b4 = buffer + avpriv_mirror(y + 3, height - 1) * stride;
+        DWTELEM *b5 = buffer + avpriv_mirror(y + 4, height - 1) * stride;
+
+        if (y + 3 < (unsigned)height)
+            vertical_decompose97iH0(b3, b4, b5, width);
+        if (y + 2 < (unsigned)height)
+            vertical_decompose97iL0(b2, b3, b4, width);
+        if (y + 1 < (unsigned)height)
+            vertical_decompose97iH1(b1, b2, b3, width);
+        if (y + 0 < (unsigned)height)
+            vertical_decompose97iL1(b0, b1, b2, width);
+
+        b0 = b2;
+        b1 = b3;
+        b2 = b4;
+        b3 = b5;
+    }
+}
+
+void ff_spatial_dwt_horizontal(DWTELEM *buffer, DWTELEM *temp, int width,
+                               int stride, int type, int start_y, int end_y)
+{
+    int y;
+
+    for (y = start_y; y < end_y; y++) {
+        switch (type) {
+        case DWT_97:
+            horizontal_decompose97i(buffer + y * stride, temp, width);
+            break;
+        case DWT_53:
+            horizontal_decompose53i(buffer + y * stride, temp, width);
+            break;
+        }
+    }
+}
+
+void ff_spatial_dwt_vertical(DWTELEM *buffer, int height, int stride,
+                             int type, int start_x, int end_x)
+{
+    switch (type) {
+    case DWT_97:
+        spatial_decompose97i_vertical(buffer + start_x, end_x - start_x,
+                                      height, stride);
+        break;
+    case DWT_53:
+        spatial_decompose53i_vertical(buffer + start_x, end_x - start_x,
+                                      height, stride);
+        break;
+    }
+}
+
 static void horizontal_compose53i(IDWTELEM *b, IDWTELEM *temp, int width)
 {
     const int width2 = width >> 1;
@@ -740,6 +822,88 @@ void ff_spatial_idwt(IDWTELEM *buffer, IDWTELEM *temp, int width, int height,
                               decomposition_count, y);
 }
 
+static void spatial_compose53i_vertical(IDWTELEM *buffer, int width,
+                                        int height, int stride)
+{
+    int y;
+    IDWTELEM *b0 = buffer + avpriv_mirror(-1 - 1, height - 1) * stride;
+    IDWTELEM *b1 = buffer + avpriv_mirror(-1,     height - 1) * stride;
+
+    for (y = -1; y <= height; y += 2) {
+        IDWTELEM *b2 = buffer + avpriv_mirror(y + 1, height - 1) * stride;
+        IDWTELEM *b3 = buffer + avpriv_mirror(y + 2, height - 1) * stride;
+
+        if (y + 1 < (unsigned)height)
+            vertical_compose53iL0(b1, b2, b3, width);
+        if (y + 0 < (unsigned)height)
+            vertical_compose53iH0(b0, b1, b2, width);
+
+        b0 = b2;
+        b1 = b3;
+    }
+}
+
+static void spatial_compose97i_vertical(IDWTELEM *buffer, int width,
+                                        int height, int stride)
+{
+    int y;
+    IDWTELEM *b0 = buffer + avpriv_mirror(-3 - 1, height - 1) * stride;
+    IDWTELEM *b1 = buffer + avpriv_mirror(-3,     height - 1) * stride;
+    IDWTELEM *b2 = buffer + avpriv_mirror(-3 + 1, height - 1) * stride;
+    IDWTELEM *b3 = buffer + avpriv_mirror(-3 + 2, height - 1) * stride;
+
+    for (y = -3; y <= height; y += 2) {
+        IDWTELEM *b4 = buffer + avpriv_mirror(y + 3, height - 1) * stride;
+        IDWTELEM *b5 = buffer + avpriv_mirror(y + 4, height - 1) * stride;
+
+        if (y + 3 < (unsigned)height)
+            vertical_compose97iL1(b3, b4, b5, width);
+        if (y + 2 < (unsigned)height)
+            vertical_compose97iH1(b2, b3, b4, width);
+        if (y + 1 < (unsigned)height)
+            vertical_compose97iL0(b1, b2, b3, width);
+        if (y + 0 < (unsigned)height)
+            vertical_compose97iH0(b0, b1, b2, width);
+
+        b0 = b2;
+        b1 = b3;
+        b2 = b4;
+        b3 = b5;
+    }
+}
+
+void ff_spatial_idwt_vertical(IDWTELEM *buffer, int height, int stride,
+                              int type, int start_x, int end_x)
+{
+    switch (type) {
+    case DWT_97:
+        spatial_compose97i_vertical(buffer + start_x, end_x - start_x,
+                                    height, stride);
+        break;
+    case DWT_53:
+        spatial_compose53i_vertical(buffer + start_x, end_x - start_x,
+                                    height, stride);
+        break;
+    }
+}
+
+void ff_spatial_idwt_horizontal(IDWTELEM *buffer, IDWTELEM *temp, int width,
+                                int stride, int type, int start_y, int end_y)
+{
+    int y;
+
+    for (y = start_y; y < end_y; y++) {
+        switch (type) {
+        case DWT_97:
+            ff_snow_horizontal_compose97i(buffer + y * stride, temp, width);
+            break;
+        case DWT_53:
+            horizontal_compose53i(buffer + y * stride, temp, width);
+            break;
+        }
+    }
+}
+
 static inline int w_c(struct MpegEncContext *v, uint8_t *pix1, uint8_t *pix2, ptrdiff_t line_size,
                       int w, int h, int type)
 {
@@ -114,6 +114,23 @@ int ff_w97_32_c(struct MpegEncContext *v, uint8_t *pix1, uint8_t *pix2, ptrdiff_
 void ff_spatial_dwt(int *buffer, int *temp, int width, int height, int stride,
                     int type, int decomposition_count);
 
+/**
+ * Split one decomposition level of ff_spatial_dwt() / ff_spatial_idwt() into
+ * a horizontal pass over the rows [start_y, end_y) and a vertical pass over
+ * the columns [start_x, end_x), so that the level can be spread over several
+ * threads. The forward transform runs the horizontal pass over all rows
+ * before the vertical pass, the inverse transform the other way round; the
+ * result is identical to the one of the serial functions.
+ */
+void ff_spatial_dwt_horizontal(DWTELEM *buffer, DWTELEM *temp, int width,
+                               int stride, int type, int start_y, int end_y);
+void ff_spatial_dwt_vertical(DWTELEM *buffer, int height, int stride,
+                             int type, int start_x, int end_x);
+void ff_spatial_idwt_vertical(IDWTELEM *buffer, int height, int stride,
+                              int type, int start_x, int end_x);
+void ff_spatial_idwt_horizontal(IDWTELEM *buffer, IDWTELEM *temp, int width,
+                                int stride, int type, int start_y, int end_y);
+
 void ff_spatial_idwt_buffered_init(DWTCompose *cs, slice_buffer *sb, int width,
                                    int height, int stride_line, int type,
                                    int decomposition_count);
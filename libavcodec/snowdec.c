@@ -32,6 +32,39 @@
 #include "mpegvideo.h"
 #include "h263.h"
 
+static void export_motion_vectors(SnowContext *s){
+    const int mb_w= s->b_width  << s->block_max_depth;
+    const int mb_h= s->b_height << s->block_max_depth;
+    const int block_w= MB_SIZE >> s->block_max_depth;
+    const int block_h= block_w;
+    int mb_x, mb_y;
+
+    for(mb_y=0; mb_y<mb_h; mb_y++)
+    for(mb_x=0; mb_x<mb_w; mb_x++){
+        AVMotionVector *avmv = s->avmv + s->avmv_index;
+        const int b_width = s->b_width  << s->block_max_depth;
+        const int b_stride= b_width;
+        BlockNode *bn= &s->block[mb_x + mb_y*b_stride];
+
+        if (bn->type)
+            continue;
+
+        s->avmv_index++;
+
+        avmv->w = block_w;
+        avmv->h = block_h;
+        avmv->dst_x = block_w*mb_x - block_w/2;
+        avmv->dst_y = block_h*mb_y - block_h/2;
+        avmv->motion_scale = 8;
+        avmv->motion_x = bn->mx * s->mv_scale;
+        avmv->motion_y = bn->my * s->mv_scale;
+        avmv->src_x = avmv->dst_x + avmv->motion_x / 8;
+        avmv->src_y = avmv->dst_y + avmv->motion_y / 8;
+        avmv->source= -1 - bn->ref;
+        avmv->flags = 0;
+    }
+}
+
 static av_always_inline void predict_slice_buffered(SnowContext *s, slice_buffer * sb, IDWTELEM * old_buffer, int plane_index, int add, int mb_y){
     Plane *p= &s->plane[plane_index];
     const int mb_w= s->b_width  << s->block_max_depth;
@@ -78,7 +111,7 @@ static av_always_inline void predict_slice_buffered(SnowContext *s, slice_buffer
     }
 
     for(mb_x=0; mb_x<=mb_w; mb_x++){
-        add_yblock(s, 1, sb, old_buffer, dst8, obmc,
+        add_yblock(s, s->scratchbuf, 1, sb, old_buffer, dst8, obmc,
                    block_w*mb_x - block_w/2,
                    block_h*mb_y - block_h/2,
                    block_w, block_h,
@@ -87,31 +120,6 @@ static av_always_inline void predict_slice_buffered(SnowContext *s, slice_buffer
                    mb_x - 1, mb_y - 1,
                    add, 0, plane_index);
     }
-
-    if(s->avmv && mb_y < mb_h && plane_index == 0)
-        for(mb_x=0; mb_x<mb_w; mb_x++){
-            AVMotionVector *avmv = s->avmv + s->avmv_index;
-            const int b_width = s->b_width  << s->block_max_depth;
-            const int b_stride= b_width;
-            BlockNode *bn= &s->block[mb_x + mb_y*b_stride];
-
-            if (bn->type)
-                continue;
-
-            s->avmv_index++;
-
-            avmv->w = block_w;
-            avmv->h = block_h;
-            avmv->dst_x = block_w*mb_x - block_w/2;
-            avmv->dst_y = block_h*mb_y - block_h/2;
-            avmv->motion_scale = 8;
-            avmv->motion_x = bn->mx * s->mv_scale;
-            avmv->motion_y = bn->my * s->mv_scale;
-            avmv->src_x = avmv->dst_x + avmv->motion_x / 8;
-            avmv->src_y = avmv->dst_y + avmv->motion_y / 8;
-            avmv->source= -1 - bn->ref;
-            avmv->flags = 0;
-        }
 }
 
 static inline void decode_subband_slice_buffered(SnowContext *s, SubBand *b, slice_buffer * sb, int start_y, int h, int save_state[1]){
@@ -275,6 +283,48 @@ static void correlate_slice_buffered(SnowContext *s, slice_buffer * sb, SubBand
     }
 }
 
+/**
+ * Reconstruct a whole plane at once instead of slice by slice, so that the
+ * inverse DWT and the OBMC can be split over the slice threads.
+ * The lines of frame_sb all point into spatial_idwt_buffer, which gives the
+ * same contiguous layout the encoder reconstructs from.
+ */
+static void decode_plane_threaded(SnowContext *s, int plane_index){
+    Plane *p= &s->plane[plane_index];
+    slice_buffer *sb= &s->frame_sb;
+    const int w= p->width;
+    const int h= p->height;
+    int level, orientation, x, y;
+    int decode_state[1];
+
+    for(y=0; y<h; y++)
+        sb->line[y]= s->spatial_idwt_buffer + y*w;
+
+    for(level=0; level<s->spatial_decomposition_count; level++){
+        for(orientation=level ? 1 : 0; orientation<4; orientation++){
+            SubBand *b= &p->band[level][orientation];
+
+            decode_subband_slice_buffered(s, b, sb, 0, b->height, decode_state);
+            if(orientation==0){
+                correlate_slice_buffered(s, sb, b, b->ibuf, b->stride, 1, 0, 0, b->height);
+                dequantize_slice_buffered(s, sb, b, b->ibuf, b->stride, 0, b->height);
+            }
+        }
+    }
+
+    ff_snow_spatial_idwt(s, s->spatial_idwt_buffer, w, h, w);
+
+    if(s->qlog == LOSSLESS_QLOG){
+        for(y=0; y<h; y++){
+            for(x=0; x<w; x++){
+                s->spatial_idwt_buffer[y*w + x] *= 1<<FRAC_BITS;
+            }
+        }
+    }
+
+    ff_snow_predict_plane(s, s->spatial_idwt_buffer, plane_index, 1);
+}
+
 static void decode_qlogs(SnowContext *s){
     int plane_index, level, orientation;
 
@@ -528,7 +578,9 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
             }
         }
 
-        {
+        if(s->nb_threads > 1){
+            decode_plane_threaded(s, plane_index);
+        }else{
         const int mb_h= s->b_height << s->block_max_depth;
         const int block_size = MB_SIZE >> s->block_max_depth;
         const int block_h    = plane_index ? block_size>>s->chroma_v_shift : block_size;
@@ -607,6 +659,9 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *got_frame,
 
     }
 
+    if(s->avmv && !(s->keyframe || s->avctx->debug&512))
+        export_motion_vectors(s);
+
     emms_c();
 
     ff_snow_release_buffer(avctx);
@@ -657,7 +712,8 @@ AVCodec ff_snow_decoder = {
     .init           = ff_snow_common_init,
     .close          = decode_end,
     .decode         = decode_frame,
-    .capabilities   = AV_CODEC_CAP_DR1 /*| AV_CODEC_CAP_DRAW_HORIZ_BAND*/,
+    .capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_SLICE_THREADS
+                      /*| AV_CODEC_CAP_DRAW_HORIZ_BAND*/,
     .caps_internal  = FF_CODEC_CAP_INIT_THREADSAFE |
                       FF_CODEC_CAP_INIT_CLEANUP,
 };
@@ -542,7 +542,7 @@ static int get_dc(SnowContext *s, int mb_x, int mb_y, int plane_index){
         int x= block_w*mb_x2 + block_w/2;
         int y= block_h*mb_y2 + block_h/2;
 
-        add_yblock(s, 0, NULL, dst + (i&1)*block_w + (i>>1)*obmc_stride*block_h, NULL, obmc,
+        add_yblock(s, s->scratchbuf, 0, NULL, dst + (i&1)*block_w + (i>>1)*obmc_stride*block_h, NULL, obmc,
                     x, y, block_w, block_h, w, h, obmc_stride, ref_stride, obmc_stride, mb_x2, mb_y2, 0, 0, plane_index);
 
         for(y2= FFMAX(y, 0); y2<FFMIN(h, y+block_h); y2++){
@@ -736,7 +736,7 @@ static int get_4block_rd(SnowContext *s, int mb_x, int mb_y, int plane_index){
         int x= block_w*mb_x2 + block_w/2;
         int y= block_h*mb_y2 + block_h/2;
 
-        add_yblock(s, 0, NULL, zero_dst, dst, obmc,
+        add_yblock(s, s->scratchbuf, 0, NULL, zero_dst, dst, obmc,
                    x, y, block_w, block_h, w, h, /*dst_stride*/0, ref_stride, obmc_stride, mb_x2, mb_y2, 1, 1, plane_index);
 
         //FIXME find a cleaner/simpler way to skip the outside stuff
@@ -1551,7 +1551,7 @@ static void calculate_visual_weight(SnowContext *s, Plane *p){
 
             memset(s->spatial_idwt_buffer, 0, sizeof(*s->spatial_idwt_buffer)*width*height);
             ibuf[b->width/2 + b->height/2*b->stride]= 256*16;
-            ff_spatial_idwt(s->spatial_idwt_buffer, s->temp_idwt_buffer, width, height, width, s->spatial_decomposition_type, s->spatial_decomposition_count);
+            ff_snow_spatial_idwt(s, s->spatial_idwt_buffer, width, height, width);
             for(y=0; y<height; y++){
                 for(x=0; x<width; x++){
                     int64_t d= s->spatial_idwt_buffer[x + y*width]*16;
@@ -1757,7 +1757,7 @@ redo_frame:
                         s->spatial_idwt_buffer[y*w + x]= pict->data[plane_index][y*pict->linesize[plane_index] + x]<<FRAC_BITS;
                     }
                 }
-            predict_plane(s, s->spatial_idwt_buffer, plane_index, 0);
+            ff_snow_predict_plane(s, s->spatial_idwt_buffer, plane_index, 0);
 
 #if FF_API_PRIVATE_OPT
 FF_DISABLE_DEPRECATION_WARNINGS
@@ -1792,7 +1792,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
                 }
             }
 
-            ff_spatial_dwt(s->spatial_dwt_buffer, s->temp_dwt_buffer, w, h, w, s->spatial_decomposition_type, s->spatial_decomposition_count);
+            ff_snow_spatial_dwt(s, s->spatial_dwt_buffer, w, h, w);
 
             if(s->pass1_rc && plane_index==0){
                 int delta_qlog = ratecontrol_1pass(s, pic);
@@ -1831,7 +1831,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
                 }
             }
 
-            ff_spatial_idwt(s->spatial_idwt_buffer, s->temp_idwt_buffer, w, h, w, s->spatial_decomposition_type, s->spatial_decomposition_count);
+            ff_snow_spatial_idwt(s, s->spatial_idwt_buffer, w, h, w);
             if(s->qlog == LOSSLESS_QLOG){
                 for(y=0; y<h; y++){
                     for(x=0; x<w; x++){
@@ -1839,7 +1839,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
                     }
                 }
             }
-            predict_plane(s, s->spatial_idwt_buffer, plane_index, 1);
+            ff_snow_predict_plane(s, s->spatial_idwt_buffer, plane_index, 1);
         }else{
             //ME/MC only
             if(pic->pict_type == AV_PICTURE_TYPE_I){
@@ -1851,7 +1851,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
                 }
             }else{
                 memset(s->spatial_idwt_buffer, 0, sizeof(IDWTELEM)*w*h);
-                predict_plane(s, s->spatial_idwt_buffer, plane_index, 1);
+                ff_snow_predict_plane(s, s->spatial_idwt_buffer, plane_index, 1);
             }
         }
         if(s->avctx->flags&AV_CODEC_FLAG_PSNR){
@@ -1972,6 +1972,7 @@ AVCodec ff_snow_encoder = {
     .init           = encode_init,
     .encode2        = encode_frame,
     .close          = encode_end,
+    .capabilities   = AV_CODEC_CAP_SLICE_THREADS,
     .pix_fmts       = (const enum AVPixelFormat[]){
         AV_PIX_FMT_YUV420P, AV_PIX_FMT_YUV410P, AV_PIX_FMT_YUV444P,
         AV_PIX_FMT_GRAY8,
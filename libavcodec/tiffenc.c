@@ -410,7 +410,7 @@ static int encode_frame(AVCodecContext *avctx, AVPacket *pkt,
 #endif
     {
     if (s->compr == TIFF_LZW) {
-        s->lzws = av_malloc(ff_lzw_encode_state_size);
+        s->lzws = av_mallocz(ff_lzw_encode_state_size);
         if (!s->lzws) {
             ret = AVERROR(ENOMEM);
             goto fail;
@@ -0,0 +1,175 @@
+/*
+ * JPEG 2000 discrete wavelet transform, x86 optimized lifting steps
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavcodec/jpeg2000dwt.h"
+
+/* A strip row is FF_DWT_STRIP_COLS = 16 int32 samples, i.e. 64 bytes or two
+ * ymm registers. The lifting steps update every other row from the rows
+ * just above and below it, so the loops below advance by two rows. */
+
+#if HAVE_AVX2_INLINE
+
+/* x -= (a + b) >> 1 on the n odd rows starting at x */
+static void lift53_predict_avx2(int32_t *x, int n)
+{
+    if (n <= 0)
+        return;
+    __asm__ volatile(
+        "1:                                     \n\t"
+        "vmovdqu     -64(%0), %%ymm0            \n\t"
+        "vmovdqu     -32(%0), %%ymm1            \n\t"
+        "vpaddd       64(%0), %%ymm0, %%ymm0    \n\t"
+        "vpaddd       96(%0), %%ymm1, %%ymm1    \n\t"
+        "vpsrad          $1, %%ymm0, %%ymm0     \n\t"
+        "vpsrad          $1, %%ymm1, %%ymm1     \n\t"
+        "vmovdqu        (%0), %%ymm2            \n\t"
+        "vmovdqu      32(%0), %%ymm3            \n\t"
+        "vpsubd      %%ymm0, %%ymm2, %%ymm2     \n\t"
+        "vpsubd      %%ymm1, %%ymm3, %%ymm3     \n\t"
+        "vmovdqu     %%ymm2,   (%0)             \n\t"
+        "vmovdqu     %%ymm3, 32(%0)             \n\t"
+        "add           $128, %0                 \n\t"
+        "dec             %1                     \n\t"
+        "jnz             1b                     \n\t"
+        "vzeroupper                             \n\t"
+        : "+r"(x), "+r"(n)
+        :
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",) "memory"
+    );
+}
+
+/* x += (a + b + 2) >> 2 on the n even rows starting at x */
+static void lift53_update_avx2(int32_t *x, int n)
+{
+    if (n <= 0)
+        return;
+    __asm__ volatile(
+        "vpcmpeqd    %%ymm4, %%ymm4, %%ymm4     \n\t"
+        "vpsrld         $31, %%ymm4, %%ymm4     \n\t"
+        "vpslld          $1, %%ymm4, %%ymm4     \n\t"
+        "1:                                     \n\t"
+        "vmovdqu     -64(%0), %%ymm0            \n\t"
+        "vmovdqu     -32(%0), %%ymm1            \n\t"
+        "vpaddd       64(%0), %%ymm0, %%ymm0    \n\t"
+        "vpaddd       96(%0), %%ymm1, %%ymm1    \n\t"
+        "vpaddd      %%ymm4, %%ymm0, %%ymm0     \n\t"
+        "vpaddd      %%ymm4, %%ymm1, %%ymm1     \n\t"
+        "vpsrad          $2, %%ymm0, %%ymm0     \n\t"
+        "vpsrad          $2, %%ymm1, %%ymm1     \n\t"
+        "vpaddd        (%0), %%ymm0, %%ymm0     \n\t"
+        "vpaddd      32(%0), %%ymm1, %%ymm1     \n\t"
+        "vmovdqu     %%ymm0,   (%0)             \n\t"
+        "vmovdqu     %%ymm1, 32(%0)             \n\t"
+        "add           $128, %0                 \n\t"
+        "dec             %1                     \n\t"
+        "jnz             1b                     \n\t"
+        "vzeroupper                             \n\t"
+        : "+r"(x), "+r"(n)
+        :
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm4",) "memory"
+    );
+}
+
+static void sd_lift53_avx2(int32_t *p, int i0, int i1)
+{
+    int s = (i0 + 1) >> 1, e = (i1 + 1) >> 1;
+
+    lift53_predict_avx2(p + (2 * s - 1) * FF_DWT_STRIP_COLS, e - s + 1);
+    lift53_update_avx2 (p +  2 * s      * FF_DWT_STRIP_COLS, e - s);
+}
+
+/*
+ * x += or -= (k * (a + b) + (1 << 15)) >> 16 with a 64-bit product, on 8
+ * columns: vpmuldq multiplies the even dwords, so the odd ones are moved
+ * down first. Only the low 32 bits of the shifted products are kept, so
+ * the logical shifts give the same result as arithmetic ones, and the odd
+ * products are shifted straight into the high dwords before the blend.
+ * ymm6 holds k, ymm7 the rounding term in each qword.
+ */
+#define LIFT97_8COLS(above, below, cur, op)                 \
+        "vmovdqu   "above"(%0), %%ymm0                \n\t" \
+        "vpaddd    "below"(%0), %%ymm0, %%ymm0        \n\t" \
+        "vpsrlq           $32, %%ymm0, %%ymm1         \n\t" \
+        "vpmuldq       %%ymm6, %%ymm0, %%ymm0         \n\t" \
+        "vpmuldq       %%ymm6, %%ymm1, %%ymm1         \n\t" \
+        "vpaddq        %%ymm7, %%ymm0, %%ymm0         \n\t" \
+        "vpaddq        %%ymm7, %%ymm1, %%ymm1         \n\t" \
+        "vpsrlq           $16, %%ymm0, %%ymm0         \n\t" \
+        "vpsllq           $16, %%ymm1, %%ymm1         \n\t" \
+        "vpblendd       $0xAA, %%ymm1, %%ymm0, %%ymm0 \n\t" \
+        "vmovdqu     "cur"(%0), %%ymm2                \n\t" \
+        op"         %%ymm0, %%ymm2, %%ymm2            \n\t" \
+        "vmovdqu       %%ymm2, "cur"(%0)              \n\t"
+
+#define LIFT97_ROWS(name, op)                                           \
+static void name(int32_t *x, int n, int k)                              \
+{                                                                       \
+    if (n <= 0)                                                         \
+        return;                                                         \
+    __asm__ volatile(                                                   \
+        "vmovd             %2, %%xmm6                 \n\t"             \
+        "vpbroadcastd  %%xmm6, %%ymm6                 \n\t"             \
+        "vpcmpeqd      %%ymm7, %%ymm7, %%ymm7         \n\t"             \
+        "vpsrlq           $63, %%ymm7, %%ymm7         \n\t"             \
+        "vpsllq           $15, %%ymm7, %%ymm7         \n\t"             \
+        "1:                                           \n\t"             \
+        LIFT97_8COLS("-64", "64",  "0", op)                             \
+        LIFT97_8COLS("-32", "96", "32", op)                             \
+        "add             $128, %0                     \n\t"             \
+        "dec               %1                         \n\t"             \
+        "jnz               1b                         \n\t"             \
+        "vzeroupper                                   \n\t"             \
+        : "+r"(x), "+r"(n)                                              \
+        : "r"(k)                                                        \
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm6", "%xmm7",)    \
+          "memory"                                                      \
+    );                                                                  \
+}
+
+LIFT97_ROWS(lift97_sub_avx2, "vpsubd")
+LIFT97_ROWS(lift97_add_avx2, "vpaddd")
+
+static void sd_lift97_int_avx2(int32_t *p, int i0, int i1)
+{
+    int s = (i0 + 1) >> 1, e = (i1 + 1) >> 1;
+
+    lift97_sub_avx2(p + (2 * s - 3) * FF_DWT_STRIP_COLS, e - s + 3, I_LFTG_ALPHA);
+    lift97_sub_avx2(p + (2 * s - 2) * FF_DWT_STRIP_COLS, e - s + 2, I_LFTG_BETA);
+    lift97_add_avx2(p + (2 * s - 1) * FF_DWT_STRIP_COLS, e - s + 1, I_LFTG_GAMMA);
+    lift97_add_avx2(p +  2 * s      * FF_DWT_STRIP_COLS, e - s,     I_LFTG_DELTA);
+}
+
+#endif /* HAVE_AVX2_INLINE */
+
+av_cold void ff_jpeg2000dwt_dsp_init_x86(DWTDSPContext *c)
+{
+#if HAVE_AVX2_INLINE
+    int cpu_flags = av_get_cpu_flags();
+
+    if (INLINE_AVX2(cpu_flags)) {
+        c->sd_lift53     = sd_lift53_avx2;
+        c->sd_lift97_int = sd_lift97_int_avx2;
+    }
+#endif /* HAVE_AVX2_INLINE */
+}
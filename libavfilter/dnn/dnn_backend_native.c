@@ -23,8 +23,14 @@
  * DNN native backend implementation.
  */
 
+#include <stdatomic.h>
+
+#include "config.h"
 #include "dnn_backend_native.h"
 #include "libavutil/avassert.h"
+#include "libavutil/avstring.h"
+#include "libavutil/cpu.h"
+#include "libavutil/thread.h"
 #include "dnn_backend_native_layer_conv2d.h"
 #include "dnn_backend_native_layers.h"
 #include "dnn_io_proc.h"
@@ -33,6 +39,7 @@
 #define FLAGS AV_OPT_FLAG_FILTERING_PARAM
 static const AVOption dnn_native_options[] = {
     { "conv2d_threads", "threads num for conv2d layer", OFFSET(options.conv2d_threads), AV_OPT_TYPE_INT,  { .i64 = 0 }, INT_MIN, INT_MAX, FLAGS },
+    { "nireq",          "number of inferences run in parallel in async mode", OFFSET(options.nireq), AV_OPT_TYPE_INT, { .i64 = 1 }, 0, INT_MAX, FLAGS },
     { NULL },
 };
 
@@ -44,6 +51,29 @@ const AVClass dnn_native_class = {
     .category   = AV_CLASS_CATEGORY_FILTER,
 };
 
+typedef struct TaskItem {
+    const char *input_name;
+    AVFrame *in_frame;
+    const char *output_name;
+    AVFrame *out_frame;
+    DNNReturnType result;
+    atomic_int done;
+} TaskItem;
+
+/**
+ * An async inference worker. Each worker owns a separate instance of the
+ * model, as operands hold the intermediate data of one inference at a time.
+ */
+typedef struct NativeWorker {
+    DNNModel *model;
+    NativeModel *native_model;
+    FFSafeQueue *pending_queue;
+#if HAVE_PTHREAD_CANCEL
+    pthread_t thread;
+#endif
+    int thread_created;
+} NativeWorker;
+
 static DNNReturnType execute_model_native(const DNNModel *model, const char *input_name, AVFrame *in_frame,
                                           const char **output_names, uint32_t nb_output, AVFrame *out_frame,
                                           int do_ioproc);
@@ -112,6 +142,55 @@ static DNNReturnType get_output_native(void *model, const char *input_name, int
 // layers_num,layer_type,layer_parameterss,layer_type,layer_parameters...
 // For CONV layer: activation_function, input_num, output_num, kernel_size, kernel, biases
 // For DEPTH_TO_SPACE layer: block_size
+static void native_worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    NativeContext *ctx = priv;
+    ctx->job_func(ctx->job_arg, jobnr, nb_jobs);
+}
+
+void ff_dnn_execute_jobs_native(NativeContext *ctx, void (*func)(void *arg, int jobnr, int nb_jobs), void *arg)
+{
+    if (!ctx || !ctx->slicethread) {
+        func(arg, 0, 1);
+        return;
+    }
+
+    ctx->job_func = func;
+    ctx->job_arg  = arg;
+    avpriv_slicethread_execute(ctx->slicethread, ctx->nb_threads, 0);
+}
+
+/**
+ * (Re)create the worker pool of the conv2d layers with the given number of
+ * threads, 0 or less selects one thread per CPU.
+ */
+static int init_conv2d_threads(NativeModel *native_model, int nb_threads)
+{
+    NativeContext *ctx = &native_model->ctx;
+    int requested = nb_threads;
+
+    avpriv_slicethread_free(&ctx->slicethread);
+    ctx->nb_threads = 1;
+    if (nb_threads == 1)
+        return 0;
+
+    if (nb_threads <= 0 || nb_threads > av_cpu_count())
+        nb_threads = 0;
+    nb_threads = avpriv_slicethread_create(&ctx->slicethread, ctx,
+                                           native_worker_func, NULL, nb_threads);
+    if (nb_threads == AVERROR(ENOSYS)) {
+        if (requested > 1)
+            av_log(ctx, AV_LOG_WARNING, "'conv2d_threads' option was set but it is not supported "
+                   "on this build (pthread support is required)\n");
+    } else if (nb_threads < 0) {
+        return nb_threads;
+    } else if (nb_threads == 1) {
+        avpriv_slicethread_free(&ctx->slicethread);
+    }
+    ctx->nb_threads = FFMAX(nb_threads, 1);
+    return 0;
+}
+
 DNNModel *ff_dnn_load_model_native(const char *model_filename, const char *options, AVFilterContext *filter_ctx)
 {
     DNNModel *model = NULL;
@@ -176,12 +255,8 @@ DNNModel *ff_dnn_load_model_native(const char *model_filename, const char *optio
     model->model = (void *)native_model;
     native_model->model = model;
 
-#if !HAVE_PTHREAD_CANCEL
-    if (native_model->ctx.options.conv2d_threads > 1){
-        av_log(&native_model->ctx, AV_LOG_WARNING, "'conv2d_threads' option was set but it is not supported "
-                       "on this build (pthread support is required)\n");
-    }
-#endif
+    if (init_conv2d_threads(native_model, native_model->ctx.options.conv2d_threads) < 0)
+        goto fail;
 
     avio_seek(model_file_context, file_size - 8, SEEK_SET);
     native_model->layers_num = (int32_t)avio_rl32(model_file_context);
@@ -253,6 +328,12 @@ DNNModel *ff_dnn_load_model_native(const char *model_filename, const char *optio
         return NULL;
     }
 
+    native_model->model_filename = av_strdup(model_filename);
+    if (!native_model->model_filename) {
+        ff_dnn_free_model_native(&model);
+        return NULL;
+    }
+
     model->get_input = &get_input_native;
     model->get_output = &get_output_native;
     model->filter_ctx = filter_ctx;
@@ -398,6 +479,274 @@ DNNReturnType ff_dnn_execute_model_native(const DNNModel *model, const char *inp
     return execute_model_native(model, input_name, in_frame, output_names, nb_output, out_frame, 1);
 }
 
+#if HAVE_PTHREAD_CANCEL
+static void *native_async_worker(void *arg)
+{
+    NativeWorker *worker = arg;
+
+    for (;;) {
+        TaskItem *task = ff_safe_queue_pop_front(worker->pending_queue);
+        // a NULL task asks the worker to exit
+        if (!task)
+            break;
+        task->result = execute_model_native(worker->model, task->input_name, task->in_frame,
+                                            &task->output_name, 1, task->out_frame, 1);
+        atomic_store_explicit(&task->done, 1, memory_order_release);
+
+        pthread_mutex_lock(&worker->native_model->task_lock);
+        worker->native_model->nb_running--;
+        pthread_cond_signal(&worker->native_model->task_cond);
+        pthread_mutex_unlock(&worker->native_model->task_lock);
+    }
+
+    return NULL;
+}
+#endif
+
+static DNNReturnType init_async_native(NativeModel *native_model)
+{
+    NativeContext *ctx = &native_model->ctx;
+#if HAVE_PTHREAD_CANCEL
+    DNNModel *model = native_model->model;
+    int nireq = ctx->options.nireq;
+    int nb_threads = ctx->options.conv2d_threads;
+
+    if (nireq <= 0)
+        nireq = av_cpu_count() / 2 + 1;
+
+    pthread_mutex_init(&native_model->task_lock, NULL);
+    pthread_cond_init(&native_model->task_cond, NULL);
+    native_model->nb_running = 0;
+
+    // share the conv2d threads between the model instances, rather than
+    // giving each of them as many threads as the model was loaded with
+    if (nb_threads <= 0 || nb_threads > av_cpu_count())
+        nb_threads = av_cpu_count();
+    nb_threads = FFMAX(nb_threads / nireq, 1);
+    if (ctx->nb_threads > nb_threads && init_conv2d_threads(native_model, nb_threads) < 0)
+        return DNN_ERROR;
+    native_model->worker_options = av_asprintf("%s%sconv2d_threads=%d",
+                                               model->options ? model->options : "",
+                                               model->options && *model->options ? "&" : "",
+                                               nb_threads);
+    if (!native_model->worker_options) {
+        av_log(ctx, AV_LOG_ERROR, "Failed to allocate memory for async execution\n");
+        return DNN_ERROR;
+    }
+
+    native_model->pending_queue = ff_safe_queue_create();
+    native_model->task_queue = ff_queue_create();
+    native_model->workers = av_mallocz_array(nireq, sizeof(*native_model->workers));
+    if (!native_model->pending_queue || !native_model->task_queue || !native_model->workers) {
+        av_log(ctx, AV_LOG_ERROR, "Failed to allocate memory for async execution\n");
+        return DNN_ERROR;
+    }
+
+    for (int i = 0; i < nireq; i++) {
+        NativeWorker *worker = &native_model->workers[i];
+
+        // the first worker runs on the model itself, the others on copies of it
+        if (i == 0) {
+            worker->model = native_model->model;
+        } else {
+            worker->model = ff_dnn_load_model_native(native_model->model_filename,
+                                                     native_model->worker_options,
+                                                     model->filter_ctx);
+            if (!worker->model) {
+                av_log(ctx, AV_LOG_ERROR, "Failed to load model instance for async execution\n");
+                return DNN_ERROR;
+            }
+            worker->model->pre_proc  = model->pre_proc;
+            worker->model->post_proc = model->post_proc;
+        }
+        native_model->nb_workers++;
+
+        worker->native_model  = native_model;
+        worker->pending_queue = native_model->pending_queue;
+        if (pthread_create(&worker->thread, NULL, native_async_worker, worker)) {
+            av_log(ctx, AV_LOG_ERROR, "Failed to create async worker thread\n");
+            return DNN_ERROR;
+        }
+        worker->thread_created = 1;
+    }
+
+    return DNN_SUCCESS;
+#else
+    av_log(ctx, AV_LOG_ERROR, "async execution is not supported on this build (pthread support is required)\n");
+    return DNN_ERROR;
+#endif
+}
+
+static void uninit_async_native(NativeModel *native_model)
+{
+#if HAVE_PTHREAD_CANCEL
+    for (int i = 0; i < native_model->nb_workers; i++) {
+        if (native_model->workers[i].thread_created)
+            ff_safe_queue_push_back(native_model->pending_queue, NULL);
+    }
+    for (int i = 0; i < native_model->nb_workers; i++) {
+        NativeWorker *worker = &native_model->workers[i];
+        if (worker->thread_created)
+            pthread_join(worker->thread, NULL);
+        if (i > 0)
+            ff_dnn_free_model_native(&worker->model);
+    }
+    pthread_cond_destroy(&native_model->task_cond);
+    pthread_mutex_destroy(&native_model->task_lock);
+#endif
+    av_freep(&native_model->workers);
+    av_freep(&native_model->worker_options);
+    native_model->nb_workers = 0;
+
+    while (ff_queue_size(native_model->task_queue) != 0) {
+        TaskItem *task = ff_queue_pop_front(native_model->task_queue);
+        av_frame_free(&task->in_frame);
+        av_frame_free(&task->out_frame);
+        av_freep(&task);
+    }
+    ff_queue_destroy(native_model->task_queue);
+    native_model->task_queue = NULL;
+    ff_safe_queue_destroy(native_model->pending_queue);
+    native_model->pending_queue = NULL;
+}
+
+DNNReturnType ff_dnn_execute_model_async_native(const DNNModel *model, const char *input_name, AVFrame *in_frame,
+                                                const char **output_names, uint32_t nb_output, AVFrame *out_frame)
+{
+    NativeModel *native_model = (NativeModel *)model->model;
+    NativeContext *ctx = &native_model->ctx;
+    TaskItem *task;
+
+    if (!in_frame) {
+        av_log(ctx, AV_LOG_ERROR, "in frame is NULL when async execute model.\n");
+        return DNN_ERROR;
+    }
+
+    if (!out_frame) {
+        av_log(ctx, AV_LOG_ERROR, "out frame is NULL when async execute model.\n");
+        return DNN_ERROR;
+    }
+
+    if (nb_output != 1) {
+        av_log(ctx, AV_LOG_ERROR, "do not support multiple outputs\n");
+        return DNN_ERROR;
+    }
+
+    if (!native_model->workers) {
+        if (init_async_native(native_model) != DNN_SUCCESS) {
+            uninit_async_native(native_model);
+            return DNN_ERROR;
+        }
+    }
+
+    task = av_malloc(sizeof(*task));
+    if (!task) {
+        av_log(ctx, AV_LOG_ERROR, "unable to alloc memory for task item.\n");
+        return DNN_ERROR;
+    }
+
+    task->input_name = input_name;
+    task->in_frame = in_frame;
+    task->output_name = output_names[0];
+    task->out_frame = out_frame;
+    task->result = DNN_ERROR;
+    atomic_init(&task->done, 0);
+    if (ff_queue_push_back(native_model->task_queue, task) < 0) {
+        av_freep(&task);
+        av_log(ctx, AV_LOG_ERROR, "unable to push back task_queue.\n");
+        return DNN_ERROR;
+    }
+
+#if HAVE_PTHREAD_CANCEL
+    // keep at most two tasks per worker in flight, so that the caller is
+    // held back rather than queueing frames faster than they are processed
+    pthread_mutex_lock(&native_model->task_lock);
+    while (native_model->nb_running >= 2 * native_model->nb_workers)
+        pthread_cond_wait(&native_model->task_cond, &native_model->task_lock);
+    native_model->nb_running++;
+    pthread_mutex_unlock(&native_model->task_lock);
+#endif
+
+    if (ff_safe_queue_push_back(native_model->pending_queue, task) < 0) {
+#if HAVE_PTHREAD_CANCEL
+        pthread_mutex_lock(&native_model->task_lock);
+        native_model->nb_running--;
+        pthread_mutex_unlock(&native_model->task_lock);
+#endif
+        ff_queue_pop_back(native_model->task_queue);
+        av_freep(&task);
+        av_log(ctx, AV_LOG_ERROR, "unable to push back pending_queue.\n");
+        return DNN_ERROR;
+    }
+
+    return DNN_SUCCESS;
+}
+
+DNNAsyncStatusType ff_dnn_get_async_result_native(const DNNModel *model, AVFrame **in, AVFrame **out)
+{
+    NativeModel *native_model = (NativeModel *)model->model;
+    TaskItem *task = ff_queue_peek_front(native_model->task_queue);
+    DNNReturnType result;
+
+    if (!task) {
+        return DAST_EMPTY_QUEUE;
+    }
+
+    if (!atomic_load_explicit(&task->done, memory_order_acquire)) {
+        return DAST_NOT_READY;
+    }
+
+    ff_queue_pop_front(native_model->task_queue);
+    result = task->result;
+    if (result != DNN_SUCCESS) {
+        av_log(&native_model->ctx, AV_LOG_ERROR, "async inference failed\n");
+        av_frame_free(&task->in_frame);
+        av_frame_free(&task->out_frame);
+    } else {
+        *in = task->in_frame;
+        *out = task->out_frame;
+    }
+    av_freep(&task);
+
+    return result == DNN_SUCCESS ? DAST_SUCCESS : DAST_FAIL;
+}
+
+DNNReturnType ff_dnn_flush_native(const DNNModel *model)
+{
+    // every task is handed to the workers when it is submitted,
+    // so there is nothing left to start here
+    return DNN_SUCCESS;
+}
+
+#define DOT_LANES 4
+
+/* a single accumulator is a serial dependency chain the compiler may not
+ * reorder, so long rows are summed in DOT_LANES independent partial sums */
+static float dot_product_c(float sum, const float *a, const float *b, int len)
+{
+    int i = 0;
+
+    if (len >= DOT_LANES) {
+        float acc[DOT_LANES] = { 0 };
+        for (; i + DOT_LANES <= len; i += DOT_LANES)
+            for (int j = 0; j < DOT_LANES; ++j)
+                acc[j] += a[i + j] * b[i + j];
+        sum += (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    }
+    for (; i < len; ++i)
+        sum += a[i] * b[i];
+
+    return sum;
+}
+
+av_cold void ff_dnn_native_dsp_init(NativeDSPContext *c)
+{
+    c->dot_product = dot_product_c;
+
+    if (ARCH_X86)
+        ff_dnn_native_dsp_init_x86(c);
+}
+
 int32_t calculate_operand_dims_count(const DnnOperand *oprd)
 {
     int32_t result = 1;
@@ -429,6 +778,10 @@ void ff_dnn_free_model_native(DNNModel **model)
     {
         if ((*model)->model) {
             native_model = (NativeModel *)(*model)->model;
+            if (native_model->workers)
+                uninit_async_native(native_model);
+            av_freep(&native_model->model_filename);
+
             if (native_model->layers) {
                 for (layer = 0; layer < native_model->layers_num; ++layer){
                     if (native_model->layers[layer].type == DLT_CONV2D){
@@ -447,6 +800,8 @@ void ff_dnn_free_model_native(DNNModel **model)
                 av_freep(&native_model->operands);
             }
 
+            avpriv_slicethread_free(&native_model->ctx.slicethread);
+
             av_freep(&native_model);
         }
         av_freep(model);
@@ -30,6 +30,10 @@
 #include "../dnn_interface.h"
 #include "libavformat/avio.h"
 #include "libavutil/opt.h"
+#include "libavutil/slicethread.h"
+#include "libavutil/thread.h"
+#include "queue.h"
+#include "safe_queue.h"
 
 /**
  * the enum value of DNNLayerType should not be changed,
@@ -109,13 +113,35 @@ typedef struct InputParams{
     int height, width, channels;
 } InputParams;
 
+typedef struct NativeDSPContext {
+    /**
+     * Return sum plus the dot product of the len floats at a and b.
+     * The order of the additions is not specified.
+     */
+    float (*dot_product)(float sum, const float *a, const float *b, int len);
+} NativeDSPContext;
+
 typedef struct NativeOptions{
     uint32_t conv2d_threads;
+    int nireq;
 } NativeOptions;
 
 typedef struct NativeContext {
     const AVClass *class;
     NativeOptions options;
+
+    /**
+     * persistent worker pool shared by all the layers of the model,
+     * created once at load time, NULL means execute serially.
+     */
+    AVSliceThread *slicethread;
+    int nb_threads;
+
+    /**
+     * the job currently dispatched to the worker pool
+     */
+    void (*job_func)(void *arg, int jobnr, int nb_jobs);
+    void *job_arg;
 } NativeContext;
 
 // Represents simple feed-forward convolutional network.
@@ -126,6 +152,19 @@ typedef struct NativeModel{
     int32_t layers_num;
     DnnOperand *operands;
     int32_t operands_num;
+
+    /* for async execution */
+    char *model_filename;
+    FFSafeQueue *pending_queue;       // holds TaskItem not yet picked by a worker
+    FFQueue *task_queue;                // holds TaskItem in submission order
+    struct NativeWorker *workers;
+    int nb_workers;
+    char *worker_options;               // options of the extra model instances
+#if HAVE_PTHREAD_CANCEL
+    pthread_mutex_t task_lock;
+    pthread_cond_t task_cond;
+#endif
+    int nb_running;                     // submitted tasks not finished yet
 } NativeModel;
 
 DNNModel *ff_dnn_load_model_native(const char *model_filename, const char *options, AVFilterContext *filter_ctx);
@@ -133,8 +172,27 @@ DNNModel *ff_dnn_load_model_native(const char *model_filename, const char *optio
 DNNReturnType ff_dnn_execute_model_native(const DNNModel *model, const char *input_name, AVFrame *in_frame,
                                           const char **output_names, uint32_t nb_output, AVFrame *out_frame);
 
+DNNReturnType ff_dnn_execute_model_async_native(const DNNModel *model, const char *input_name, AVFrame *in_frame,
+                                                const char **output_names, uint32_t nb_output, AVFrame *out_frame);
+
+DNNAsyncStatusType ff_dnn_get_async_result_native(const DNNModel *model, AVFrame **in, AVFrame **out);
+
+DNNReturnType ff_dnn_flush_native(const DNNModel *model);
+
 void ff_dnn_free_model_native(DNNModel **model);
 
+/**
+ * Run func(arg, jobnr, nb_jobs) for every jobnr in [0, nb_jobs) on the worker
+ * pool of ctx and wait for all of them to finish. nb_jobs is chosen by the
+ * pool, a job is expected to process the jobnr-th of nb_jobs equal slices
+ * of its work. ctx may be NULL, in which case func is called once with
+ * nb_jobs set to 1.
+ */
+void ff_dnn_execute_jobs_native(NativeContext *ctx, void (*func)(void *arg, int jobnr, int nb_jobs), void *arg);
+
+void ff_dnn_native_dsp_init(NativeDSPContext *c);
+void ff_dnn_native_dsp_init_x86(NativeDSPContext *c);
+
 // NOTE: User must check for error (return value <= 0) to handle
 // case like integer overflow.
 int32_t calculate_operand_data_length(const DnnOperand *oprd);
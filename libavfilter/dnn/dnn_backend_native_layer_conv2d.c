@@ -19,26 +19,22 @@
  */
 
 #include "libavutil/avassert.h"
-#include "libavutil/thread.h"
-#include "libavutil/cpu.h"
 #include "dnn_backend_native_layer_conv2d.h"
 
 #define CLAMP_TO_EDGE(x, w) ((x) < 0 ? 0 : ((x) >= (w) ? (w - 1) : (x)))
 
 //struct to pass parameters
-typedef struct thread_common_param{
-    DnnOperand *operands;
-    const int32_t *input_operand_indexes;
-    int32_t output_operand_index;
-    const void *parameters;
-    NativeContext *ctx;
+typedef struct ThreadCommonParam{
+    const ConvolutionalParams *conv_params;
+    const NativeDSPContext *dsp;
+    /* input padded by pad_size pixels on each side, see pad_input() */
+    const float *padded_input;
+    int padded_linesize;
+    int output_height, output_width;
+    /* position of the top-left tap of output pixel (0, 0) in the padded input */
+    int offset;
     float *output_data;
-} thread_common_param;
-
-typedef struct thread_param{
-    thread_common_param *thread_common_param;
-    int thread_start, thread_end;
-} thread_param;
+} ThreadCommonParam;
 
 int dnn_load_layer_conv2d(Layer *layer, AVIOContext *model_file_context, int file_size, int operands_num)
 {
@@ -105,99 +101,126 @@ int dnn_load_layer_conv2d(Layer *layer, AVIOContext *model_file_context, int fil
     return dnn_size;
 }
 
-static void * dnn_execute_layer_conv2d_thread(void *threadarg)
+/**
+ * Copy the input into a buffer with pad_size extra pixels on each side,
+ * filled according to the padding method, so that the convolution itself
+ * never needs to clamp or test coordinates.
+ */
+static float *pad_input(const float *input, int height, int width, int channel,
+                        int pad_size, DNNPaddingParam padding_method)
 {
-    //pass parameters
-    thread_param *thread_param = (struct thread_param *)threadarg;
-    thread_common_param *thread_common_param = thread_param->thread_common_param;
-    DnnOperand *operands = thread_common_param->operands;
-    int32_t input_operand_index = thread_common_param->input_operand_indexes[0];
-    int height = operands[input_operand_index].dims[1];
-    int width = operands[input_operand_index].dims[2];
-    int channel = operands[input_operand_index].dims[3];
-    const float *input = operands[input_operand_index].data;
-    const ConvolutionalParams *conv_params = (const ConvolutionalParams *)(thread_common_param->parameters);
+    int padded_width = width + 2 * pad_size;
+    int padded_linesize = padded_width * channel;
+    int src_linesize = width * channel;
+    float *padded = av_malloc_array((size_t)(height + 2 * pad_size) * padded_linesize, sizeof(*padded));
+    if (!padded)
+        return NULL;
 
-    int radius = conv_params->kernel_size >> 1;
-    int src_linesize = width * conv_params->input_num;
-    int filter_linesize = conv_params->kernel_size * conv_params->input_num;
-    int filter_size = conv_params->kernel_size * filter_linesize;
-    int pad_size = (conv_params->padding_method == VALID) ? (conv_params->kernel_size - 1) / 2 * conv_params->dilation : 0;
+    for (int y = -pad_size; y < height + pad_size; ++y) {
+        float *dst = padded + (y + pad_size) * padded_linesize;
+        const float *src;
 
-    float *output = thread_common_param->output_data;
-    output += (conv_params->output_num) * (width - 2 * pad_size) * (thread_param->thread_start - pad_size);
+        if (padding_method != SAME_CLAMP_TO_EDGE && (y < 0 || y >= height)) {
+            memset(dst, 0, padded_linesize * sizeof(*dst));
+            continue;
+        }
+        src = input + CLAMP_TO_EDGE(y, height) * src_linesize;
 
-    av_assert0(channel == conv_params->input_num);
+        for (int x = 0; x < pad_size; ++x) {
+            if (padding_method == SAME_CLAMP_TO_EDGE) {
+                memcpy(dst + x * channel, src, channel * sizeof(*dst));
+                memcpy(dst + (pad_size + width + x) * channel, src + (width - 1) * channel,
+                       channel * sizeof(*dst));
+            } else {
+                memset(dst + x * channel, 0, channel * sizeof(*dst));
+                memset(dst + (pad_size + width + x) * channel, 0, channel * sizeof(*dst));
+            }
+        }
+        memcpy(dst + pad_size * channel, src, src_linesize * sizeof(*dst));
+    }
 
-    for (int y = thread_param->thread_start; y < thread_param->thread_end; ++y) {
-        for (int x = pad_size; x < width - pad_size; ++x) {
-            for (int n_filter = 0; n_filter < conv_params->output_num; ++n_filter) {
-                if (conv_params->has_bias)
-                    output[n_filter] = conv_params->biases[n_filter];
-                else
-                    output[n_filter] = 0.f;
+    return padded;
+}
 
-                for (int ch = 0; ch < conv_params->input_num; ++ch) {
-                    for (int kernel_y = 0; kernel_y < conv_params->kernel_size; ++kernel_y) {
-                        for (int kernel_x = 0; kernel_x < conv_params->kernel_size; ++kernel_x) {
-                            float input_pel;
-                            if (conv_params->padding_method == SAME_CLAMP_TO_EDGE) {
-                                int y_pos = CLAMP_TO_EDGE(y + (kernel_y - radius) * conv_params->dilation, height);
-                                int x_pos = CLAMP_TO_EDGE(x + (kernel_x - radius) * conv_params->dilation, width);
-                                input_pel = input[y_pos * src_linesize + x_pos * conv_params->input_num + ch];
-                            } else {
-                                int y_pos = y + (kernel_y - radius) * conv_params->dilation;
-                                int x_pos = x + (kernel_x - radius) * conv_params->dilation;
-                                input_pel = (x_pos < 0 || x_pos >= width || y_pos < 0 || y_pos >= height) ? 0.0 :
-                                                   input[y_pos * src_linesize + x_pos * conv_params->input_num + ch];
-                            }
+static void dnn_execute_layer_conv2d_thread(void *arg, int jobnr, int nb_jobs)
+{
+    const ThreadCommonParam *thread_common_param = arg;
+    const ConvolutionalParams *conv_params = thread_common_param->conv_params;
+    const NativeDSPContext *dsp = thread_common_param->dsp;
+    int input_num = conv_params->input_num;
+    int output_num = conv_params->output_num;
+    int kernel_size = conv_params->kernel_size;
+    int dilation = conv_params->dilation;
+    int padded_linesize = thread_common_param->padded_linesize;
+    int filter_linesize = kernel_size * input_num;
+    int filter_size = kernel_size * filter_linesize;
+    int output_width = thread_common_param->output_width;
+    int slice_start = (thread_common_param->output_height *  jobnr     ) / nb_jobs;
+    int slice_end   = (thread_common_param->output_height * (jobnr + 1)) / nb_jobs;
+    /* with no dilation a whole kernel row is contiguous in the padded input,
+     * so it can be accumulated as a single dot product */
+    int dot_len = dilation == 1 ? filter_linesize : input_num;
+    int dot_num = dilation == 1 ? 1 : kernel_size;
+    float *output = thread_common_param->output_data + slice_start * output_width * output_num;
 
+    for (int y = slice_start; y < slice_end; ++y) {
+        const float *input_row = thread_common_param->padded_input +
+                                 (y + thread_common_param->offset) * padded_linesize +
+                                 thread_common_param->offset * input_num;
+        for (int x = 0; x < output_width; ++x) {
+            const float *input = input_row + x * input_num;
+            for (int n_filter = 0; n_filter < output_num; ++n_filter) {
+                const float *kernel = conv_params->kernel + n_filter * filter_size;
+                float sum = conv_params->has_bias ? conv_params->biases[n_filter] : 0.f;
 
-                            output[n_filter] += input_pel * conv_params->kernel[n_filter * filter_size + kernel_y * filter_linesize +
-                                                                                kernel_x * conv_params->input_num + ch];
-                        }
-                    }
+                for (int kernel_y = 0; kernel_y < kernel_size; ++kernel_y) {
+                    const float *src = input + kernel_y * dilation * padded_linesize;
+                    const float *k = kernel + kernel_y * filter_linesize;
+                    for (int i = 0; i < dot_num; ++i)
+                        sum = dsp->dot_product(sum, src + i * dilation * input_num,
+                                               k + i * input_num, dot_len);
                 }
+
                 switch (conv_params->activation){
                 case RELU:
-                    output[n_filter] = FFMAX(output[n_filter], 0.0);
+                    sum = FFMAX(sum, 0.0);
                     break;
                 case TANH:
-                    output[n_filter] = 2.0f  / (1.0f + exp(-2.0f * output[n_filter])) - 1.0f;
+                    sum = 2.0f  / (1.0f + exp(-2.0f * sum)) - 1.0f;
                     break;
                 case SIGMOID:
-                    output[n_filter] = 1.0f / (1.0f + exp(-output[n_filter]));
+                    sum = 1.0f / (1.0f + exp(-sum));
                     break;
                 case NONE:
                     break;
                 case LEAKY_RELU:
-                    output[n_filter] = FFMAX(output[n_filter], 0.0) + 0.2 * FFMIN(output[n_filter], 0.0);
+                    sum = FFMAX(sum, 0.0) + 0.2 * FFMIN(sum, 0.0);
                 }
+                output[n_filter] = sum;
             }
-            output += conv_params->output_num;
+            output += output_num;
         }
     }
-    return (void *)DNN_SUCCESS;
 }
 
 
 int dnn_execute_layer_conv2d(DnnOperand *operands, const int32_t *input_operand_indexes,
                              int32_t output_operand_index, const void *parameters, NativeContext *ctx)
 {
-    int thread_num = (ctx->options.conv2d_threads <= 0 || ctx->options.conv2d_threads > av_cpu_count())
-        ? (av_cpu_count() + 1) : (ctx->options.conv2d_threads);
-#if HAVE_PTHREAD_CANCEL
-    pthread_t *thread_id = av_malloc(thread_num * sizeof(pthread_t));
-    int thread_stride;
-#endif
-    thread_param **thread_param = av_malloc(thread_num * sizeof(*thread_param));
-    thread_common_param thread_common_param;
+    ThreadCommonParam thread_common_param;
+    NativeDSPContext dsp;
     const ConvolutionalParams *conv_params = (const ConvolutionalParams *)(parameters);
     int height = operands[input_operand_indexes[0]].dims[1];
     int width = operands[input_operand_indexes[0]].dims[2];
+    int channel = operands[input_operand_indexes[0]].dims[3];
+    int radius = conv_params->kernel_size >> 1;
     int pad_size = (conv_params->padding_method == VALID) ? (conv_params->kernel_size - 1) / 2 * conv_params->dilation : 0;
+    int border = radius * conv_params->dilation;
+    float *padded_input;
     DnnOperand *output_operand = &operands[output_operand_index];
 
+    av_assert0(channel == conv_params->input_num);
+
     output_operand->dims[0] = operands[input_operand_indexes[0]].dims[0];
     output_operand->dims[1] = height - pad_size * 2;
     output_operand->dims[2] = width - pad_size * 2;
@@ -213,44 +236,27 @@ int dnn_execute_layer_conv2d(DnnOperand *operands, const int32_t *input_operand_
         av_log(ctx, AV_LOG_ERROR, "Failed to reallocate memory for output\n");
         return DNN_ERROR;
     }
-    thread_common_param.output_data = output_operand->data;
-    thread_common_param.operands = operands;
-    thread_common_param.input_operand_indexes = input_operand_indexes;
-    thread_common_param.output_operand_index = output_operand_index;
-    thread_common_param.parameters = parameters;
-    thread_common_param.ctx = ctx;
 
-#if HAVE_PTHREAD_CANCEL
-    thread_stride = (height - pad_size * 2) / thread_num;
-    //create threads
-    for (int i = 0; i < thread_num; i++){
-        thread_param[i] = av_malloc(sizeof(**thread_param));
-        thread_param[i]->thread_common_param = &thread_common_param;
-        thread_param[i]->thread_start = thread_stride * i + pad_size;
-        thread_param[i]->thread_end = (i == thread_num - 1) ? (height - pad_size) : (thread_param[i]->thread_start + thread_stride);
-        pthread_create(&thread_id[i], NULL, dnn_execute_layer_conv2d_thread, (void *)thread_param[i]);
+    padded_input = pad_input(operands[input_operand_indexes[0]].data, height, width, channel,
+                             border, conv_params->padding_method);
+    if (!padded_input) {
+        av_log(ctx, AV_LOG_ERROR, "Failed to allocate memory for padded input\n");
+        return DNN_ERROR;
     }
 
-    //join threads, res gets function return
-    for (int i = 0; i < thread_num; i++){
-        pthread_join(thread_id[i], NULL);
-    }
+    ff_dnn_native_dsp_init(&dsp);
 
-    //release memory
-    av_free(thread_id);
+    thread_common_param.conv_params     = conv_params;
+    thread_common_param.dsp             = &dsp;
+    thread_common_param.padded_input    = padded_input;
+    thread_common_param.padded_linesize = (width + 2 * border) * channel;
+    thread_common_param.output_height   = output_operand->dims[1];
+    thread_common_param.output_width    = output_operand->dims[2];
+    thread_common_param.offset          = pad_size;
+    thread_common_param.output_data     = output_operand->data;
 
-    for (int i = 0; i < thread_num; i++){
-        av_free(thread_param[i]);
-    }
-#else
-    thread_param[0] = av_malloc(sizeof(**thread_param));
-    thread_param[0]->thread_common_param = &thread_common_param;
-    thread_param[0]->thread_start = pad_size;
-    thread_param[0]->thread_end = height - pad_size;
-    dnn_execute_layer_conv2d_thread((void *)thread_param[0]);
-    av_free(thread_param[0]);
-#endif
+    ff_dnn_execute_jobs_native(ctx, dnn_execute_layer_conv2d_thread, &thread_common_param);
 
-    av_free(thread_param);
+    av_free(padded_input);
     return DNN_SUCCESS;
 }
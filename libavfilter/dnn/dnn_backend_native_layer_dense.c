@@ -82,19 +82,65 @@ int dnn_load_layer_dense(Layer *layer, AVIOContext *model_file_context, int file
     return dnn_size;
 }
 
+typedef struct ThreadCommonParam{
+    const DenseParams *dense_params;
+    const NativeDSPContext *dsp;
+    const float *input;
+    float *output;
+    int nb_pixels;
+} ThreadCommonParam;
+
+static void dnn_execute_layer_dense_thread(void *arg, int jobnr, int nb_jobs)
+{
+    const ThreadCommonParam *thread_common_param = arg;
+    const DenseParams *dense_params = thread_common_param->dense_params;
+    int slice_start = (thread_common_param->nb_pixels *  jobnr     ) / nb_jobs;
+    int slice_end   = (thread_common_param->nb_pixels * (jobnr + 1)) / nb_jobs;
+    const float *input = thread_common_param->input + slice_start * dense_params->input_num;
+    float *output = thread_common_param->output + slice_start * dense_params->output_num;
+
+    for (int i = slice_start; i < slice_end; ++i) {
+        for (int n_filter = 0; n_filter < dense_params->output_num; ++n_filter) {
+            const float *kernel = dense_params->kernel + n_filter * dense_params->input_num;
+            float sum = dense_params->has_bias ? dense_params->biases[n_filter] : 0.f;
+
+            sum = thread_common_param->dsp->dot_product(sum, input, kernel,
+                                                        dense_params->input_num);
+
+            switch (dense_params->activation){
+            case RELU:
+                sum = FFMAX(sum, 0.0);
+                break;
+            case TANH:
+                sum = 2.0f  / (1.0f + exp(-2.0f * sum)) - 1.0f;
+                break;
+            case SIGMOID:
+                sum = 1.0f / (1.0f + exp(-sum));
+                break;
+            case NONE:
+                break;
+            case LEAKY_RELU:
+                sum = FFMAX(sum, 0.0) + 0.2 * FFMIN(sum, 0.0);
+            }
+            output[n_filter] = sum;
+        }
+        input  += dense_params->input_num;
+        output += dense_params->output_num;
+    }
+}
+
 int dnn_execute_layer_dense(DnnOperand *operands, const int32_t *input_operand_indexes,
                              int32_t output_operand_index, const void *parameters, NativeContext *ctx)
 {
-    float *output;
+    ThreadCommonParam thread_common_param;
+    NativeDSPContext dsp;
     int32_t input_operand_index = input_operand_indexes[0];
     int number = operands[input_operand_index].dims[0];
     int height = operands[input_operand_index].dims[1];
     int width = operands[input_operand_index].dims[2];
     int channel = operands[input_operand_index].dims[3];
-    const float *input = operands[input_operand_index].data;
     const DenseParams *dense_params = (const DenseParams *)parameters;
 
-    int src_linesize = width * channel;
     DnnOperand *output_operand = &operands[output_operand_index];
     output_operand->dims[0] = number;
     output_operand->dims[1] = height;
@@ -111,41 +157,18 @@ int dnn_execute_layer_dense(DnnOperand *operands, const int32_t *input_operand_i
         av_log(ctx, AV_LOG_ERROR, "Failed to reallocate memory for output\n");
         return DNN_ERROR;
     }
-    output = output_operand->data;
 
     av_assert0(channel == dense_params->input_num);
 
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            for (int n_filter = 0; n_filter < dense_params->output_num; ++n_filter) {
-                if (dense_params->has_bias)
-                    output[n_filter] = dense_params->biases[n_filter];
-                else
-                    output[n_filter] = 0.f;
-
-                for (int ch = 0; ch < dense_params->input_num; ++ch) {
-                    float input_pel;
-                    input_pel = input[y * src_linesize + x * dense_params->input_num + ch];
-                    output[n_filter] += input_pel * dense_params->kernel[n_filter*dense_params->input_num + ch];
-                }
-                switch (dense_params->activation){
-                case RELU:
-                    output[n_filter] = FFMAX(output[n_filter], 0.0);
-                    break;
-                case TANH:
-                    output[n_filter] = 2.0f  / (1.0f + exp(-2.0f * output[n_filter])) - 1.0f;
-                    break;
-                case SIGMOID:
-                    output[n_filter] = 1.0f / (1.0f + exp(-output[n_filter]));
-                    break;
-                case NONE:
-                    break;
-                case LEAKY_RELU:
-                    output[n_filter] = FFMAX(output[n_filter], 0.0) + 0.2 * FFMIN(output[n_filter], 0.0);
-                }
-            }
-            output += dense_params->output_num;
-        }
-    }
+    ff_dnn_native_dsp_init(&dsp);
+
+    thread_common_param.dense_params = dense_params;
+    thread_common_param.dsp          = &dsp;
+    thread_common_param.input        = operands[input_operand_index].data;
+    thread_common_param.output       = output_operand->data;
+    thread_common_param.nb_pixels    = height * width;
+
+    ff_dnn_execute_jobs_native(ctx, dnn_execute_layer_dense_thread, &thread_common_param);
+
     return 0;
 }
@@ -49,10 +49,43 @@ int dnn_load_layer_depth2space(Layer *layer, AVIOContext *model_file_context, in
     return dnn_size;
 }
 
+typedef struct ThreadCommonParam{
+    const float *input;
+    float *output;
+    int height, width, channels;
+    int block_size;
+} ThreadCommonParam;
+
+static void dnn_execute_layer_depth2space_thread(void *arg, int jobnr, int nb_jobs)
+{
+    const ThreadCommonParam *p = arg;
+    int block_size = p->block_size;
+    int new_channels = p->channels / (block_size * block_size);
+    int output_linesize = p->width * p->channels;
+    int by_linesize = output_linesize / block_size;
+    int x_linesize = new_channels * block_size;
+    int slice_start = (p->height *  jobnr     ) / nb_jobs;
+    int slice_end   = (p->height * (jobnr + 1)) / nb_jobs;
+    const float *input = p->input + slice_start * output_linesize;
+    float *output = p->output + slice_start * output_linesize;
+
+    for (int y = slice_start; y < slice_end; ++y){
+        for (int x = 0; x < p->width; ++x){
+            for (int by = 0; by < block_size; ++by){
+                /* each block row is a contiguous run of the output line */
+                memcpy(output + by * by_linesize + x * x_linesize, input,
+                       x_linesize * sizeof(*output));
+                input += x_linesize;
+            }
+        }
+        output += output_linesize;
+    }
+}
+
 int dnn_execute_layer_depth2space(DnnOperand *operands, const int32_t *input_operand_indexes,
                                   int32_t output_operand_index, const void *parameters, NativeContext *ctx)
 {
-    float *output;
+    ThreadCommonParam thread_common_param;
     const DepthToSpaceParams *params = (const DepthToSpaceParams *)parameters;
     int block_size = params->block_size;
     int32_t input_operand_index = input_operand_indexes[0];
@@ -60,13 +93,7 @@ int dnn_execute_layer_depth2space(DnnOperand *operands, const int32_t *input_ope
     int height = operands[input_operand_index].dims[1];
     int width = operands[input_operand_index].dims[2];
     int channels = operands[input_operand_index].dims[3];
-    const float *input = operands[input_operand_index].data;
-
-    int y, x, by, bx, ch;
     int new_channels = channels / (block_size * block_size);
-    int output_linesize = width * channels;
-    int by_linesize = output_linesize / block_size;
-    int x_linesize = new_channels * block_size;
 
     DnnOperand *output_operand = &operands[output_operand_index];
     output_operand->dims[0] = number;
@@ -84,20 +111,15 @@ int dnn_execute_layer_depth2space(DnnOperand *operands, const int32_t *input_ope
         av_log(ctx, AV_LOG_ERROR, "Failed to reallocate memory for output\n");
         return DNN_ERROR;
     }
-    output = output_operand->data;
 
-    for (y = 0; y < height; ++y){
-        for (x = 0; x < width; ++x){
-            for (by = 0; by < block_size; ++by){
-                for (bx = 0; bx < block_size; ++bx){
-                    for (ch = 0; ch < new_channels; ++ch){
-                        output[by * by_linesize + x * x_linesize + bx * new_channels + ch] = input[ch];
-                    }
-                    input += new_channels;
-                }
-            }
-        }
-        output += output_linesize;
-    }
+    thread_common_param.input      = operands[input_operand_index].data;
+    thread_common_param.output     = output_operand->data;
+    thread_common_param.height     = height;
+    thread_common_param.width      = width;
+    thread_common_param.channels   = channels;
+    thread_common_param.block_size = block_size;
+
+    ff_dnn_execute_jobs_native(ctx, dnn_execute_layer_depth2space_thread, &thread_common_param);
+
     return 0;
 }
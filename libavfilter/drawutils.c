@@ -602,6 +602,20 @@ static void blend_line_hv(uint8_t *dst, int dst_delta,
 {
     int x;
 
+    if (!hsub && !vsub && l2depth == 3) {
+        /* one 8-bit mask value per pixel: no averaging needed, and
+           transparent mask pixels (most of a glyph box) leave dst as is */
+        mask += xm;
+        for (x = 0; x < w; x++) {
+            if (mask[x]) {
+                unsigned a = mask[x] * alpha;
+                *dst = ((0x1010101 - a) * *dst + a * src) >> 24;
+            }
+            dst += dst_delta;
+        }
+        return;
+    }
+
     if (left) {
         blend_pixel(dst, src, alpha, mask, mask_linesize, l2depth,
                     left, hband, hsub + vsub, xm);
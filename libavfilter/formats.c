@@ -93,16 +93,53 @@ do {                                                                       \
     MERGE_REF(a, b, fmts, type, return AVERROR(ENOMEM););                  \
 } while (0)
 
+/* pixel and sample formats are small non-negative integers, so format
+ * lists can be intersected in linear time through a bitset */
+#define FMT_SET_SIZE  FFALIGN(FFMAX((int)AV_PIX_FMT_NB, (int)AV_SAMPLE_FMT_NB), 64)
+
+typedef struct FormatSet {
+    uint64_t bits[FMT_SET_SIZE / 64];
+    const AVFilterFormats *list;
+} FormatSet;
+
+static void format_set_init(FormatSet *set, const AVFilterFormats *list)
+{
+    int i;
+
+    memset(set->bits, 0, sizeof(set->bits));
+    set->list = list;
+    for (i = 0; i < list->nb_formats; i++) {
+        unsigned fmt = list->formats[i];
+        if (fmt < FMT_SET_SIZE)
+            set->bits[fmt >> 6] |= 1ULL << (fmt & 63);
+    }
+}
+
+static int format_set_has(const FormatSet *set, int fmt)
+{
+    int i;
+
+    if ((unsigned)fmt < FMT_SET_SIZE)
+        return !!(set->bits[fmt >> 6] & (1ULL << (fmt & 63)));
+
+    /* out of range values are not in the bitset, look them up in the list */
+    for (i = 0; i < set->list->nb_formats; i++)
+        if (set->list->formats[i] == fmt)
+            return 1;
+    return 0;
+}
+
 static int merge_formats_internal(AVFilterFormats *a, AVFilterFormats *b,
                                   enum AVMediaType type, int check)
 {
-    int i, j;
-    int alpha1=0, alpha2=0;
-    int chroma1=0, chroma2=0;
+    FormatSet set_b;
+    int i, k = 0;
 
     if (a == b)
         return 1;
 
+    format_set_init(&set_b, b);
+
     /* Do not lose chroma or alpha in merging.
        It happens if both lists have formats with chroma (resp. alpha), but
        the only formats in common do not have it (e.g. YUV+gray vs.
@@ -110,24 +147,48 @@ static int merge_formats_internal(AVFilterFormats *a, AVFilterFormats *b,
        possibly causing a lossy conversion elsewhere in the graph.
        To avoid that, pretend that there are no common formats to force the
        insertion of a conversion filter. */
-    if (type == AVMEDIA_TYPE_VIDEO)
-        for (i = 0; i < a->nb_formats; i++)
-            for (j = 0; j < b->nb_formats; j++) {
-                const AVPixFmtDescriptor *adesc = av_pix_fmt_desc_get(a->formats[i]);
-                const AVPixFmtDescriptor *bdesc = av_pix_fmt_desc_get(b->formats[j]);
-                alpha2 |= adesc->flags & bdesc->flags & AV_PIX_FMT_FLAG_ALPHA;
-                chroma2|= adesc->nb_components > 1 && bdesc->nb_components > 1;
-                if (a->formats[i] == b->formats[j]) {
-                    alpha1 |= adesc->flags & AV_PIX_FMT_FLAG_ALPHA;
-                    chroma1|= adesc->nb_components > 1;
-                }
+    if (type == AVMEDIA_TYPE_VIDEO) {
+        int alpha_a = 0, alpha_b = 0, alpha_common = 0;
+        int chroma_a = 0, chroma_b = 0, chroma_common = 0;
+
+        for (i = 0; i < b->nb_formats; i++) {
+            const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(b->formats[i]);
+            alpha_b  |= !!(desc->flags & AV_PIX_FMT_FLAG_ALPHA);
+            chroma_b |= desc->nb_components > 1;
+        }
+        for (i = 0; i < a->nb_formats; i++) {
+            const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(a->formats[i]);
+            int alpha  = !!(desc->flags & AV_PIX_FMT_FLAG_ALPHA);
+            int chroma = desc->nb_components > 1;
+            alpha_a  |= alpha;
+            chroma_a |= chroma;
+            if (format_set_has(&set_b, a->formats[i])) {
+                alpha_common  |= alpha;
+                chroma_common |= chroma;
             }
+        }
+
+        // If chroma or alpha can be lost through merging then do not merge
+        if ((alpha_a && alpha_b && !alpha_common) ||
+            (chroma_a && chroma_b && !chroma_common))
+            return 0;
+    }
 
-    // If chroma or alpha can be lost through merging then do not merge
-    if (alpha2 > alpha1 || chroma2 > chroma1)
+    for (i = 0; i < a->nb_formats; i++) {
+        if (format_set_has(&set_b, a->formats[i])) {
+            if (check)
+                return 1;
+            a->formats[k++] = a->formats[i];
+        }
+    }
+    /* Check that there was at least one common format.
+     * Notice that both a and b are unchanged if not. */
+    if (!k)
         return 0;
+    av_assert2(!check);
+    a->nb_formats = k;
 
-    MERGE_FORMATS(a, b, formats, nb_formats, AVFilterFormats, check, 0);
+    MERGE_REF(a, b, formats, AVFilterFormats, return AVERROR(ENOMEM););
 
     return 1;
 }
@@ -345,24 +406,24 @@ int ff_add_channel_layout(AVFilterChannelLayouts **l, uint64_t channel_layout)
 
 AVFilterFormats *ff_all_formats(enum AVMediaType type)
 {
-    AVFilterFormats *ret = NULL;
+    int fmts[FFMAX((int)AV_PIX_FMT_NB, (int)AV_SAMPLE_FMT_NB) + 1];
+    int nb_fmts = 0;
 
+    /* build the whole list at once instead of growing it format by format */
     if (type == AVMEDIA_TYPE_VIDEO) {
         const AVPixFmtDescriptor *desc = NULL;
-        while ((desc = av_pix_fmt_desc_next(desc))) {
-            if (ff_add_format(&ret, av_pix_fmt_desc_get_id(desc)) < 0)
-                return NULL;
-        }
+        while ((desc = av_pix_fmt_desc_next(desc)) && nb_fmts < FF_ARRAY_ELEMS(fmts) - 1)
+            fmts[nb_fmts++] = av_pix_fmt_desc_get_id(desc);
     } else if (type == AVMEDIA_TYPE_AUDIO) {
         enum AVSampleFormat fmt = 0;
-        while (av_get_sample_fmt_name(fmt)) {
-            if (ff_add_format(&ret, fmt) < 0)
-                return NULL;
-            fmt++;
-        }
+        while (av_get_sample_fmt_name(fmt) && nb_fmts < FF_ARRAY_ELEMS(fmts) - 1)
+            fmts[nb_fmts++] = fmt++;
+    } else {
+        return NULL;
     }
+    fmts[nb_fmts] = -1;
 
-    return ret;
+    return nb_fmts ? ff_make_format_list(fmts) : NULL;
 }
 
 int ff_formats_pixdesc_filter(AVFilterFormats **rfmts, unsigned want, unsigned rej)
@@ -401,6 +401,31 @@ static int flush_frame(AVFilterLink *outlink, int64_t pts, int64_t *out_pts)
     return 0;
 }
 
+/* send the frames whose inference is done, in submission order */
+static int output_async_results(AVFilterLink *outlink, int *got_frame)
+{
+    DnnProcessingContext *ctx = outlink->src->priv;
+    DNNAsyncStatusType async_state;
+    int ret;
+
+    do {
+        AVFrame *in_frame = NULL;
+        AVFrame *out_frame = NULL;
+        async_state = (ctx->dnn_module->get_async_result)(ctx->model, &in_frame, &out_frame);
+        if (out_frame) {
+            if (isPlanarYUV(in_frame->format))
+                copy_uv_planes(ctx, out_frame, in_frame);
+            av_frame_free(&in_frame);
+            ret = ff_filter_frame(outlink, out_frame);
+            if (ret < 0)
+                return ret;
+            *got_frame = 1;
+        }
+    } while (async_state == DAST_SUCCESS);
+
+    return async_state == DAST_FAIL ? AVERROR(EIO) : 0;
+}
+
 static int activate_async(AVFilterContext *filter_ctx)
 {
     AVFilterLink *inlink = filter_ctx->inputs[0];
@@ -408,14 +433,14 @@ static int activate_async(AVFilterContext *filter_ctx)
     DnnProcessingContext *ctx = (DnnProcessingContext *)filter_ctx->priv;
     AVFrame *in = NULL, *out = NULL;
     int64_t pts;
-    int ret, status;
+    int ret, err, status;
     int got_frame = 0;
-    int async_state;
 
     FF_FILTER_FORWARD_STATUS_BACK(outlink, inlink);
 
     do {
-        // drain all input frames
+        // submit the input frames, and send the results as soon as they are
+        // ready rather than once the input is drained
         ret = ff_inlink_consume_frame(inlink, &in);
         if (ret < 0)
             return ret;
@@ -431,23 +456,11 @@ static int activate_async(AVFilterContext *filter_ctx)
                 return AVERROR(EIO);
             }
         }
-    } while (ret > 0);
 
-    // drain all processed frames
-    do {
-        AVFrame *in_frame = NULL;
-        AVFrame *out_frame = NULL;
-        async_state = (ctx->dnn_module->get_async_result)(ctx->model, &in_frame, &out_frame);
-        if (out_frame) {
-            if (isPlanarYUV(in_frame->format))
-                copy_uv_planes(ctx, out_frame, in_frame);
-            av_frame_free(&in_frame);
-            ret = ff_filter_frame(outlink, out_frame);
-            if (ret < 0)
-                return ret;
-            got_frame = 1;
-        }
-    } while (async_state == DAST_SUCCESS);
+        err = output_async_results(outlink, &got_frame);
+        if (err < 0)
+            return err;
+    } while (ret > 0);
 
     // if frame got, schedule to next filter
     if (got_frame)
@@ -153,8 +153,10 @@ typedef struct DrawTextContext {
     uint8_t *fontcolor_expr;        ///< fontcolor expression to evaluate
     AVBPrint expanded_fontcolor;    ///< used to contain the expanded fontcolor spec
     int ft_load_flags;              ///< flags used for loading fonts, see FT_LOAD_*
-    FT_Vector *positions;           ///< positions for each element in the text
+    FT_Vector *positions;           ///< positions of the glyphs to draw
+    struct Glyph **drawn_glyphs;    ///< glyphs to draw, in text order
     size_t nb_positions;            ///< number of elements of positions array
+    int nb_drawn_glyphs;            ///< number of glyphs to draw
     char *textfile;                 ///< file with text to be drawn
     int x;                          ///< x position to start drawing text
     int y;                          ///< y position to start drawing text
@@ -811,6 +813,7 @@ static av_cold void uninit(AVFilterContext *ctx)
     s->x_pexpr = s->y_pexpr = s->a_pexpr = s->fontsize_pexpr = NULL;
 
     av_freep(&s->positions);
+    av_freep(&s->drawn_glyphs);
     s->nb_positions = 0;
 
     av_tree_enumerate(s->glyphs, NULL, NULL, glyph_enu_free);
@@ -1213,52 +1216,91 @@ static int expand_text(AVFilterContext *ctx, char *text, AVBPrint *bp)
     return 0;
 }
 
-static int draw_glyphs(DrawTextContext *s, AVFrame *frame,
-                       int width, int height,
-                       FFDrawColor *color,
-                       int x, int y, int borderw)
+typedef struct ThreadData {
+    AVFrame *frame;
+    int width, height;
+    int y_start, y_end;             ///< rows of the frame covered by the text
+    int align;                      ///< slice boundary alignment, in rows
+    int box_w, box_h;
+    FFDrawColor *fontcolor;
+    FFDrawColor *shadowcolor;
+    FFDrawColor *bordercolor;
+    FFDrawColor *boxcolor;
+} ThreadData;
+
+static void draw_glyphs(DrawTextContext *s, uint8_t *data[], int linesize[],
+                        int width, int height,
+                        FFDrawColor *color,
+                        int x, int y, int borderw)
 {
-    char *text = s->expanded_text.str;
-    uint32_t code = 0;
     int i, x1, y1;
-    uint8_t *p;
-    Glyph *glyph = NULL;
-
-    for (i = 0, p = text; *p; i++) {
-        FT_Bitmap bitmap;
-        Glyph dummy = { 0 };
-        GET_UTF8(code, *p ? *p++ : 0, code = 0xfffd; goto continue_on_invalid;);
-continue_on_invalid:
-
-        /* skip new line chars, just go to new line */
-        if (code == '\n' || code == '\r' || code == '\t')
-            continue;
-
-        dummy.code = code;
-        dummy.fontsize = s->fontsize;
-        glyph = av_tree_find(s->glyphs, &dummy, glyph_cmp, NULL);
-
-        bitmap = borderw ? glyph->border_bitmap : glyph->bitmap;
 
-        if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
-            glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
-            return AVERROR(EINVAL);
+    for (i = 0; i < s->nb_drawn_glyphs; i++) {
+        const Glyph *glyph = s->drawn_glyphs[i];
+        const FT_Bitmap *bitmap = borderw ? &glyph->border_bitmap : &glyph->bitmap;
 
         x1 = s->positions[i].x+s->x+x - borderw;
         y1 = s->positions[i].y+s->y+y - borderw;
 
+        /* the mask is entirely outside of this slice */
+        if (y1 >= height || y1 + (int)bitmap->rows <= 0)
+            continue;
+
         ff_blend_mask(&s->dc, color,
-                      frame->data, frame->linesize, width, height,
-                      bitmap.buffer, bitmap.pitch,
-                      bitmap.width, bitmap.rows,
-                      bitmap.pixel_mode == FT_PIXEL_MODE_MONO ? 0 : 3,
+                      data, linesize, width, height,
+                      bitmap->buffer, bitmap->pitch,
+                      bitmap->width, bitmap->rows,
+                      bitmap->pixel_mode == FT_PIXEL_MODE_MONO ? 0 : 3,
                       0, x1, y1);
     }
+}
+
+/**
+ * Blend the box, shadow, border and text over one horizontal band of the
+ * text area. Bands start on a multiple of the chroma subsampling so that
+ * every chroma row is owned by exactly one job, which keeps the output
+ * identical to drawing the whole frame at once.
+ */
+static int draw_text_slice(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    DrawTextContext *s = ctx->priv;
+    ThreadData *td = arg;
+    AVFrame *frame = td->frame;
+    const int nb_units = (td->y_end - td->y_start + td->align - 1) / td->align;
+    const int slice_start = td->y_start + nb_units *  jobnr      / nb_jobs * td->align;
+    const int slice_end   = FFMIN(td->y_start + nb_units * (jobnr + 1) / nb_jobs * td->align,
+                                  td->height);
+    const int h = slice_end - slice_start;
+    uint8_t *data[4] = { NULL };
+    int plane;
+
+    if (h <= 0)
+        return 0;
+
+    for (plane = 0; plane < s->dc.nb_planes; plane++)
+        data[plane] = frame->data[plane] +
+                      (slice_start >> s->dc.vsub[plane]) * frame->linesize[plane];
+
+    if (s->draw_box)
+        ff_blend_rectangle(&s->dc, td->boxcolor,
+                           data, frame->linesize, td->width, h,
+                           s->x - s->boxborderw, s->y - s->boxborderw - slice_start,
+                           td->box_w + s->boxborderw * 2, td->box_h + s->boxborderw * 2);
+
+    if (s->shadowx || s->shadowy)
+        draw_glyphs(s, data, frame->linesize, td->width, h,
+                    td->shadowcolor, s->shadowx, s->shadowy - slice_start, 0);
+
+    if (s->borderw)
+        draw_glyphs(s, data, frame->linesize, td->width, h,
+                    td->bordercolor, 0, -slice_start, s->borderw);
+
+    draw_glyphs(s, data, frame->linesize, td->width, h,
+                td->fontcolor, 0, -slice_start, 0);
 
     return 0;
 }
 
-
 static void update_color_with_alpha(DrawTextContext *s, FFDrawColor *color, const FFDrawColor incolor)
 {
     *color = incolor;
@@ -1307,6 +1349,8 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
     FFDrawColor shadowcolor;
     FFDrawColor bordercolor;
     FFDrawColor boxcolor;
+    ThreadData td;
+    int nb_jobs;
 
     av_bprint_clear(bp);
 
@@ -1341,6 +1385,9 @@ static int draw_text(AVFilterContext *ctx, AVFrame *frame,
         if (!(s->positions =
               av_realloc(s->positions, len*sizeof(*s->positions))))
             return AVERROR(ENOMEM);
+        if (!(s->drawn_glyphs =
+              av_realloc(s->drawn_glyphs, len*sizeof(*s->drawn_glyphs))))
+            return AVERROR(ENOMEM);
         s->nb_positions = len;
     }
 
@@ -1389,6 +1436,7 @@ continue_on_invalid:
 
     /* compute and save position for each glyph */
     glyph = NULL;
+    s->nb_drawn_glyphs = 0;
     for (i = 0, p = text; *p; i++) {
         GET_UTF8(code, *p ? *p++ : 0, code = 0xfffd; goto continue_on_invalid2;);
 continue_on_invalid2:
@@ -1420,8 +1468,15 @@ continue_on_invalid2:
         }
 
         /* save position */
-        s->positions[i].x = x + glyph->bitmap_left;
-        s->positions[i].y = y - glyph->bitmap_top + y_max;
+        if (code != '\t') {
+            if (glyph->bitmap.pixel_mode != FT_PIXEL_MODE_MONO &&
+                glyph->bitmap.pixel_mode != FT_PIXEL_MODE_GRAY)
+                return AVERROR(EINVAL);
+            s->drawn_glyphs[s->nb_drawn_glyphs] = glyph;
+            s->positions[s->nb_drawn_glyphs].x = x + glyph->bitmap_left;
+            s->positions[s->nb_drawn_glyphs].y = y - glyph->bitmap_top + y_max;
+            s->nb_drawn_glyphs++;
+        }
         if (code == '\t') x  = (x / s->tabsize + 1)*s->tabsize;
         else              x += glyph->advance;
     }
@@ -1478,27 +1533,47 @@ continue_on_invalid2:
             s->y = FFMAX(height - box_h - offsetbottom, 0);
     }
 
-    /* draw box */
-    if (s->draw_box)
-        ff_blend_rectangle(&s->dc, &boxcolor,
-                           frame->data, frame->linesize, width, height,
-                           s->x - s->boxborderw, s->y - s->boxborderw,
-                           box_w + s->boxborderw * 2, box_h + s->boxborderw * 2);
-
-    if (s->shadowx || s->shadowy) {
-        if ((ret = draw_glyphs(s, frame, width, height,
-                               &shadowcolor, s->shadowx, s->shadowy, 0)) < 0)
-            return ret;
+    /* find the rows touched by the box and the glyphs */
+    td.y_start = INT_MAX;
+    td.y_end   = INT_MIN;
+    if (s->draw_box) {
+        td.y_start = s->y - s->boxborderw;
+        td.y_end   = s->y + box_h + s->boxborderw;
     }
-
-    if (s->borderw) {
-        if ((ret = draw_glyphs(s, frame, width, height,
-                               &bordercolor, 0, 0, s->borderw)) < 0)
-            return ret;
+    for (i = 0; i < s->nb_drawn_glyphs; i++) {
+        const Glyph *g = s->drawn_glyphs[i];
+        int y0 = s->positions[i].y + s->y;
+
+        td.y_start = FFMIN(td.y_start, y0);
+        td.y_end   = FFMAX(td.y_end,   y0 + (int)g->bitmap.rows);
+        if (s->shadowx || s->shadowy) {
+            td.y_start = FFMIN(td.y_start, y0 + s->shadowy);
+            td.y_end   = FFMAX(td.y_end,   y0 + s->shadowy + (int)g->bitmap.rows);
+        }
+        if (s->borderw) {
+            td.y_start = FFMIN(td.y_start, y0 - s->borderw);
+            td.y_end   = FFMAX(td.y_end,   y0 - s->borderw + (int)g->border_bitmap.rows);
+        }
     }
-    if ((ret = draw_glyphs(s, frame, width, height,
-                           &fontcolor, 0, 0, 0)) < 0)
-        return ret;
+
+    td.align   = 1 << s->dc.vsub_max;
+    td.y_start = FFMAX(td.y_start, 0) & ~(td.align - 1);
+    td.y_end   = FFMIN(td.y_end, height);
+    if (td.y_start >= td.y_end)
+        return 0;
+
+    td.frame       = frame;
+    td.width       = width;
+    td.height      = height;
+    td.box_w       = box_w;
+    td.box_h       = box_h;
+    td.fontcolor   = &fontcolor;
+    td.shadowcolor = &shadowcolor;
+    td.bordercolor = &bordercolor;
+    td.boxcolor    = &boxcolor;
+    nb_jobs = FFMIN(ff_filter_get_nb_threads(ctx),
+                    (td.y_end - td.y_start + td.align - 1) / td.align);
+    ctx->internal->execute(ctx, draw_text_slice, &td, NULL, nb_jobs);
 
     return 0;
 }
@@ -1574,5 +1649,5 @@ AVFilter ff_vf_drawtext = {
     .inputs        = avfilter_vf_drawtext_inputs,
     .outputs       = avfilter_vf_drawtext_outputs,
     .process_command = command,
-    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC,
+    .flags         = AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC | AVFILTER_FLAG_SLICE_THREADS,
 };
@@ -345,33 +345,36 @@ static int query_formats(AVFilterContext *ctx)
 {
     AVFilterFormats *formats;
     enum AVPixelFormat pix_fmt;
-    int ret;
+    int pix_fmts[AV_PIX_FMT_NB + 1];
+    int nb_pix_fmts, ret;
 
     if (ctx->inputs[0]) {
         const AVPixFmtDescriptor *desc = NULL;
-        formats = NULL;
+        nb_pix_fmts = 0;
         while ((desc = av_pix_fmt_desc_next(desc))) {
             pix_fmt = av_pix_fmt_desc_get_id(desc);
-            if ((sws_isSupportedInput(pix_fmt) ||
-                 sws_isSupportedEndiannessConversion(pix_fmt))
-                && (ret = ff_add_format(&formats, pix_fmt)) < 0) {
-                return ret;
-            }
+            if (sws_isSupportedInput(pix_fmt) ||
+                sws_isSupportedEndiannessConversion(pix_fmt))
+                pix_fmts[nb_pix_fmts++] = pix_fmt;
         }
+        pix_fmts[nb_pix_fmts] = AV_PIX_FMT_NONE;
+        if (!(formats = ff_make_format_list(pix_fmts)))
+            return AVERROR(ENOMEM);
         if ((ret = ff_formats_ref(formats, &ctx->inputs[0]->outcfg.formats)) < 0)
             return ret;
     }
     if (ctx->outputs[0]) {
         const AVPixFmtDescriptor *desc = NULL;
-        formats = NULL;
+        nb_pix_fmts = 0;
         while ((desc = av_pix_fmt_desc_next(desc))) {
             pix_fmt = av_pix_fmt_desc_get_id(desc);
-            if ((sws_isSupportedOutput(pix_fmt) || pix_fmt == AV_PIX_FMT_PAL8 ||
-                 sws_isSupportedEndiannessConversion(pix_fmt))
-                && (ret = ff_add_format(&formats, pix_fmt)) < 0) {
-                return ret;
-            }
+            if (sws_isSupportedOutput(pix_fmt) || pix_fmt == AV_PIX_FMT_PAL8 ||
+                sws_isSupportedEndiannessConversion(pix_fmt))
+                pix_fmts[nb_pix_fmts++] = pix_fmt;
         }
+        pix_fmts[nb_pix_fmts] = AV_PIX_FMT_NONE;
+        if (!(formats = ff_make_format_list(pix_fmts)))
+            return AVERROR(ENOMEM);
         if ((ret = ff_formats_ref(formats, &ctx->outputs[0]->incfg.formats)) < 0)
             return ret;
     }
@@ -0,0 +1,101 @@
+/*
+ * DNN native backend, x86 optimized functions
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/asm.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/dnn/dnn_backend_native.h"
+
+#if HAVE_FMA3_INLINE
+
+/* The multiple of 8 floats is handled with four ymm accumulators, 32 floats
+ * per iteration while there are enough, then 8 at a time into the first one.
+ * The index runs from -bytes up to 0 against the end of both arrays. */
+static float dot_product_fma3(float sum, const float *a, const float *b, int len)
+{
+    int n = len & ~7;
+    x86_reg i = -(x86_reg)n * 4;
+    float v;
+
+    if (n) {
+        __asm__ volatile(
+            "vxorps          %%ymm0, %%ymm0, %%ymm0         \n\t"
+            "vxorps          %%ymm1, %%ymm1, %%ymm1         \n\t"
+            "vxorps          %%ymm2, %%ymm2, %%ymm2         \n\t"
+            "vxorps          %%ymm3, %%ymm3, %%ymm3         \n\t"
+            "add               $128, %0                     \n\t"
+            "jg                  2f                         \n\t"
+            "1:                                             \n\t"
+            "vmovups   -128(%2, %0), %%ymm4                 \n\t"
+            "vmovups    -96(%2, %0), %%ymm5                 \n\t"
+            "vmovups    -64(%2, %0), %%ymm6                 \n\t"
+            "vmovups    -32(%2, %0), %%ymm7                 \n\t"
+            "vfmadd231ps -128(%3, %0), %%ymm4, %%ymm0       \n\t"
+            "vfmadd231ps  -96(%3, %0), %%ymm5, %%ymm1       \n\t"
+            "vfmadd231ps  -64(%3, %0), %%ymm6, %%ymm2       \n\t"
+            "vfmadd231ps  -32(%3, %0), %%ymm7, %%ymm3       \n\t"
+            "add               $128, %0                     \n\t"
+            "jle                 1b                         \n\t"
+            "2:                                             \n\t"
+            "sub               $128, %0                     \n\t"
+            "jz                  4f                         \n\t"
+            "3:                                             \n\t"
+            "vmovups        (%2, %0), %%ymm4                \n\t"
+            "vfmadd231ps    (%3, %0), %%ymm4, %%ymm0        \n\t"
+            "add                $32, %0                     \n\t"
+            "jl                  3b                         \n\t"
+            "4:                                             \n\t"
+            "vaddps          %%ymm1, %%ymm0, %%ymm0         \n\t"
+            "vaddps          %%ymm3, %%ymm2, %%ymm2         \n\t"
+            "vaddps          %%ymm2, %%ymm0, %%ymm0         \n\t"
+            "vextractf128        $1, %%ymm0, %%xmm1         \n\t"
+            "vaddps          %%xmm1, %%xmm0, %%xmm0         \n\t"
+            "vmovhlps        %%xmm0, %%xmm0, %%xmm1         \n\t"
+            "vaddps          %%xmm1, %%xmm0, %%xmm0         \n\t"
+            "vmovshdup       %%xmm0, %%xmm1                 \n\t"
+            "vaddss          %%xmm1, %%xmm0, %%xmm0         \n\t"
+            "vmovss          %%xmm0, %1                     \n\t"
+            "vzeroupper                                     \n\t"
+            : "+r"(i), "=m"(v)
+            : "r"(a + n), "r"(b + n)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                           "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+              "memory"
+        );
+        sum += v;
+    }
+    for (; n < len; n++)
+        sum += a[n] * b[n];
+
+    return sum;
+}
+
+#endif /* HAVE_FMA3_INLINE */
+
+av_cold void ff_dnn_native_dsp_init_x86(NativeDSPContext *c)
+{
+#if HAVE_FMA3_INLINE
+    int cpu_flags = av_get_cpu_flags();
+
+    if (INLINE_FMA3(cpu_flags))
+        c->dot_product = dot_product_fma3;
+#endif /* HAVE_FMA3_INLINE */
+}
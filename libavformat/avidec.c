@@ -1581,7 +1581,7 @@ static int avi_read_idx1(AVFormatContext *s, int size)
     int64_t last_pos = -1;
     unsigned last_idx = -1;
     int64_t idx1_pos, first_packet_pos = 0, data_offset = 0;
-    int anykey = 0;
+    int anykey = 0, ret = 0;
 
     nb_index_entries = size / 16;
     if (nb_index_entries <= 0)
@@ -1601,8 +1601,10 @@ static int avi_read_idx1(AVFormatContext *s, int size)
 
     /* Read the entries and sort them in each stream component. */
     for (i = 0; i < nb_index_entries; i++) {
-        if (avio_feof(pb))
-            return -1;
+        if (avio_feof(pb)) {
+            ret = -1;
+            break;
+        }
 
         tag   = avio_rl32(pb);
         flags = avio_rl32(pb);
@@ -1637,7 +1639,7 @@ static int avi_read_idx1(AVFormatContext *s, int size)
         if (last_pos == pos)
             avi->non_interleaved = 1;
         if (last_idx != pos && len) {
-            av_add_index_entry(st, pos, ast->cum_len, len, 0,
+            ff_index_batch_add(st, pos, ast->cum_len, len, 0,
                                (flags & AVIIF_INDEX) ? AVINDEX_KEYFRAME : 0);
             last_idx= pos;
         }
@@ -1645,6 +1647,10 @@ static int avi_read_idx1(AVFormatContext *s, int size)
         last_pos      = pos;
         anykey       |= flags&AVIIF_INDEX;
     }
+    for (index = 0; index < s->nb_streams; index++)
+        ff_index_batch_commit(s->streams[index]);
+    if (ret < 0)
+        return ret;
     if (!anykey) {
         for (index = 0; index < s->nb_streams; index++) {
             st = s->streams[index];
@@ -656,6 +656,13 @@ int ffurl_get_short_seek(URLContext *h)
     return h->prot->url_get_short_seek(h);
 }
 
+int ffurl_flush(URLContext *h)
+{
+    if (!h || !h->prot || !h->prot->url_flush)
+        return 0;
+    return h->prot->url_flush(h);
+}
+
 int ffurl_shutdown(URLContext *h, int flags)
 {
     if (!h || !h->prot || !h->prot->url_shutdown)
@@ -670,6 +677,23 @@ int ff_check_interrupt(AVIOInterruptCB *cb)
     return 0;
 }
 
+static int interrupt_chain_cb(void *opaque)
+{
+    FFIOInterruptChain *ic = opaque;
+
+    return ic->check(ic->opaque) || ff_check_interrupt(ic->parent);
+}
+
+void ff_interrupt_chain_init(FFIOInterruptChain *ic, int (*check)(void *opaque),
+                             void *opaque, AVIOInterruptCB *parent)
+{
+    ic->cb.callback = interrupt_chain_cb;
+    ic->cb.opaque   = ic;
+    ic->check       = check;
+    ic->opaque      = opaque;
+    ic->parent      = parent;
+}
+
 int ff_rename(const char *url_src, const char *url_dst, void *logctx)
 {
     int ret = avpriv_io_move(url_src, url_dst);
@@ -246,6 +246,11 @@ void avio_flush(AVIOContext *s)
 {
     int seekback = s->write_flag ? FFMIN(0, s->buf_ptr - s->buf_ptr_max) : 0;
     flush_buffer(s);
+    if (s->write_flag) {
+        int ret = ffurl_flush(ffio_geturlcontext(s));
+        if (ret < 0)
+            s->error = ret;
+    }
     if (seekback)
         avio_seek(s, seekback, SEEK_CUR);
 }
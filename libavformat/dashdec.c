@@ -24,9 +24,11 @@
 #include "libavutil/opt.h"
 #include "libavutil/time.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/thread.h"
 #include "internal.h"
 #include "avio_internal.h"
 #include "dash.h"
+#include "segprefetch.h"
 
 #define INITIAL_BUFFER_SIZE 32768
 #define MAX_BPRINT_READ_SIZE (UINT_MAX - 1)
@@ -93,6 +95,13 @@ struct representation {
 
     int n_timelines;
     struct timeline **timelines;
+    /* S elements of a refreshed manifest whose segments are the same as in
+     * the previous one are not parsed again, they cover
+     * [skip_start, skip_end) and belong before timelines[skip_index] */
+    int n_timelines_skipped;
+    int skip_index;
+    int64_t skip_start;
+    int64_t skip_end;
 
     int64_t first_seq_no;
     int64_t last_seq_no;
@@ -116,6 +125,12 @@ struct representation {
     uint32_t init_sec_buf_read_offset;
     int64_t cur_timestamp;
     int is_restart_needed;
+
+    /* Segments downloaded ahead by the prefetch thread of the
+     * representation. */
+    SegPrefetchPool prefetch_pool;
+    SegPrefetchQueue prefetch;
+    int prefetch_started;   /* 1 once the thread runs, -1 if it failed to start */
 };
 
 typedef struct DASHContext {
@@ -156,6 +171,19 @@ typedef struct DASHContext {
     int is_init_section_common_video;
     int is_init_section_common_audio;
 
+    /* Representations being updated while refresh_manifest() parses the
+     * new manifest, and the text of the last manifest that was parsed */
+    int n_prev_videos;
+    struct representation **prev_videos;
+    int n_prev_audios;
+    struct representation **prev_audios;
+    int n_prev_subtitles;
+    struct representation **prev_subtitles;
+    char *manifest;
+    int manifest_len;
+
+    int prefetch_segments;
+    int64_t prefetch_max_bytes;
 } DASHContext;
 
 static int ishttp(char *url)
@@ -397,7 +425,8 @@ static void free_subtitle_list(DASHContext *c)
 }
 
 static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
-                    AVDictionary **opts, AVDictionary *opts2, int *is_http)
+                    AVDictionary **opts, AVDictionary *opts2, int *is_http,
+                    AVIOInterruptCB *int_cb)
 {
     DASHContext *c = s->priv_data;
     AVDictionary *tmp = NULL;
@@ -439,7 +468,8 @@ static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
     av_freep(pb);
     av_dict_copy(&tmp, *opts, 0);
     av_dict_copy(&tmp, opts2, 0);
-    ret = avio_open2(pb, url, AVIO_FLAG_READ, c->interrupt_callback, &tmp);
+    ret = avio_open2(pb, url, AVIO_FLAG_READ,
+                     int_cb ? int_cb : c->interrupt_callback, &tmp);
     if (ret >= 0) {
         // update cookies on http response with setcookies.
         char *new_cookies = NULL;
@@ -655,47 +685,196 @@ static int parse_manifest_segmenturlnode(AVFormatContext *s, struct representati
     return 0;
 }
 
-static int parse_manifest_segmenttimeline(AVFormatContext *s, struct representation *rep,
+static int parse_manifest_segmenttimeline(AVFormatContext *s, struct timeline *tml,
                                           xmlNodePtr fragment_timeline_node)
 {
     xmlAttrPtr attr = NULL;
     char *val  = NULL;
-    int err;
 
-    if (!av_strcasecmp(fragment_timeline_node->name, "S")) {
-        struct timeline *tml = av_mallocz(sizeof(struct timeline));
-        if (!tml) {
-            return AVERROR(ENOMEM);
+    if (av_strcasecmp(fragment_timeline_node->name, "S"))
+        return 0;
+
+    memset(tml, 0, sizeof(*tml));
+    attr = fragment_timeline_node->properties;
+    while (attr) {
+        val = xmlGetProp(fragment_timeline_node, attr->name);
+
+        if (!val) {
+            av_log(s, AV_LOG_WARNING, "parse_manifest_segmenttimeline attr->name = %s val is NULL\n", attr->name);
+            continue;
         }
-        attr = fragment_timeline_node->properties;
-        while (attr) {
-            val = xmlGetProp(fragment_timeline_node, attr->name);
 
-            if (!val) {
-                av_log(s, AV_LOG_WARNING, "parse_manifest_segmenttimeline attr->name = %s val is NULL\n", attr->name);
-                continue;
-            }
+        if (!av_strcasecmp(attr->name, "t")) {
+            tml->starttime = (int64_t)strtoll(val, NULL, 10);
+        } else if (!av_strcasecmp(attr->name, "r")) {
+            tml->repeat =(int64_t) strtoll(val, NULL, 10);
+        } else if (!av_strcasecmp(attr->name, "d")) {
+            tml->duration = (int64_t)strtoll(val, NULL, 10);
+        }
+        attr = attr->next;
+        xmlFree(val);
+    }
 
-            if (!av_strcasecmp(attr->name, "t")) {
-                tml->starttime = (int64_t)strtoll(val, NULL, 10);
-            } else if (!av_strcasecmp(attr->name, "r")) {
-                tml->repeat =(int64_t) strtoll(val, NULL, 10);
-            } else if (!av_strcasecmp(attr->name, "d")) {
-                tml->duration = (int64_t)strtoll(val, NULL, 10);
+    return 1;
+}
+
+/* End time of a timeline, 0 if it is empty or has no end. */
+static int64_t get_timeline_end(struct representation *pls)
+{
+    int64_t end_time = 0;
+    int i;
+
+    for (i = 0; i < pls->n_timelines; i++) {
+        if (pls->timelines[i]->repeat < 0)
+            return 0;
+        if (pls->timelines[i]->starttime > 0)
+            end_time = pls->timelines[i]->starttime;
+        end_time += pls->timelines[i]->duration * (pls->timelines[i]->repeat + 1);
+    }
+    return end_time;
+}
+
+/* Position in the segments of a timeline, see timeline_match(). */
+struct timeline_cursor {
+    int index;              /* timeline element */
+    int64_t repeat;         /* segment within the element */
+    int64_t start_time;     /* start time of that segment */
+};
+
+static void timeline_cursor_init(struct timeline_cursor *cur, struct representation *rep)
+{
+    cur->index      = 0;
+    cur->repeat     = 0;
+    cur->start_time = rep->n_timelines && rep->timelines[0]->starttime > 0 ?
+                      rep->timelines[0]->starttime : 0;
+}
+
+/*
+ * Check that rep has count segments of the given duration starting at
+ * start_time, and move cur past the segments that matched. cur only moves
+ * forward, so the segments have to be checked in timeline order.
+ */
+static int timeline_match(struct representation *rep, struct timeline_cursor *cur,
+                          int64_t start_time, int64_t duration, int64_t count)
+{
+    while (count > 0 && cur->index < rep->n_timelines) {
+        struct timeline *tml = rep->timelines[cur->index];
+        int64_t left = tml->repeat + 1 - cur->repeat, n;
+
+        if (left <= 0) {
+            if (++cur->index < rep->n_timelines && rep->timelines[cur->index]->starttime > 0)
+                cur->start_time = rep->timelines[cur->index]->starttime;
+            cur->repeat = 0;
+            continue;
+        }
+        if (tml->duration <= 0)
+            return 0;
+        if (cur->start_time < start_time) {
+            n = FFMIN((start_time - cur->start_time + tml->duration - 1) / tml->duration, left);
+            cur->start_time += n * tml->duration;
+            cur->repeat     += n;
+            continue;
+        }
+        if (cur->start_time != start_time || tml->duration != duration)
+            return 0;
+
+        n = FFMIN(count, left);
+        cur->start_time += n * duration;
+        cur->repeat     += n;
+        start_time      += n * duration;
+        count           -= n;
+    }
+    return !count;
+}
+
+/*
+ * Parse the S elements of a SegmentTimeline. When refreshing a live
+ * manifest, prev is the representation being updated: the run of elements
+ * whose segments, durations included, are the same in prev is only used to
+ * keep track of the time and is merged back from prev by merge_timelines().
+ */
+static int parse_manifest_segmenttimelines(AVFormatContext *s, struct representation *rep,
+                                           struct representation *prev,
+                                           xmlNodePtr fragment_timeline_node)
+{
+    int64_t known_start = 0, known_end = 0;
+    int64_t start_time = 0, end_time;
+    struct timeline_cursor cursor = { 0 };
+    struct timeline tml;
+    int ret;
+
+    if (prev && prev->n_timelines && (known_end = get_timeline_end(prev)) > 0) {
+        known_start = get_segment_start_time_based_on_timeline(prev, 0);
+        timeline_cursor_init(&cursor, prev);
+    }
+
+    fragment_timeline_node = xmlFirstElementChild(fragment_timeline_node);
+    for (; fragment_timeline_node; fragment_timeline_node = xmlNextElementSibling(fragment_timeline_node)) {
+        struct timeline *entry;
+
+        if (!parse_manifest_segmenttimeline(s, &tml, fragment_timeline_node))
+            continue;
+
+        if (tml.starttime > 0)
+            start_time = tml.starttime;
+        end_time = start_time + tml.duration * (tml.repeat + 1);
+
+        if (known_end > 0 && tml.repeat >= 0 &&
+            start_time >= known_start && end_time <= known_end &&
+            (!rep->n_timelines_skipped || rep->skip_index == rep->n_timelines) &&
+            timeline_match(prev, &cursor, start_time, tml.duration, tml.repeat + 1)) {
+            if (!rep->n_timelines_skipped++) {
+                rep->skip_index = rep->n_timelines;
+                rep->skip_start = start_time;
             }
-            attr = attr->next;
-            xmlFree(val);
+            rep->skip_end = start_time = end_time;
+            continue;
         }
-        err = av_dynarray_add_nofree(&rep->timelines, &rep->n_timelines, tml);
-        if (err < 0) {
-            av_free(tml);
-            return err;
+
+        /* the implicit start time refers to an element that was skipped */
+        if (rep->n_timelines_skipped && rep->skip_index == rep->n_timelines)
+            tml.starttime = start_time;
+        start_time = end_time;
+
+        entry = av_memdup(&tml, sizeof(tml));
+        if (!entry)
+            return AVERROR(ENOMEM);
+        ret = av_dynarray_add_nofree(&rep->timelines, &rep->n_timelines, entry);
+        if (ret < 0) {
+            av_free(entry);
+            return ret;
         }
     }
 
     return 0;
 }
 
+/* The representation a manifest refresh is going to update with the
+ * representation of the given type that is being parsed. */
+static struct representation *get_prev_representation(DASHContext *c, enum AVMediaType type,
+                                                      const char *rep_id_val)
+{
+    struct representation *prev = NULL;
+
+    switch (type) {
+    case AVMEDIA_TYPE_VIDEO:
+        if (c->n_videos < c->n_prev_videos)
+            prev = c->prev_videos[c->n_videos];
+        break;
+    case AVMEDIA_TYPE_AUDIO:
+        if (c->n_audios < c->n_prev_audios)
+            prev = c->prev_audios[c->n_audios];
+        break;
+    case AVMEDIA_TYPE_SUBTITLE:
+        if (c->n_subtitles < c->n_prev_subtitles)
+            prev = c->prev_subtitles[c->n_subtitles];
+        break;
+    }
+    if (prev && strncmp(prev->id, rep_id_val ? rep_id_val : "", sizeof(prev->id)))
+        prev = NULL;
+    return prev;
+}
+
 static int resolve_content_path(AVFormatContext *s, const char *url, int *max_url_size, xmlNodePtr *baseurl_nodes, int n_baseurl_nodes)
 {
     char *tmp_str = NULL;
@@ -962,13 +1141,11 @@ static int parse_manifest_representation(AVFormatContext *s, const char *url,
         if (!fragment_timeline_node)
             fragment_timeline_node = find_child_node_by_name(period_segmentlist_node, "SegmentTimeline");
         if (fragment_timeline_node) {
-            fragment_timeline_node = xmlFirstElementChild(fragment_timeline_node);
-            while (fragment_timeline_node) {
-                ret = parse_manifest_segmenttimeline(s, rep, fragment_timeline_node);
-                if (ret < 0)
-                    goto free;
-                fragment_timeline_node = xmlNextElementSibling(fragment_timeline_node);
-            }
+            ret = parse_manifest_segmenttimelines(s, rep,
+                                                  get_prev_representation(c, type, rep_id_val),
+                                                  fragment_timeline_node);
+            if (ret < 0)
+                goto free;
         }
     } else if (representation_baseurl_node && !representation_segmentlist_node) {
         seg = av_mallocz(sizeof(struct fragment));
@@ -1025,13 +1202,11 @@ static int parse_manifest_representation(AVFormatContext *s, const char *url,
         if (!fragment_timeline_node)
             fragment_timeline_node = find_child_node_by_name(period_segmentlist_node, "SegmentTimeline");
         if (fragment_timeline_node) {
-            fragment_timeline_node = xmlFirstElementChild(fragment_timeline_node);
-            while (fragment_timeline_node) {
-                ret = parse_manifest_segmenttimeline(s, rep, fragment_timeline_node);
-                if (ret < 0)
-                    goto free;
-                fragment_timeline_node = xmlNextElementSibling(fragment_timeline_node);
-            }
+            ret = parse_manifest_segmenttimelines(s, rep,
+                                                  get_prev_representation(c, type, rep_id_val),
+                                                  fragment_timeline_node);
+            if (ret < 0)
+                goto free;
         }
     } else {
         av_log(s, AV_LOG_ERROR, "Unknown format of Representation node id[%s] \n", rep_id_val);
@@ -1231,6 +1406,11 @@ static int parse_manifest(AVFormatContext *s, const char *url, AVIOContext *in)
         av_log(s, AV_LOG_ERROR, "Unable to read to manifest '%s'\n", url);
         if (ret == 0)
             ret = AVERROR_INVALIDDATA;
+    } else if ((c->prev_videos || c->prev_audios || c->prev_subtitles) &&
+               c->manifest && c->manifest_len == filesize &&
+               !memcmp(c->manifest, buf.str, filesize)) {
+        /* refreshed manifest is unchanged, nothing to update */
+        ret = 1;
     } else {
         LIBXML_TEST_VERSION
 
@@ -1349,6 +1529,14 @@ static int parse_manifest(AVFormatContext *s, const char *url, AVIOContext *in)
             }
             adaptionset_node = xmlNextElementSibling(adaptionset_node);
         }
+
+        /* keep the manifest to recognize refreshes that did not change it */
+        if (c->is_live) {
+            av_freep(&c->manifest);
+            c->manifest_len = 0;
+            if ((c->manifest = av_memdup(buf.str, filesize)))
+                c->manifest_len = filesize;
+        }
 cleanup:
         /*free the document */
         xmlFreeDoc(doc);
@@ -1455,6 +1643,95 @@ static void move_timelines(struct representation *rep_src, struct representation
     }
 }
 
+/*
+ * Move the timeline elements of prev that cover the run of S elements
+ * skipped by parse_manifest_segmenttimelines() into rep. Nothing is changed
+ * if prev does not line up with the refreshed manifest.
+ */
+static int merge_timelines(struct representation *rep, struct representation *prev)
+{
+    struct timeline **timelines;
+    struct timeline *first_tml, *last_tml;
+    int64_t start_time = 0, first_start = 0, last_end = 0;
+    int64_t skip_front, skip_back;
+    int first = -1, last = -1, i, n;
+
+    for (i = 0; i < prev->n_timelines; i++) {
+        struct timeline *tml = prev->timelines[i];
+        int64_t end_time;
+
+        if (tml->starttime > 0)
+            start_time = tml->starttime;
+        end_time = start_time + tml->duration * (tml->repeat + 1);
+        if (first < 0 && end_time > rep->skip_start) {
+            first       = i;
+            first_start = start_time;
+        }
+        if (first >= 0 && start_time < rep->skip_end) {
+            last     = i;
+            last_end = end_time;
+        }
+        start_time = end_time;
+    }
+    if (first < 0 || last < 0)
+        return AVERROR_INVALIDDATA;
+
+    first_tml = prev->timelines[first];
+    last_tml  = prev->timelines[last];
+    if (first_tml->duration <= 0 || last_tml->duration <= 0 ||
+        first_start > rep->skip_start || last_end < rep->skip_end ||
+        (rep->skip_start - first_start) % first_tml->duration ||
+        (last_end - rep->skip_end) % last_tml->duration)
+        return AVERROR_INVALIDDATA;
+    skip_front = (rep->skip_start - first_start) / first_tml->duration;
+    skip_back  = (last_end - rep->skip_end) / last_tml->duration;
+
+    n = last - first + 1;
+    timelines = av_malloc_array(rep->n_timelines + n, sizeof(*timelines));
+    if (!timelines)
+        return AVERROR(ENOMEM);
+    memcpy(timelines, rep->timelines, rep->skip_index * sizeof(*timelines));
+    memcpy(timelines + rep->skip_index, prev->timelines + first, n * sizeof(*timelines));
+    memcpy(timelines + rep->skip_index + n, rep->timelines + rep->skip_index,
+           (rep->n_timelines - rep->skip_index) * sizeof(*timelines));
+    memset(prev->timelines + first, 0, n * sizeof(*timelines));
+
+    first_tml->starttime = rep->skip_start;
+    first_tml->repeat   -= skip_front;
+    last_tml->repeat    -= skip_back;
+
+    av_free(rep->timelines);
+    rep->timelines   = timelines;
+    rep->n_timelines += n;
+    rep->n_timelines_skipped = 0;
+    return 0;
+}
+
+static int refresh_timelines(struct representation *cur, struct representation *ccur, DASHContext *c)
+{
+    // calc current time
+    int64_t currentTime = get_segment_start_time_based_on_timeline(cur, cur->cur_seq_no) / cur->fragment_timescale;
+    int ret;
+
+    if (ccur->n_timelines_skipped) {
+        if ((ret = merge_timelines(ccur, cur)) < 0)
+            return ret;
+        ccur->cur_seq_no = calc_next_seg_no_from_timelines(ccur, currentTime * cur->fragment_timescale - 1);
+        /* cur gave its elements to ccur and cannot be kept */
+        if (ccur->cur_seq_no < 0)
+            ccur->cur_seq_no = cur->cur_seq_no;
+        move_timelines(ccur, cur, c);
+        return 0;
+    }
+
+    // update segments
+    ccur->cur_seq_no = calc_next_seg_no_from_timelines(ccur, currentTime * cur->fragment_timescale - 1);
+    if (ccur->cur_seq_no >= 0) {
+        move_timelines(ccur, cur, c);
+    }
+    return 0;
+}
+
 static void move_segments(struct representation *rep_src, struct representation *rep_dest, DASHContext *c)
 {
     if (rep_dest && rep_src ) {
@@ -1475,7 +1752,7 @@ static void move_segments(struct representation *rep_src, struct representation
 
 static int refresh_manifest(AVFormatContext *s)
 {
-    int ret = 0, i;
+    int ret = 0, i, merge = 1;
     DASHContext *c = s->priv_data;
     // save current context
     int n_videos = c->n_videos;
@@ -1486,6 +1763,7 @@ static int refresh_manifest(AVFormatContext *s)
     struct representation **subtitles = c->subtitles;
     char *base_url = c->base_url;
 
+reparse:
     c->base_url = NULL;
     c->n_videos = 0;
     c->videos = NULL;
@@ -1493,7 +1771,22 @@ static int refresh_manifest(AVFormatContext *s)
     c->audios = NULL;
     c->n_subtitles = 0;
     c->subtitles = NULL;
+    /* let the parser leave out the timeline elements we already have */
+    if (merge) {
+        c->n_prev_videos    = n_videos;
+        c->prev_videos      = videos;
+        c->n_prev_audios    = n_audios;
+        c->prev_audios      = audios;
+        c->n_prev_subtitles = n_subtitles;
+        c->prev_subtitles   = subtitles;
+    }
     ret = parse_manifest(s, s->url, NULL);
+    c->n_prev_videos    = 0;
+    c->prev_videos      = NULL;
+    c->n_prev_audios    = 0;
+    c->prev_audios      = NULL;
+    c->n_prev_subtitles = 0;
+    c->prev_subtitles   = NULL;
     if (ret)
         goto finish;
 
@@ -1520,13 +1813,9 @@ static int refresh_manifest(AVFormatContext *s)
         struct representation *cur_video = videos[i];
         struct representation *ccur_video = c->videos[i];
         if (cur_video->timelines) {
-            // calc current time
-            int64_t currentTime = get_segment_start_time_based_on_timeline(cur_video, cur_video->cur_seq_no) / cur_video->fragment_timescale;
-            // update segments
-            ccur_video->cur_seq_no = calc_next_seg_no_from_timelines(ccur_video, currentTime * cur_video->fragment_timescale - 1);
-            if (ccur_video->cur_seq_no >= 0) {
-                move_timelines(ccur_video, cur_video, c);
-            }
+            ret = refresh_timelines(cur_video, ccur_video, c);
+            if (ret < 0)
+                goto merge_failed;
         }
         if (cur_video->fragments) {
             move_segments(ccur_video, cur_video, c);
@@ -1536,18 +1825,26 @@ static int refresh_manifest(AVFormatContext *s)
         struct representation *cur_audio = audios[i];
         struct representation *ccur_audio = c->audios[i];
         if (cur_audio->timelines) {
-            // calc current time
-            int64_t currentTime = get_segment_start_time_based_on_timeline(cur_audio, cur_audio->cur_seq_no) / cur_audio->fragment_timescale;
-            // update segments
-            ccur_audio->cur_seq_no = calc_next_seg_no_from_timelines(ccur_audio, currentTime * cur_audio->fragment_timescale - 1);
-            if (ccur_audio->cur_seq_no >= 0) {
-                move_timelines(ccur_audio, cur_audio, c);
-            }
+            ret = refresh_timelines(cur_audio, ccur_audio, c);
+            if (ret < 0)
+                goto merge_failed;
         }
         if (cur_audio->fragments) {
             move_segments(ccur_audio, cur_audio, c);
         }
     }
+    goto finish;
+
+merge_failed:
+    /* The representations refreshed so far are up to date, parse the whole
+     * manifest again for the others. */
+    av_log(s, AV_LOG_VERBOSE, "Cannot merge the refreshed SegmentTimeline, parsing all of it\n");
+    av_freep(&c->base_url);
+    free_subtitle_list(c);
+    free_audio_list(c);
+    free_video_list(c);
+    merge = 0;
+    goto reparse;
 
 finish:
     // restore context
@@ -1569,7 +1866,39 @@ finish:
     c->audios = audios;
     c->n_videos = n_videos;
     c->videos = videos;
-    return ret;
+    return ret < 0 ? ret : 0;
+}
+
+static struct fragment *get_template_fragment(struct representation *pls, int64_t seq_no)
+{
+    DASHContext *c = pls->parent->priv_data;
+    struct fragment *seg;
+    char *tmpfilename;
+
+    seg = av_mallocz(sizeof(struct fragment));
+    if (!seg)
+        return NULL;
+    tmpfilename = av_mallocz(c->max_url_size);
+    if (!tmpfilename) {
+        av_free(seg);
+        return NULL;
+    }
+    ff_dash_fill_tmpl_params(tmpfilename, c->max_url_size, pls->url_template, 0, seq_no, 0, get_segment_start_time_based_on_timeline(pls, seq_no));
+    seg->url = av_strireplace(pls->url_template, pls->url_template, tmpfilename);
+    if (!seg->url) {
+        av_log(pls->parent, AV_LOG_WARNING, "Unable to resolve template url '%s', try to use origin template\n", pls->url_template);
+        seg->url = av_strdup(pls->url_template);
+        if (!seg->url) {
+            av_log(pls->parent, AV_LOG_ERROR, "Cannot resolve template url '%s'\n", pls->url_template);
+            av_free(tmpfilename);
+            av_free(seg);
+            return NULL;
+        }
+    }
+    av_free(tmpfilename);
+    seg->size = -1;
+
+    return seg;
 }
 
 static struct fragment *get_current_fragment(struct representation *pls)
@@ -1614,37 +1943,112 @@ static struct fragment *get_current_fragment(struct representation *pls)
         } else if (pls->cur_seq_no > max_seq_no) {
             av_log(pls->parent, AV_LOG_VERBOSE, "new fragment: min[%"PRId64"] max[%"PRId64"]\n", min_seq_no, max_seq_no);
         }
-        seg = av_mallocz(sizeof(struct fragment));
-        if (!seg) {
-            return NULL;
-        }
+        return get_template_fragment(pls, pls->cur_seq_no);
     } else if (pls->cur_seq_no <= pls->last_seq_no) {
-        seg = av_mallocz(sizeof(struct fragment));
-        if (!seg) {
-            return NULL;
-        }
+        return get_template_fragment(pls, pls->cur_seq_no);
     }
-    if (seg) {
-        char *tmpfilename= av_mallocz(c->max_url_size);
-        if (!tmpfilename) {
-            return NULL;
-        }
-        ff_dash_fill_tmpl_params(tmpfilename, c->max_url_size, pls->url_template, 0, pls->cur_seq_no, 0, get_segment_start_time_based_on_timeline(pls, pls->cur_seq_no));
-        seg->url = av_strireplace(pls->url_template, pls->url_template, tmpfilename);
-        if (!seg->url) {
-            av_log(pls->parent, AV_LOG_WARNING, "Unable to resolve template url '%s', try to use origin template\n", pls->url_template);
-            seg->url = av_strdup(pls->url_template);
-            if (!seg->url) {
-                av_log(pls->parent, AV_LOG_ERROR, "Cannot resolve template url '%s'\n", pls->url_template);
-                av_free(tmpfilename);
-                return NULL;
-            }
-        }
-        av_free(tmpfilename);
-        seg->size = -1;
+
+    return NULL;
+}
+
+static char *get_absolute_url(DASHContext *c, const char *url)
+{
+    char *abs_url = av_mallocz(c->max_url_size);
+
+    if (abs_url)
+        ff_make_absolute_url(abs_url, c->max_url_size, c->base_url, url);
+    return abs_url;
+}
+
+static int prefetch_open(void *opaque, SegPrefetchEntry *e, AVIOContext **pb,
+                         int64_t *size, AVIOInterruptCB *int_cb)
+{
+    struct representation *pls = opaque;
+    int ret;
+
+    av_log(pls->parent, AV_LOG_VERBOSE, "DASH prefetch for url '%s'\n", e->url);
+
+    ret = open_url(pls->parent, pb, e->url, &e->avio_opts, NULL, NULL, int_cb);
+    if (ret < 0)
+        return ret;
+    *size = avio_size(*pb);
+    return 0;
+}
+
+/* Start the prefetch thread of a representation the first time it is
+ * needed. */
+static int prefetch_start(DASHContext *c, struct representation *pls)
+{
+    int ret;
+
+    if (pls->prefetch_started)
+        return pls->prefetch_started > 0 ? 0 : AVERROR(ENOSYS);
+    pls->prefetch_started = -1;
+
+    pls->prefetch_pool.s         = pls->parent;
+    pls->prefetch_pool.max_bytes = c->prefetch_max_bytes;
+    pls->prefetch_pool.open      = prefetch_open;
+    if ((ret = ff_segprefetch_init(&pls->prefetch_pool, 1)) < 0)
+        return ret;
+    ret = ff_segprefetch_queue_add(&pls->prefetch_pool, &pls->prefetch,
+                                   pls, c->prefetch_segments);
+    if (ret < 0) {
+        ff_segprefetch_uninit(&pls->prefetch_pool);
+        return ret;
     }
+    pls->prefetch_started = 1;
+    return 0;
+}
 
-    return seg;
+/* Queue the prefetch_segments segments following the current one that
+ * are already available. Only segments built from a SegmentTemplate are
+ * prefetched. Segments are identified by their url rather than their
+ * sequence number, which may be renumbered by a manifest refresh. */
+static void prefetch_schedule(DASHContext *c, struct representation *pls)
+{
+    SegPrefetchSegment segs[SEG_PREFETCH_MAX_ENTRIES];
+    char *urls[SEG_PREFETCH_MAX_ENTRIES];
+    int64_t seq_no, max_seq_no;
+    int n = 0, i;
+
+    if (!c->prefetch_segments || pls->n_fragments || !pls->url_template ||
+        prefetch_start(c, pls) < 0)
+        return;
+
+    max_seq_no = c->is_live ? calc_max_seg_no(pls, c) : pls->last_seq_no;
+
+    for (seq_no = pls->cur_seq_no + 1;
+         seq_no <= pls->cur_seq_no + c->prefetch_segments && seq_no <= max_seq_no; seq_no++) {
+        struct fragment *seg = get_template_fragment(pls, seq_no);
+        char *url = seg ? get_absolute_url(c, seg->url) : NULL;
+
+        free_fragment(&seg);
+        if (!url)
+            break;
+        urls[n]            = url;
+        segs[n].url        = url;
+        segs[n].url_offset = 0;
+        segs[n].size       = -1;
+        n++;
+    }
+    ff_segprefetch_schedule(&pls->prefetch, segs, n, c->avio_opts);
+
+    for (i = 0; i < n; i++)
+        av_free(urls[i]);
+}
+
+/* Hand the prefetched segment seg to the demuxer, if there is one. */
+static int prefetch_take(DASHContext *c, struct representation *pls, struct fragment *seg)
+{
+    char *url;
+    int ret;
+
+    if (!pls->prefetch.pool || !(url = get_absolute_url(c, seg->url)))
+        return 0;
+    ret = ff_segprefetch_take(&pls->prefetch, url, 0);
+    av_free(url);
+
+    return ret;
 }
 
 static int read_from_url(struct representation *pls, struct fragment *seg,
@@ -1656,7 +2060,10 @@ static int read_from_url(struct representation *pls, struct fragment *seg,
     if (seg->size >= 0)
         buf_size = FFMIN(buf_size, pls->cur_seg_size - pls->cur_seg_offset);
 
-    ret = avio_read(pls->input, buf, buf_size);
+    if (pls->prefetch.cur)
+        ret = ff_segprefetch_read(&pls->prefetch, buf, buf_size);
+    else
+        ret = avio_read(pls->input, buf, buf_size);
     if (ret > 0)
         pls->cur_seg_offset += ret;
 
@@ -1685,7 +2092,7 @@ static int open_input(DASHContext *c, struct representation *pls, struct fragmen
     ff_make_absolute_url(url, c->max_url_size, c->base_url, seg->url);
     av_log(pls->parent, AV_LOG_VERBOSE, "DASH request for url '%s', offset %"PRId64"\n",
            url, seg->url_offset);
-    ret = open_url(pls->parent, &pls->input, url, &c->avio_opts, opts, NULL);
+    ret = open_url(pls->parent, &pls->input, url, &c->avio_opts, opts, NULL, NULL);
 
 cleanup:
     av_free(url);
@@ -1758,7 +2165,7 @@ static int read_data(void *opaque, uint8_t *buf, int buf_size)
     DASHContext *c = v->parent->priv_data;
 
 restart:
-    if (!v->input) {
+    if (!v->input && !v->prefetch.cur) {
         free_fragment(&v->cur_seg);
         v->cur_seg = get_current_fragment(v);
         if (!v->cur_seg) {
@@ -1771,16 +2178,22 @@ restart:
         if (ret)
             goto end;
 
-        ret = open_input(c, v, v->cur_seg);
-        if (ret < 0) {
-            if (ff_check_interrupt(c->interrupt_callback)) {
-                ret = AVERROR_EXIT;
-                goto end;
+        if (prefetch_take(c, v, v->cur_seg)) {
+            v->cur_seg_offset = 0;
+            v->cur_seg_size = v->cur_seg->size;
+        } else {
+            ret = open_input(c, v, v->cur_seg);
+            if (ret < 0) {
+                if (ff_check_interrupt(c->interrupt_callback)) {
+                    ret = AVERROR_EXIT;
+                    goto end;
+                }
+                av_log(v->parent, AV_LOG_WARNING, "Failed to open fragment of playlist\n");
+                v->cur_seq_no++;
+                goto restart;
             }
-            av_log(v->parent, AV_LOG_WARNING, "Failed to open fragment of playlist\n");
-            v->cur_seq_no++;
-            goto restart;
         }
+        prefetch_schedule(c, v);
     }
 
     if (v->init_sec_buf_read_offset < v->init_sec_data_len) {
@@ -1801,7 +2214,7 @@ restart:
         goto end;
     }
     ret = read_from_url(v, v->cur_seg, buf, buf_size);
-    if (ret > 0)
+    if (ret > 0 || (v->prefetch.cur && ret == AVERROR_EXIT))
         goto end;
 
     if (c->is_live || v->cur_seq_no < v->last_seq_no) {
@@ -1818,7 +2231,8 @@ static int save_avio_options(AVFormatContext *s)
 {
     DASHContext *c = s->priv_data;
     const char *opts[] = {
-        "headers", "user_agent", "cookies", "http_proxy", "referer", "rw_timeout", "icy", NULL };
+        "headers", "user_agent", "cookies", "http_proxy", "referer", "rw_timeout", "icy",
+        "connection_pool", "pool_idle_timeout", NULL };
     const char **opt = opts;
     uint8_t *buf = NULL;
     int ret = 0;
@@ -2030,6 +2444,18 @@ static int dash_read_header(AVFormatContext *s)
     if ((ret = save_avio_options(s)) < 0)
         goto fail;
 
+    /* The prefetch threads open segments themselves, bypassing a custom
+     * io_open callback, which might not expect to be called from other
+     * threads. */
+    if (c->prefetch_segments && !ff_format_io_open_is_default(s)) {
+        av_log(s, AV_LOG_VERBOSE, "Custom io_open callback set, disabling segment prefetching\n");
+        c->prefetch_segments = 0;
+    }
+    if (c->prefetch_segments && !HAVE_THREADS) {
+        av_log(s, AV_LOG_WARNING, "Segment prefetching needs thread support, disabling it\n");
+        c->prefetch_segments = 0;
+    }
+
     if ((ret = parse_manifest(s, s->url, s->pb)) < 0)
         goto fail;
 
@@ -2168,6 +2594,7 @@ static void recheck_discard_flags(AVFormatContext *s, struct representation **p,
         } else if (!needed && pls->ctx) {
             close_demux_for_component(pls);
             ff_format_io_close(pls->parent, &pls->input);
+            ff_segprefetch_flush(&pls->prefetch);
             av_log(s, AV_LOG_INFO, "No longer receiving stream_index %d\n", pls->stream_index);
         }
     }
@@ -2229,6 +2656,7 @@ static int dash_read_packet(AVFormatContext *s, AVPacket *pkt)
             cur->cur_seg_offset = 0;
             cur->init_sec_buf_read_offset = 0;
             ff_format_io_close(cur->parent, &cur->input);
+            ff_segprefetch_release(&cur->prefetch);
             ret = reopen_demux_for_component(s, cur);
             cur->is_restart_needed = 0;
         }
@@ -2239,11 +2667,20 @@ static int dash_read_packet(AVFormatContext *s, AVPacket *pkt)
 static int dash_close(AVFormatContext *s)
 {
     DASHContext *c = s->priv_data;
+    int i;
+
+    for (i = 0; i < c->n_videos; i++)
+        ff_segprefetch_uninit(&c->videos[i]->prefetch_pool);
+    for (i = 0; i < c->n_audios; i++)
+        ff_segprefetch_uninit(&c->audios[i]->prefetch_pool);
+    for (i = 0; i < c->n_subtitles; i++)
+        ff_segprefetch_uninit(&c->subtitles[i]->prefetch_pool);
     free_audio_list(c);
     free_video_list(c);
     free_subtitle_list(c);
     av_dict_free(&c->avio_opts);
     av_freep(&c->base_url);
+    av_freep(&c->manifest);
     return 0;
 }
 
@@ -2268,6 +2705,7 @@ static int dash_seek(AVFormatContext *s, struct representation *pls, int64_t see
     }
 
     ff_format_io_close(pls->parent, &pls->input);
+    ff_segprefetch_flush(&pls->prefetch);
 
     // find the nearest fragment
     if (pls->n_timelines > 0 && pls->fragment_timescale > 0) {
@@ -2365,6 +2803,10 @@ static const AVOption dash_options[] = {
         OFFSET(allowed_extensions), AV_OPT_TYPE_STRING,
         {.str = "aac,m4a,m4s,m4v,mov,mp4,webm,ts"},
         INT_MIN, INT_MAX, FLAGS},
+    {"prefetch_segments", "Number of segments to download ahead per representation, 0 = disable",
+        OFFSET(prefetch_segments), AV_OPT_TYPE_INT, {.i64 = 0}, 0, SEG_PREFETCH_MAX_ENTRIES, FLAGS},
+    {"prefetch_max_bytes", "Maximum amount of memory held by prefetched segments of a representation",
+        OFFSET(prefetch_max_bytes), AV_OPT_TYPE_INT64, {.i64 = 32 * 1024 * 1024}, 0, INT64_MAX, FLAGS},
     {NULL}
 };
 
@@ -22,6 +22,7 @@
 #include "libavutil/avstring.h"
 #include "libavutil/internal.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
 #include "avformat.h"
 #if HAVE_DIRENT_H
 #include <dirent.h>
@@ -33,6 +34,9 @@
 #if HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
 #include <sys/stat.h>
 #include <stdlib.h>
 #include "os_support.h"
@@ -67,6 +71,19 @@
 
 /* standard file protocol */
 
+#define FILE_FADVISE_SEQUENTIAL 0x1
+#define FILE_FADVISE_WILLNEED   0x2
+
+/* minimum amount of data to request ahead of the read position with the
+ * willneed hint; it is renewed once half of it has been consumed */
+#define FILE_READAHEAD_WINDOW (4 << 20)
+
+typedef struct FileWriteRequest {
+    uint8_t *data;
+    unsigned int alloc_size;
+    int size;
+} FileWriteRequest;
+
 typedef struct FileContext {
     const AVClass *class;
     int fd;
@@ -74,6 +91,27 @@ typedef struct FileContext {
     int blocksize;
     int follow;
     int seekable;
+    int use_mmap;
+    int fadvise;
+    int read_size;
+    int64_t pos;            ///< current read position
+    int64_t advised_end;    ///< end of the range last passed to POSIX_FADV_WILLNEED
+    uint8_t *map;           ///< whole file mapping, NULL when reading with read()
+    int64_t map_size;
+    int async_write;
+    int async_buffers;
+#if HAVE_THREADS
+    /* writes are queued to a writer thread when async_write is set */
+    int writer_running;
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    FileWriteRequest *requests;
+    int first_request;      ///< oldest request, being written by the thread
+    int nb_pending;         ///< requests queued and not completed yet
+    int write_error;        ///< first error of the writer thread, sticky
+    int writer_exit;
+#endif
 #if HAVE_DIRENT_H
     DIR *dir;
 #endif
@@ -84,6 +122,13 @@ static const AVOption file_options[] = {
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
     { "follow", "Follow a file as it is being written", offsetof(FileContext, follow), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { "seekable", "Sets if the file is seekable", offsetof(FileContext, seekable), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "mmap", "Read regular files through a memory mapping", offsetof(FileContext, use_mmap), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
+    { "fadvise", "Set access pattern hints for the kernel", offsetof(FileContext, fadvise), AV_OPT_TYPE_FLAGS, { .i64 = 0 }, 0, INT_MAX, AV_OPT_FLAG_DECODING_PARAM, "fadvise" },
+        { "sequential", "the file is mostly read sequentially", 0, AV_OPT_TYPE_CONST, { .i64 = FILE_FADVISE_SEQUENTIAL }, 0, 0, AV_OPT_FLAG_DECODING_PARAM, "fadvise" },
+        { "willneed",   "request readahead of the data following the read position", 0, AV_OPT_TYPE_CONST, { .i64 = FILE_FADVISE_WILLNEED }, 0, 0, AV_OPT_FLAG_DECODING_PARAM, "fadvise" },
+    { "read_size", "set the size of the read requests, 0 for the default", offsetof(FileContext, read_size), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, INT_MAX / 2, AV_OPT_FLAG_DECODING_PARAM },
+    { "async_write", "Write from a separate thread", offsetof(FileContext, async_write), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_ENCODING_PARAM },
+    { "async_buffers", "set the maximum number of writes in flight", offsetof(FileContext, async_buffers), AV_OPT_TYPE_INT, { .i64 = 8 }, 1, 1024, AV_OPT_FLAG_ENCODING_PARAM },
     { NULL }
 };
 
@@ -106,16 +151,183 @@ static const AVClass pipe_class = {
     .version    = LIBAVUTIL_VERSION_INT,
 };
 
+#if HAVE_THREADS
+static int write_fully(int fd, const uint8_t *buf, int size)
+{
+    while (size > 0) {
+        int ret = write(fd, buf, size);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return AVERROR(errno);
+        }
+        buf  += ret;
+        size -= ret;
+    }
+    return 0;
+}
+
+static void *file_writer_thread(void *arg)
+{
+    FileContext *c = arg;
+
+    pthread_mutex_lock(&c->lock);
+    for (;;) {
+        FileWriteRequest *req;
+        int ret;
+
+        while (!c->nb_pending && !c->writer_exit)
+            pthread_cond_wait(&c->cond, &c->lock);
+        if (!c->nb_pending)
+            break;
+
+        /* the oldest request is not touched by the caller until it is
+         * completed, write it without holding the lock; after an error
+         * the remaining requests are dropped, writing them would leave
+         * a hole */
+        req = &c->requests[c->first_request];
+        if (!c->write_error) {
+            pthread_mutex_unlock(&c->lock);
+            ret = write_fully(c->fd, req->data, req->size);
+            pthread_mutex_lock(&c->lock);
+            if (ret < 0)
+                c->write_error = ret;
+        }
+
+        c->first_request = (c->first_request + 1) % c->async_buffers;
+        c->nb_pending--;
+        pthread_cond_broadcast(&c->cond);
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    return NULL;
+}
+
+/* Wait for all the queued requests to be written. */
+static int file_async_drain(FileContext *c)
+{
+    int ret;
+
+    if (!c->writer_running)
+        return 0;
+
+    pthread_mutex_lock(&c->lock);
+    while (c->nb_pending)
+        pthread_cond_wait(&c->cond, &c->lock);
+    ret = c->write_error;
+    pthread_mutex_unlock(&c->lock);
+
+    return ret;
+}
+
+static int file_async_close(FileContext *c)
+{
+    int i, ret;
+
+    if (!c->writer_running)
+        return 0;
+
+    ret = file_async_drain(c);
+
+    pthread_mutex_lock(&c->lock);
+    c->writer_exit = 1;
+    pthread_cond_broadcast(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+    pthread_join(c->writer, NULL);
+    c->writer_running = 0;
+
+    pthread_cond_destroy(&c->cond);
+    pthread_mutex_destroy(&c->lock);
+    for (i = 0; i < c->async_buffers; i++)
+        av_freep(&c->requests[i].data);
+    av_freep(&c->requests);
+
+    return ret;
+}
+
+static int file_async_write(FileContext *c, const unsigned char *buf, int size)
+{
+    FileWriteRequest *req;
+    int ret;
+
+    pthread_mutex_lock(&c->lock);
+    while (c->nb_pending == c->async_buffers && !c->write_error)
+        pthread_cond_wait(&c->cond, &c->lock);
+    ret = c->write_error;
+    req = &c->requests[(c->first_request + c->nb_pending) % c->async_buffers];
+    pthread_mutex_unlock(&c->lock);
+    if (ret < 0)
+        return ret;
+
+    /* free slots are owned by the caller until they are queued */
+    av_fast_malloc(&req->data, &req->alloc_size, size);
+    if (!req->data)
+        return AVERROR(ENOMEM);
+    memcpy(req->data, buf, size);
+    req->size = size;
+
+    pthread_mutex_lock(&c->lock);
+    /* the writer may have failed while the data was copied */
+    ret = c->write_error;
+    if (!ret) {
+        c->nb_pending++;
+        pthread_cond_broadcast(&c->cond);
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    return ret < 0 ? ret : size;
+}
+#else
+static int file_async_drain(FileContext *c)
+{
+    return 0;
+}
+
+static int file_async_close(FileContext *c)
+{
+    return 0;
+}
+#endif /* HAVE_THREADS */
+
+static void file_advise_willneed(FileContext *c)
+{
+#if HAVE_POSIX_FADVISE
+    int64_t window = FFMAX(FILE_READAHEAD_WINDOW, 8LL * c->read_size);
+
+    if (c->pos + window / 2 <= c->advised_end)
+        return;
+    if (c->advised_end < c->pos)
+        c->advised_end = c->pos;
+    posix_fadvise(c->fd, c->advised_end, c->pos + window - c->advised_end,
+                  POSIX_FADV_WILLNEED);
+    c->advised_end = c->pos + window;
+#endif
+}
+
 static int file_read(URLContext *h, unsigned char *buf, int size)
 {
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+    if ((ret = file_async_drain(c)) < 0)
+        return ret;
+    if (c->fadvise & FILE_FADVISE_WILLNEED)
+        file_advise_willneed(c);
+    if (c->map) {
+        if (c->pos >= c->map_size)
+            return AVERROR_EOF;
+        ret = FFMIN(size, c->map_size - c->pos);
+        memcpy(buf, c->map + c->pos, ret);
+        c->pos += ret;
+        return ret;
+    }
     ret = read(c->fd, buf, size);
     if (ret == 0 && c->follow)
         return AVERROR(EAGAIN);
     if (ret == 0)
         return AVERROR_EOF;
+    if (ret > 0)
+        c->pos += ret;
     return (ret == -1) ? AVERROR(errno) : ret;
 }
 
@@ -124,6 +336,10 @@ static int file_write(URLContext *h, const unsigned char *buf, int size)
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+#if HAVE_THREADS
+    if (c->writer_running)
+        return file_async_write(c, buf, size);
+#endif
     ret = write(c->fd, buf, size);
     return (ret == -1) ? AVERROR(errno) : ret;
 }
@@ -205,11 +421,43 @@ static int file_move(URLContext *h_src, URLContext *h_dst)
 
 #if CONFIG_FILE_PROTOCOL
 
+#if HAVE_THREADS
+static int file_async_init(URLContext *h)
+{
+    FileContext *c = h->priv_data;
+    int ret;
+
+    c->requests = av_mallocz_array(c->async_buffers, sizeof(*c->requests));
+    if (!c->requests)
+        return AVERROR(ENOMEM);
+
+    if ((ret = pthread_mutex_init(&c->lock, NULL))) {
+        av_freep(&c->requests);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&c->cond, NULL))) {
+        pthread_mutex_destroy(&c->lock);
+        av_freep(&c->requests);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_create(&c->writer, NULL, file_writer_thread, c))) {
+        pthread_cond_destroy(&c->cond);
+        pthread_mutex_destroy(&c->lock);
+        av_freep(&c->requests);
+        return AVERROR(ret);
+    }
+    c->writer_running = 1;
+
+    return 0;
+}
+
+#endif
+
 static int file_open(URLContext *h, const char *filename, int flags)
 {
     FileContext *c = h->priv_data;
     int access;
-    int fd;
+    int fd, stat_ret;
     struct stat st;
 
     av_strstart(filename, "file:", &filename);
@@ -233,7 +481,8 @@ static int file_open(URLContext *h, const char *filename, int flags)
         return AVERROR(errno);
     c->fd = fd;
 
-    h->is_streamed = !fstat(fd, &st) && S_ISFIFO(st.st_mode);
+    stat_ret = fstat(fd, &st);
+    h->is_streamed = !stat_ret && S_ISFIFO(st.st_mode);
 
     /* Buffer writes more than the default 32k to improve throughput especially
      * with networked file systems */
@@ -243,6 +492,42 @@ static int file_open(URLContext *h, const char *filename, int flags)
     if (c->seekable >= 0)
         h->is_streamed = !c->seekable;
 
+    if (c->async_write && flags & AVIO_FLAG_WRITE) {
+#if HAVE_THREADS
+        int ret = file_async_init(h);
+        if (ret < 0) {
+            close(fd);
+            return ret;
+        }
+#else
+        av_log(h, AV_LOG_WARNING, "async_write requires threads, writing synchronously\n");
+#endif
+    }
+
+    if (!h->is_streamed && !(flags & AVIO_FLAG_WRITE)) {
+        if (c->read_size)
+            h->max_packet_size = c->read_size;
+#if HAVE_POSIX_FADVISE
+        if (c->fadvise & FILE_FADVISE_SEQUENTIAL)
+            posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#if HAVE_MMAP
+        /* The whole file is mapped once; files that grow while being read
+         * cannot be followed through a fixed size mapping. */
+        if (c->use_mmap && !c->follow && !stat_ret && S_ISREG(st.st_mode) &&
+            st.st_size > 0 && (uint64_t)st.st_size <= SIZE_MAX) {
+            void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (map != MAP_FAILED) {
+                c->map      = map;
+                c->map_size = st.st_size;
+            } else {
+                av_log(h, AV_LOG_VERBOSE, "mmap() failed: %s, using read()\n",
+                       av_err2str(AVERROR(errno)));
+            }
+        }
+#endif
+    }
+
     return 0;
 }
 
@@ -252,21 +537,50 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
     FileContext *c = h->priv_data;
     int64_t ret;
 
+    if ((ret = file_async_drain(c)) < 0)
+        return ret;
+
     if (whence == AVSEEK_SIZE) {
         struct stat st;
         ret = fstat(c->fd, &st);
         return ret < 0 ? AVERROR(errno) : (S_ISFIFO(st.st_mode) ? 0 : st.st_size);
     }
 
+    if (c->map) {
+        if (whence == SEEK_CUR)
+            pos += c->pos;
+        else if (whence == SEEK_END)
+            pos += c->map_size;
+        else if (whence != SEEK_SET)
+            return AVERROR(EINVAL);
+        if (pos < 0)
+            return AVERROR(EINVAL);
+        return c->pos = pos;
+    }
+
     ret = lseek(c->fd, pos, whence);
+    if (ret >= 0)
+        c->pos = ret;
 
     return ret < 0 ? AVERROR(errno) : ret;
 }
 
+static int file_flush(URLContext *h)
+{
+    return file_async_drain(h->priv_data);
+}
+
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
-    return close(c->fd);
+    int ret = file_async_close(c);
+#if HAVE_MMAP
+    if (c->map)
+        munmap(c->map, c->map_size);
+#endif
+    if (close(c->fd) < 0 && !ret)
+        ret = AVERROR(errno);
+    return ret;
 }
 
 static int file_open_dir(URLContext *h)
@@ -360,6 +674,7 @@ const URLProtocol ff_file_protocol = {
     .url_write           = file_write,
     .url_seek            = file_seek,
     .url_close           = file_close,
+    .url_flush           = file_flush,
     .url_get_file_handle = file_get_handle,
     .url_check           = file_check,
     .url_delete          = file_delete,
@@ -33,11 +33,13 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/dict.h"
+#include "libavutil/thread.h"
 #include "libavutil/time.h"
 #include "avformat.h"
 #include "internal.h"
 #include "avio_internal.h"
 #include "id3v2.h"
+#include "segprefetch.h"
 
 #define INITIAL_BUFFER_SIZE 32768
 
@@ -78,6 +80,7 @@ struct segment {
 };
 
 struct rendition;
+struct playlist;
 
 enum PlaylistType {
     PLS_TYPE_UNSPECIFIED,
@@ -160,6 +163,9 @@ struct playlist {
      * playlist, if any. */
     int n_init_sections;
     struct segment **init_sections;
+
+    /* Segments downloaded ahead by the prefetch workers. */
+    SegPrefetchQueue prefetch;
 };
 
 /*
@@ -213,6 +219,11 @@ typedef struct HLSContext {
     int http_multiple;
     int http_seekable;
     AVIOContext *playlist_pb;
+
+    int prefetch_segments;
+    int prefetch_threads;
+    int64_t prefetch_max_bytes;
+    SegPrefetchPool prefetch_pool;
 } HLSContext;
 
 static void free_segment_dynarray(struct segment **segments, int n_segments)
@@ -617,7 +628,8 @@ static int open_url_keepalive(AVFormatContext *s, AVIOContext **pb,
 }
 
 static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
-                    AVDictionary **opts, AVDictionary *opts2, int *is_http_out)
+                    AVDictionary **opts, AVDictionary *opts2, int *is_http_out,
+                    AVIOInterruptCB *int_cb)
 {
     HLSContext *c = s->priv_data;
     AVDictionary *tmp = NULL;
@@ -679,6 +691,10 @@ static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
                     url, av_err2str(ret));
             ret = s->io_open(s, pb, url, AVIO_FLAG_READ, &tmp);
         }
+    } else if (int_cb) {
+        /* what the default io_open does, with the caller's interrupt callback */
+        ret = ffio_open_whitelist(pb, url, AVIO_FLAG_READ, int_cb, &tmp,
+                                  s->protocol_whitelist, s->protocol_blacklist);
     } else {
         ret = s->io_open(s, pb, url, AVIO_FLAG_READ, &tmp);
     }
@@ -997,6 +1013,88 @@ static struct segment *next_segment(struct playlist *pls)
     return pls->segments[n];
 }
 
+#if HAVE_THREADS
+static int prefetch_open(void *opaque, SegPrefetchEntry *e, AVIOContext **pb,
+                         int64_t *size, AVIOInterruptCB *int_cb)
+{
+    struct playlist *pls = opaque;
+    AVFormatContext *s = pls->parent;
+    AVDictionary *opts = NULL;
+    int is_http = 0, ret;
+
+    if (e->size >= 0) {
+        av_dict_set_int(&opts, "offset", e->url_offset, 0);
+        av_dict_set_int(&opts, "end_offset", e->url_offset + e->size, 0);
+    }
+
+    av_log(s, AV_LOG_VERBOSE, "HLS prefetch for url '%s', offset %"PRId64", playlist %d\n",
+           e->url, e->url_offset, pls->index);
+
+    ret = open_url(s, pb, e->url, &e->avio_opts, opts, &is_http, int_cb);
+    av_dict_free(&opts);
+    if (ret < 0)
+        return ret;
+    if (!is_http && e->url_offset) {
+        int64_t seekret = avio_seek(*pb, e->url_offset, SEEK_SET);
+        if (seekret < 0) {
+            ff_format_io_close(s, pb);
+            return seekret;
+        }
+    }
+
+    *size = e->size;
+    if (*size < 0 && (*size = avio_size(*pb)) > 0 && !is_http)
+        *size -= e->url_offset;
+    return 0;
+}
+
+static int prefetch_init(AVFormatContext *s)
+{
+    HLSContext *c = s->priv_data;
+    int i, ret;
+
+    c->prefetch_pool.s         = s;
+    c->prefetch_pool.max_bytes = c->prefetch_max_bytes;
+    c->prefetch_pool.open      = prefetch_open;
+    if ((ret = ff_segprefetch_init(&c->prefetch_pool, c->prefetch_threads)) < 0)
+        return ret;
+
+    for (i = 0; i < c->n_playlists; i++) {
+        struct playlist *pls = c->playlists[i];
+        ret = ff_segprefetch_queue_add(&c->prefetch_pool, &pls->prefetch,
+                                       pls, c->prefetch_segments);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+#endif
+
+/* Queue the prefetch_segments segments following the current one. Only
+ * unencrypted segments are prefetched. */
+static void prefetch_schedule(HLSContext *c, struct playlist *pls)
+{
+    SegPrefetchSegment segs[SEG_PREFETCH_MAX_ENTRIES];
+    int seq_no, n = 0;
+
+    if (!pls->prefetch.pool)
+        return;
+
+    for (seq_no = pls->cur_seq_no + 1;
+         seq_no <= pls->cur_seq_no + c->prefetch_segments &&
+         seq_no < pls->start_seq_no + pls->n_segments; seq_no++) {
+        struct segment *seg = pls->segments[seq_no - pls->start_seq_no];
+
+        if (seg->key_type != KEY_NONE)
+            continue;
+        segs[n].url        = seg->url;
+        segs[n].url_offset = seg->url_offset;
+        segs[n].size       = seg->size;
+        n++;
+    }
+    ff_segprefetch_schedule(&pls->prefetch, segs, n, c->avio_opts);
+}
+
 static int read_from_url(struct playlist *pls, struct segment *seg,
                          uint8_t *buf, int buf_size)
 {
@@ -1006,7 +1104,10 @@ static int read_from_url(struct playlist *pls, struct segment *seg,
     if (seg->size >= 0)
         buf_size = FFMIN(buf_size, seg->size - pls->cur_seg_offset);
 
-    ret = avio_read(pls->input, buf, buf_size);
+    if (pls->prefetch.cur)
+        ret = ff_segprefetch_read(&pls->prefetch, buf, buf_size);
+    else
+        ret = avio_read(pls->input, buf, buf_size);
     if (ret > 0)
         pls->cur_seg_offset += ret;
 
@@ -1231,12 +1332,12 @@ static int open_input(HLSContext *c, struct playlist *pls, struct segment *seg,
            seg->url, seg->url_offset, pls->index);
 
     if (seg->key_type == KEY_NONE) {
-        ret = open_url(pls->parent, in, seg->url, &c->avio_opts, opts, &is_http);
+        ret = open_url(pls->parent, in, seg->url, &c->avio_opts, opts, &is_http, NULL);
     } else if (seg->key_type == KEY_AES_128) {
         char iv[33], key[33], url[MAX_URL_SIZE];
         if (strcmp(seg->key, pls->key_url)) {
             AVIOContext *pb = NULL;
-            if (open_url(pls->parent, &pb, seg->key, &c->avio_opts, opts, NULL) == 0) {
+            if (open_url(pls->parent, &pb, seg->key, &c->avio_opts, opts, NULL, NULL) == 0) {
                 ret = avio_read(pb, pls->key, sizeof(pls->key));
                 if (ret != sizeof(pls->key)) {
                     av_log(pls->parent, AV_LOG_ERROR, "Unable to read key file %s\n",
@@ -1260,7 +1361,7 @@ static int open_input(HLSContext *c, struct playlist *pls, struct segment *seg,
         av_dict_set(&opts, "key", key, 0);
         av_dict_set(&opts, "iv", iv, 0);
 
-        ret = open_url(pls->parent, in, url, &c->avio_opts, opts, &is_http);
+        ret = open_url(pls->parent, in, url, &c->avio_opts, opts, &is_http, NULL);
         if (ret < 0) {
             goto cleanup;
         }
@@ -1421,7 +1522,7 @@ restart:
     if (!v->needed)
         return AVERROR_EOF;
 
-    if (!v->input || (c->http_persistent && v->input_read_done)) {
+    if (!v->prefetch.cur && (!v->input || (c->http_persistent && v->input_read_done))) {
         int64_t reload_interval;
 
         /* Check that the playlist is still needed before opening a new
@@ -1431,6 +1532,7 @@ restart:
         if (!v->needed) {
             av_log(v->parent, AV_LOG_INFO, "No longer receiving playlist %d ('%s')\n",
                    v->index, v->url);
+            ff_segprefetch_flush(&v->prefetch);
             return AVERROR_EOF;
         }
 
@@ -1492,7 +1594,12 @@ reload:
         if (ret)
             return ret;
 
-        if (c->http_multiple == 1 && v->input_next_requested) {
+        if (ff_segprefetch_take(&v->prefetch, seg->url, seg->url_offset)) {
+            /* an open persistent connection stays idle meanwhile */
+            v->input_read_done = 1;
+            v->cur_seg_offset = 0;
+            ret = 0;
+        } else if (c->http_multiple == 1 && v->input_next_requested) {
             FFSWAP(AVIOContext *, v->input, v->input_next);
             v->cur_seg_offset = 0;
             v->input_next_requested = 0;
@@ -1510,6 +1617,7 @@ reload:
             goto reload;
         }
         just_opened = 1;
+        prefetch_schedule(c, v);
     }
 
     if (c->http_multiple == -1) {
@@ -1522,7 +1630,7 @@ reload:
     }
 
     seg = next_segment(v);
-    if (c->http_multiple == 1 && !v->input_next_requested &&
+    if (c->http_multiple == 1 && !v->input_next_requested && !c->prefetch_segments &&
         seg && seg->key_type == KEY_NONE && av_strstart(seg->url, "http", NULL)) {
         ret = open_input(c, v, seg, &v->input_next);
         if (ret < 0) {
@@ -1555,7 +1663,11 @@ reload:
 
         return ret;
     }
-    if (c->http_persistent &&
+    if (v->prefetch.cur) {
+        if (ret == AVERROR_EXIT)
+            return ret;
+        ff_segprefetch_release(&v->prefetch);
+    } else if (c->http_persistent &&
         seg->key_type == KEY_NONE && av_strstart(seg->url, "http", NULL)) {
         v->input_read_done = 1;
     } else {
@@ -1693,7 +1805,8 @@ static int save_avio_options(AVFormatContext *s)
 {
     HLSContext *c = s->priv_data;
     static const char * const opts[] = {
-        "headers", "http_proxy", "user_agent", "cookies", "referer", "rw_timeout", "icy", NULL };
+        "headers", "http_proxy", "user_agent", "cookies", "referer", "rw_timeout", "icy",
+        "connection_pool", "pool_idle_timeout", NULL };
     const char * const * opt = opts;
     uint8_t *buf;
     int ret = 0;
@@ -1830,6 +1943,7 @@ static int hls_close(AVFormatContext *s)
 {
     HLSContext *c = s->priv_data;
 
+    ff_segprefetch_uninit(&c->prefetch_pool);
     free_playlist_list(c);
     free_variant_list(c);
     free_rendition_list(c);
@@ -1861,6 +1975,13 @@ static int hls_read_header(AVFormatContext *s)
        the range header */
     av_dict_set_int(&c->avio_opts, "seekable", c->http_seekable, 0);
 
+    /* The workers open segments themselves, bypassing a custom io_open
+     * callback, which might not expect to be called from other threads. */
+    if (c->prefetch_segments && !ff_format_io_open_is_default(s)) {
+        av_log(s, AV_LOG_VERBOSE, "Custom io_open callback set, disabling segment prefetching\n");
+        c->prefetch_segments = 0;
+    }
+
     if ((ret = parse_playlist(c, s->url, NULL, s->pb)) < 0)
         goto fail;
 
@@ -1892,6 +2013,18 @@ static int hls_read_header(AVFormatContext *s)
         }
     }
 
+    /* Each playlist gets its prefetch queue here, so only start the workers
+     * once all playlists have been added. */
+    if (c->prefetch_segments) {
+#if HAVE_THREADS
+        if ((ret = prefetch_init(s)) < 0)
+            goto fail;
+#else
+        av_log(s, AV_LOG_WARNING, "Segment prefetching needs thread support, disabling it\n");
+        c->prefetch_segments = 0;
+#endif
+    }
+
     /* If this isn't a live stream, calculate the total duration of the
      * stream. */
     if (c->variants[0]->playlists[0]->finished) {
@@ -2323,6 +2456,7 @@ static int hls_read_seek(AVFormatContext *s, int stream_index,
         pls->input_read_done = 0;
         ff_format_io_close(pls->parent, &pls->input_next);
         pls->input_next_requested = 0;
+        ff_segprefetch_flush(&pls->prefetch);
         av_packet_unref(&pls->pkt);
         pls->pb.eof_reached = 0;
         /* Clear any buffered data */
@@ -2384,6 +2518,12 @@ static const AVOption hls_options[] = {
         OFFSET(http_multiple), AV_OPT_TYPE_BOOL, {.i64 = -1}, -1, 1, FLAGS},
     {"http_seekable", "Use HTTP partial requests, 0 = disable, 1 = enable, -1 = auto",
         OFFSET(http_seekable), AV_OPT_TYPE_BOOL, { .i64 = -1}, -1, 1, FLAGS},
+    {"prefetch_segments", "Number of segments to download ahead per playlist, 0 = disable",
+        OFFSET(prefetch_segments), AV_OPT_TYPE_INT, {.i64 = 0}, 0, SEG_PREFETCH_MAX_ENTRIES, FLAGS},
+    {"prefetch_threads", "Number of threads downloading prefetched segments",
+        OFFSET(prefetch_threads), AV_OPT_TYPE_INT, {.i64 = 2}, 1, 64, FLAGS},
+    {"prefetch_max_bytes", "Maximum amount of memory held by prefetched segments",
+        OFFSET(prefetch_max_bytes), AV_OPT_TYPE_INT64, {.i64 = 64 * 1024 * 1024}, 0, INT64_MAX, FLAGS},
     {NULL}
 };
 
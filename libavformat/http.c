@@ -29,6 +29,7 @@
 #include "libavutil/avstring.h"
 #include "libavutil/bprint.h"
 #include "libavutil/opt.h"
+#include "libavutil/thread.h"
 #include "libavutil/time.h"
 #include "libavutil/parseutils.h"
 
@@ -51,6 +52,7 @@
 #define HTTP_SINGLE   1
 #define HTTP_MUTLI    2
 #define MAX_EXPIRY    19
+#define MAX_POOLED_CONNECTIONS 32
 #define WHITESPACES " \n\t\r"
 typedef enum {
     LOWER_PROTO,
@@ -59,9 +61,26 @@ typedef enum {
     FINISH
 }HandshakeState;
 
+/**
+ * A connection which can be kept in the process wide pool of idle
+ * connections once its response has been read.
+ */
+typedef struct HTTPPoolConnection {
+    URLContext *hd;
+    /** interrupt callback of the lower protocol contexts, forwarding to
+     *  the one of the current user of the connection */
+    AVIOInterruptCB int_cb;
+    AVIOInterruptCB user_int_cb;
+    /** lower protocol URL and options the connection was opened with */
+    char *key;
+    int64_t expiry;
+    struct HTTPPoolConnection *next;
+} HTTPPoolConnection;
+
 typedef struct HTTPContext {
     const AVClass *class;
     URLContext *hd;
+    HTTPPoolConnection *conn;
     unsigned char buffer[BUFFER_SIZE], *buf_ptr, *buf_end;
     int line_count;
     int http_code;
@@ -129,6 +148,8 @@ typedef struct HTTPContext {
     int is_multi_client;
     HandshakeState handshake_step;
     int is_connected_server;
+    int connection_pool;
+    int pool_idle_timeout;
 } HTTPContext;
 
 #define OFFSET(x) offsetof(HTTPContext, x)
@@ -173,6 +194,8 @@ static const AVOption options[] = {
     { "listen", "listen on HTTP", OFFSET(listen), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 2, D | E },
     { "resource", "The resource requested by a client", OFFSET(resource), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, E },
     { "reply_code", "The http status code to return to a client", OFFSET(reply_code), AV_OPT_TYPE_INT, { .i64 = 200}, INT_MIN, 599, E},
+    { "connection_pool", "reuse idle persistent connections of other HTTP contexts", OFFSET(connection_pool), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D },
+    { "pool_idle_timeout", "time in seconds an idle connection is kept in the pool", OFFSET(pool_idle_timeout), AV_OPT_TYPE_INT, { .i64 = 30 }, 0, INT_MAX / 1000000, D },
     { NULL }
 };
 
@@ -192,6 +215,172 @@ void ff_http_init_auth_state(URLContext *dest, const URLContext *src)
            sizeof(HTTPAuthState));
 }
 
+static AVMutex pool_mutex = AV_MUTEX_INITIALIZER;
+static HTTPPoolConnection *pool;
+static int pool_size;
+
+static int pool_interrupt_cb(void *opaque)
+{
+    HTTPPoolConnection *conn = opaque;
+    return ff_check_interrupt(&conn->user_int_cb);
+}
+
+static void close_cnx(URLContext **hd, HTTPPoolConnection **conn)
+{
+    ffurl_closep(hd);
+    if (*conn) {
+        av_freep(&(*conn)->key);
+        av_freep(conn);
+    }
+}
+
+/**
+ * Take an idle connection opened with the given key out of the pool, and
+ * close the expired ones.
+ */
+static HTTPPoolConnection *pool_get(const char *key)
+{
+    HTTPPoolConnection *conn = NULL, *expired = NULL, **p;
+    int64_t now = av_gettime_relative();
+
+    ff_mutex_lock(&pool_mutex);
+    for (p = &pool; *p; ) {
+        HTTPPoolConnection *c = *p;
+        if (c->expiry <= now) {
+            *p = c->next;
+            c->next = expired;
+            expired = c;
+            pool_size--;
+        } else if (!conn && !strcmp(c->key, key)) {
+            *p = c->next;
+            conn = c;
+            pool_size--;
+        } else {
+            p = &c->next;
+        }
+    }
+    ff_mutex_unlock(&pool_mutex);
+
+    while (expired) {
+        HTTPPoolConnection *next = expired->next;
+        close_cnx(&expired->hd, &expired);
+        expired = next;
+    }
+    return conn;
+}
+
+static void pool_put(HTTPPoolConnection *conn, int idle_timeout)
+{
+    conn->user_int_cb = (AVIOInterruptCB){ NULL, NULL };
+    conn->expiry      = av_gettime_relative() + idle_timeout * 1000000LL;
+
+    ff_mutex_lock(&pool_mutex);
+    if (pool_size < MAX_POOLED_CONNECTIONS) {
+        conn->next = pool;
+        pool = conn;
+        pool_size++;
+        conn = NULL;
+    }
+    ff_mutex_unlock(&pool_mutex);
+
+    if (conn)
+        close_cnx(&conn->hd, &conn);
+}
+
+void ff_http_pool_flush(void)
+{
+    HTTPPoolConnection *conn;
+
+    ff_mutex_lock(&pool_mutex);
+    conn = pool;
+    pool = NULL;
+    pool_size = 0;
+    ff_mutex_unlock(&pool_mutex);
+
+    while (conn) {
+        HTTPPoolConnection *next = conn->next;
+        close_cnx(&conn->hd, &conn);
+        conn = next;
+    }
+}
+
+/**
+ * Open the connection to the lower protocol URL, taking it from the pool
+ * if possible.
+ *
+ * @return 1 if a pooled connection is used, 0 for a new one, or a negative
+ *         error code
+ */
+static int open_lower(URLContext *h, const char *url, AVDictionary **options,
+                      int use_pool)
+{
+    HTTPContext *s = h->priv_data;
+    HTTPPoolConnection *conn;
+    char *opts = NULL, *key;
+    int ret;
+
+    if (!s->connection_pool)
+        return ffurl_open_whitelist(&s->hd, url, AVIO_FLAG_READ_WRITE,
+                                    &h->interrupt_callback, options,
+                                    h->protocol_whitelist, h->protocol_blacklist, h);
+
+    /* connections opened with different options, such as the TLS
+     * verification settings, are not shared */
+    if ((ret = av_dict_get_string(s->chained_options, &opts, '=', ',')) < 0)
+        return ret;
+    key = av_asprintf("%s %s", url, opts ? opts : "");
+    av_free(opts);
+    if (!key)
+        return AVERROR(ENOMEM);
+
+    if (use_pool && (conn = pool_get(key))) {
+        av_free(key);
+        av_log(h, AV_LOG_DEBUG, "Reusing pooled connection to %s\n", url);
+        conn->user_int_cb = h->interrupt_callback;
+        s->conn = conn;
+        s->hd   = conn->hd;
+        return 1;
+    }
+
+    conn = av_mallocz(sizeof(*conn));
+    if (!conn) {
+        av_free(key);
+        return AVERROR(ENOMEM);
+    }
+    conn->key         = key;
+    conn->int_cb      = (AVIOInterruptCB){ pool_interrupt_cb, conn };
+    conn->user_int_cb = h->interrupt_callback;
+    ret = ffurl_open_whitelist(&conn->hd, url, AVIO_FLAG_READ_WRITE,
+                               &conn->int_cb, options,
+                               h->protocol_whitelist, h->protocol_blacklist, h);
+    if (ret < 0) {
+        close_cnx(&conn->hd, &conn);
+        return ret;
+    }
+    s->conn = conn;
+    s->hd   = conn->hd;
+    return 0;
+}
+
+/* Close the connection, or give it back to the pool if the response has
+ * been read entirely and the server keeps it open. */
+static void release_cnx(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+    uint64_t target_end = s->end_off ? s->end_off : s->filesize;
+
+    if (s->conn && !(h->flags & AVIO_FLAG_WRITE) && !s->willclose &&
+        s->http_code >= 200 && s->http_code < 300 &&
+        s->buf_ptr == s->buf_end &&
+        (s->chunksize != UINT64_MAX ? s->chunkend : s->off == target_end)) {
+        pool_put(s->conn, s->pool_idle_timeout);
+        s->conn = NULL;
+        s->hd   = NULL;
+        return;
+    }
+    close_cnx(&s->hd, &s->conn);
+}
+
 static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
 {
     const char *path, *proxy_path, *lower_proto = "tcp", *local_path;
@@ -200,7 +389,7 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
     char auth[1024], proxyauth[1024] = "";
     char path1[MAX_URL_SIZE], sanitized_path[MAX_URL_SIZE];
     char buf[1024], urlbuf[MAX_URL_SIZE];
-    int port, use_proxy, err, location_changed = 0;
+    int port, use_proxy, err, location_changed = 0, reused = 0;
     HTTPContext *s = h->priv_data;
 
     av_url_split(proto, sizeof(proto), auth, sizeof(auth),
@@ -247,15 +436,27 @@ static int http_open_cnx_internal(URLContext *h, AVDictionary **options)
     ff_url_join(buf, sizeof(buf), lower_proto, NULL, hostname, port, NULL);
 
     if (!s->hd) {
-        err = ffurl_open_whitelist(&s->hd, buf, AVIO_FLAG_READ_WRITE,
-                                   &h->interrupt_callback, options,
-                                   h->protocol_whitelist, h->protocol_blacklist, h);
-        if (err < 0)
-            return err;
+        /* only plain GET requests may go over a pooled connection: they are
+         * the only ones which can be resent if it turns out to be closed */
+        int use_pool = !(h->flags & AVIO_FLAG_WRITE) && !s->post_data &&
+                       (!s->method || !av_strcasecmp(s->method, "GET"));
+        reused = open_lower(h, buf, options, use_pool);
+        if (reused < 0)
+            return reused;
     }
 
+    if (reused > 0)
+        s->http_code = 0;
     err = http_connect(h, path, local_path, hoststr,
                        auth, proxyauth, &location_changed);
+    if (err < 0 && reused > 0 && !s->http_code) {
+        /* the server closed the idle connection, retry on a new one */
+        close_cnx(&s->hd, &s->conn);
+        if ((err = open_lower(h, buf, options, 0)) < 0)
+            return err;
+        err = http_connect(h, path, local_path, hoststr,
+                           auth, proxyauth, &location_changed);
+    }
     if (err < 0)
         return err;
 
@@ -326,7 +527,7 @@ redo:
         /* restore the offset (http_connect resets it) */
         s->off = off;
 
-        ffurl_closep(&s->hd);
+        close_cnx(&s->hd, &s->conn);
         goto redo;
     }
 
@@ -334,7 +535,7 @@ redo:
     if (s->http_code == 401) {
         if ((cur_auth_type == HTTP_AUTH_NONE || s->auth_state.stale) &&
             s->auth_state.auth_type != HTTP_AUTH_NONE && attempts < 4) {
-            ffurl_closep(&s->hd);
+            close_cnx(&s->hd, &s->conn);
             goto redo;
         } else
             goto fail;
@@ -342,7 +543,7 @@ redo:
     if (s->http_code == 407) {
         if ((cur_proxy_auth_type == HTTP_AUTH_NONE || s->proxy_auth_state.stale) &&
             s->proxy_auth_state.auth_type != HTTP_AUTH_NONE && attempts < 4) {
-            ffurl_closep(&s->hd);
+            close_cnx(&s->hd, &s->conn);
             goto redo;
         } else
             goto fail;
@@ -351,7 +552,7 @@ redo:
          s->http_code == 303 || s->http_code == 307) &&
         location_changed == 1) {
         /* url moved, get next */
-        ffurl_closep(&s->hd);
+        close_cnx(&s->hd, &s->conn);
         if (redirects++ >= MAX_REDIRECTS)
             return AVERROR(EIO);
         /* Restart the authentication process with the new target, which
@@ -365,7 +566,7 @@ redo:
 
 fail:
     if (s->hd)
-        ffurl_closep(&s->hd);
+        close_cnx(&s->hd, &s->conn);
     if (location_changed < 0)
         return location_changed;
     return ff_http_averror(s->http_code, AVERROR(EIO));
@@ -1356,7 +1557,8 @@ static int http_connect(URLContext *h, const char *path, const char *local_path,
         av_bprintf(&request, "Expect: 100-continue\r\n");
 
     if (!has_header(s->headers, "\r\nConnection: "))
-        av_bprintf(&request, "Connection: %s\r\n", s->multiple_requests ? "keep-alive" : "close");
+        av_bprintf(&request, "Connection: %s\r\n",
+                   s->multiple_requests || s->connection_pool ? "keep-alive" : "close");
 
     if (!has_header(s->headers, "\r\nHost: "))
         av_bprintf(&request, "Host: %s\r\n", hoststr);
@@ -1461,14 +1663,14 @@ static int http_buf_read(URLContext *h, uint8_t *buf, int size)
                    "Chunked encoding data size: %"PRIu64"\n",
                     s->chunksize);
 
-            if (!s->chunksize && s->multiple_requests) {
+            if (!s->chunksize && (s->multiple_requests || s->connection_pool)) {
                 http_get_line(s, line, sizeof(line)); // read empty chunk
                 s->chunkend = 1;
                 return 0;
             }
             else if (!s->chunksize) {
                 av_log(h, AV_LOG_DEBUG, "Last chunk received, closing conn\n");
-                ffurl_closep(&s->hd);
+                close_cnx(&s->hd, &s->conn);
                 return 0;
             }
             else if (s->chunksize == UINT64_MAX) {
@@ -1767,7 +1969,7 @@ static int http_close(URLContext *h)
         ret = http_shutdown(h, h->flags);
 
     if (s->hd)
-        ffurl_closep(&s->hd);
+        release_cnx(h);
     av_dict_free(&s->chained_options);
     return ret;
 }
@@ -1776,6 +1978,7 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
 {
     HTTPContext *s = h->priv_data;
     URLContext *old_hd = s->hd;
+    HTTPPoolConnection *old_conn = s->conn;
     uint64_t old_off = s->off;
     uint8_t old_buf[BUFFER_SIZE];
     int old_buf_size, ret;
@@ -1813,7 +2016,8 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
     /* we save the old context in case the seek fails */
     old_buf_size = s->buf_end - s->buf_ptr;
     memcpy(old_buf, s->buf_ptr, old_buf_size);
-    s->hd = NULL;
+    s->hd   = NULL;
+    s->conn = NULL;
 
     /* if it fails, continue on old connection */
     if ((ret = http_open_cnx(h, &options)) < 0) {
@@ -1822,11 +2026,12 @@ static int64_t http_seek_internal(URLContext *h, int64_t off, int whence, int fo
         s->buf_ptr = s->buffer;
         s->buf_end = s->buffer + old_buf_size;
         s->hd      = old_hd;
+        s->conn    = old_conn;
         s->off     = old_off;
         return ret;
     }
     av_dict_free(&options);
-    ffurl_close(old_hd);
+    close_cnx(&old_hd, &old_conn);
     return off;
 }
 
@@ -230,6 +230,15 @@ struct AVStreamInternal {
     int nb_index_entries;
     unsigned int index_entries_allocated_size;
 
+    /**
+     * Entries added with ff_index_batch_add(), in the order they were
+     * added, that ff_index_batch_commit() has not merged into
+     * index_entries yet.
+     */
+    AVIndexEntry *index_batch;
+    int nb_index_batch;
+    unsigned int index_batch_allocated_size;
+
     int64_t interleaver_chunk_size;
     int64_t interleaver_chunk_duration;
 
@@ -538,6 +547,29 @@ int ff_add_index_entry(AVIndexEntry **index_entries,
                        unsigned int *index_entries_allocated_size,
                        int64_t pos, int64_t timestamp, int size, int distance, int flags);
 
+/**
+ * Queue an index entry for the stream without inserting it into the index.
+ * This takes amortized constant time, unlike av_add_index_entry(), which
+ * has to move all later entries when the new one does not go to the end.
+ * Demuxers adding many entries at once, possibly out of order, should
+ * queue them and call ff_index_batch_commit() once they are done.
+ *
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int ff_index_batch_add(AVStream *st, int64_t pos, int64_t timestamp,
+                       int size, int distance, int flags);
+
+/**
+ * Sort the entries queued with ff_index_batch_add() and merge them into
+ * the index of the stream. The resulting index is the same as if every
+ * entry had been added with av_add_index_entry() in the order they were
+ * queued.
+ *
+ * @return 0 on success, a negative AVERROR code on failure; the queued
+ *         entries are dropped in both cases
+ */
+int ff_index_batch_commit(AVStream *st);
+
 void ff_configure_buffers_for_index(AVFormatContext *s, int64_t time_tolerance);
 
 /**
@@ -800,6 +832,12 @@ int ff_format_output_open(AVFormatContext *s, const char *url, AVDictionary **op
  */
 void ff_format_io_close(AVFormatContext *s, AVIOContext **pb);
 
+/**
+ * Check whether s opens nested resources with the default io_open
+ * callback, i.e. with avio and the whitelists and interrupt callback of s.
+ */
+int ff_format_io_open_is_default(AVFormatContext *s);
+
 /**
  * Utility function to check if the file uses http or https protocol
  *
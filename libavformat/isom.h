@@ -155,6 +155,23 @@ typedef struct MOVIndexRange {
     int64_t end;
 } MOVIndexRange;
 
+/**
+ * Position in the sample tables of a track whose index is resolved on
+ * demand (see the lazy_index option).
+ */
+typedef struct MOVSampleCursor {
+    unsigned int sample;       ///< sample (or audio chunk packet) number
+    unsigned int stts_index;
+    unsigned int stts_sample;  ///< sample number inside the stts entry
+    unsigned int stsc_index;
+    unsigned int chunk;
+    unsigned int chunk_sample; ///< sample (or packet) number inside the chunk
+    unsigned int stss_index;   ///< first stss entry not before the sample
+    unsigned int distance;     ///< samples since the last keyframe
+    int64_t pos;
+    int64_t dts;
+} MOVSampleCursor;
+
 typedef struct MOVStreamContext {
     AVIOContext *pb;
     int pb_is_copied;
@@ -241,6 +258,21 @@ typedef struct MOVStreamContext {
         AVEncryptionInfo *default_encrypted_sample;
         MOVEncryptionIndex *encryption_index;
     } cenc;
+
+    struct {
+        int enabled;               ///< samples are resolved from the sample tables
+        int expanded;              ///< the full index has been built after all
+        int chunk_packets;         ///< uncompressed audio grouped into chunk packets
+        int all_keys;              ///< every sample is a keyframe
+        int key_off;
+        unsigned int nb_samples;
+        unsigned int *stts_first;  ///< first sample of each stts entry
+        int64_t *stts_dts;         ///< dts of the first sample of each stts entry
+        unsigned int *stsc_first;  ///< first sample (or packet) of each stsc entry
+        int64_t *stsc_dts;         ///< dts of the first packet of each stsc entry
+        MOVSampleCursor cur;       ///< cursor at current_sample
+        AVIndexEntry entry;        ///< index entry for the cursor position
+    } lazy;
 } MOVStreamContext;
 
 typedef struct MOVContext {
@@ -294,6 +326,7 @@ typedef struct MOVContext {
     uint8_t *decryption_key;
     int decryption_key_len;
     int enable_drefs;
+    int lazy_index;
     int32_t movie_display_matrix[3][3]; ///< display matrix from mvhd
     int have_read_mfra_size;
     uint32_t mfra_size;
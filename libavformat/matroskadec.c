@@ -1917,12 +1917,14 @@ static void matroska_add_index_entries(MatroskaDemuxContext *matroska)
             MatroskaTrack *track = matroska_find_track_by_num(matroska,
                                                               pos[j].track);
             if (track && track->stream)
-                av_add_index_entry(track->stream,
+                ff_index_batch_add(track->stream,
                                    pos[j].pos + matroska->segment_start,
                                    index[i].time / index_scale, 0, 0,
                                    AVINDEX_KEYFRAME);
         }
     }
+    for (i = 0; i < matroska->ctx->nb_streams; i++)
+        ff_index_batch_commit(matroska->ctx->streams[i]);
 }
 
 static void matroska_parse_cues(MatroskaDemuxContext *matroska) {
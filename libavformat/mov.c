@@ -3383,6 +3383,468 @@ static int64_t add_ctts_entry(MOVStts** ctts_data, unsigned int* ctts_count, uns
     return *ctts_count;
 }
 
+/* Number of media samples in one packet of grouped uncompressed audio. */
+static unsigned int mov_lazy_packet_samples(const MOVStreamContext *sc)
+{
+    if (sc->samples_per_frame > 1)
+        return (1024 / sc->samples_per_frame) * sc->samples_per_frame;
+    return 1024;
+}
+
+static int64_t mov_lazy_packet_bytes(const MOVStreamContext *sc, int64_t samples)
+{
+    if (sc->samples_per_frame > 1)
+        return samples / sc->samples_per_frame * sc->bytes_per_frame;
+    return samples * sc->sample_size;
+}
+
+/* Number of samples (or packets) in each chunk of the stsc entry. */
+static unsigned int mov_lazy_chunk_samples(const MOVStreamContext *sc, unsigned int index)
+{
+    unsigned int step;
+
+    if (!sc->lazy.chunk_packets)
+        return sc->stsc_data[index].count;
+    step = mov_lazy_packet_samples(sc);
+    return (sc->stsc_data[index].count + step - 1) / step;
+}
+
+/* Return the last run whose first sample is not after sample. */
+static unsigned int mov_lazy_find_run(const unsigned int *first, unsigned int count,
+                                      unsigned int sample)
+{
+    unsigned int lo = 0, hi = count;
+
+    while (hi - lo > 1) {
+        unsigned int mid = (lo + hi) >> 1;
+        if (first[mid] <= sample)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Return the first stss entry not before sample, or keyframe_count. */
+static unsigned int mov_lazy_find_keyframe(const MOVStreamContext *sc, int64_t sample)
+{
+    int64_t key = sample + sc->lazy.key_off;
+    unsigned int lo = 0, hi = sc->keyframe_count;
+
+    while (lo < hi) {
+        unsigned int mid = (lo + hi) >> 1;
+        if (sc->keyframes[mid] < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static int mov_lazy_is_keyframe(const MOVStreamContext *sc, const MOVSampleCursor *cur)
+{
+    if (sc->lazy.all_keys)
+        return 1;
+    if (sc->keyframe_absent)
+        return cur->sample == 0;
+    return sc->keyframes[cur->stss_index] == cur->sample + (int64_t)sc->lazy.key_off;
+}
+
+static unsigned int mov_lazy_sample_size(const MOVStreamContext *sc, const MOVSampleCursor *cur)
+{
+    if (sc->lazy.chunk_packets) {
+        unsigned int step = mov_lazy_packet_samples(sc);
+        unsigned int left = sc->stsc_data[cur->stsc_index].count - cur->chunk_sample * step;
+        return mov_lazy_packet_bytes(sc, FFMIN(step, left));
+    }
+    return sc->stsz_sample_size > 0 ? sc->stsz_sample_size : sc->sample_sizes[cur->sample];
+}
+
+static int64_t mov_lazy_sample_dts(const MOVStreamContext *sc, unsigned int sample)
+{
+    unsigned int i, off, per_chunk;
+
+    if (sc->lazy.chunk_packets) {
+        i         = mov_lazy_find_run(sc->lazy.stsc_first, sc->stsc_count, sample);
+        off       = sample - sc->lazy.stsc_first[i];
+        per_chunk = mov_lazy_chunk_samples(sc, i);
+        return sc->lazy.stsc_dts[i] +
+               (int64_t)(off / per_chunk) * sc->stsc_data[i].count +
+               (int64_t)(off % per_chunk) * mov_lazy_packet_samples(sc);
+    }
+
+    i = mov_lazy_find_run(sc->lazy.stts_first, sc->stts_count, sample);
+    return sc->lazy.stts_dts[i] +
+           (int64_t)(sample - sc->lazy.stts_first[i]) * sc->stts_data[i].duration;
+}
+
+/**
+ * Point the cursor at the given sample, in O(log n) of the run-length
+ * tables plus the samples preceding it in its chunk.
+ */
+static void mov_lazy_cursor_seek(const MOVStreamContext *sc, MOVSampleCursor *cur,
+                                 unsigned int sample)
+{
+    unsigned int i, j, off, per_chunk;
+
+    memset(cur, 0, sizeof(*cur));
+    cur->sample = sample;
+    if (sample >= sc->lazy.nb_samples)
+        return;
+
+    i         = mov_lazy_find_run(sc->lazy.stsc_first, sc->stsc_count, sample);
+    off       = sample - sc->lazy.stsc_first[i];
+    per_chunk = mov_lazy_chunk_samples(sc, i);
+    cur->stsc_index   = i;
+    cur->chunk        = sc->stsc_data[i].first - 1 + off / per_chunk;
+    cur->chunk_sample = off % per_chunk;
+    cur->pos          = sc->chunk_offsets[cur->chunk];
+    cur->dts          = mov_lazy_sample_dts(sc, sample);
+
+    if (sc->lazy.chunk_packets) {
+        cur->pos += mov_lazy_packet_bytes(sc, (int64_t)cur->chunk_sample *
+                                              mov_lazy_packet_samples(sc));
+        return;
+    }
+
+    if (sc->stsz_sample_size > 0)
+        cur->pos += (int64_t)cur->chunk_sample * sc->stsz_sample_size;
+    else
+        for (j = sample - cur->chunk_sample; j < sample; j++)
+            cur->pos += sc->sample_sizes[j];
+
+    cur->stts_index  = mov_lazy_find_run(sc->lazy.stts_first, sc->stts_count, sample);
+    cur->stts_sample = sample - sc->lazy.stts_first[cur->stts_index];
+
+    if (sc->lazy.all_keys) {
+        cur->distance = 0;
+    } else if (sc->keyframe_absent) {
+        cur->distance = sample;
+    } else {
+        i = mov_lazy_find_keyframe(sc, sample);
+        cur->stss_index = FFMIN(i, sc->keyframe_count - 1);
+        if (mov_lazy_is_keyframe(sc, cur))
+            cur->distance = 0;
+        else if (i > 0)
+            cur->distance = sample + sc->lazy.key_off - sc->keyframes[i - 1];
+        else
+            cur->distance = sample;
+    }
+}
+
+/* Advance the cursor by one sample, in constant time. */
+static void mov_lazy_cursor_next(const MOVStreamContext *sc, MOVSampleCursor *cur)
+{
+    unsigned int size;
+
+    if (cur->sample + 1 >= sc->lazy.nb_samples) {
+        cur->sample++;
+        return;
+    }
+
+    size = mov_lazy_sample_size(sc, cur);
+    cur->pos += size;
+    if (sc->lazy.chunk_packets) {
+        cur->dts += FFMIN(mov_lazy_packet_samples(sc),
+                          sc->stsc_data[cur->stsc_index].count -
+                          cur->chunk_sample * mov_lazy_packet_samples(sc));
+    } else {
+        cur->dts += sc->stts_data[cur->stts_index].duration;
+        cur->stts_sample++;
+        if (cur->stts_index + 1 < sc->stts_count &&
+            cur->stts_sample == sc->stts_data[cur->stts_index].count) {
+            cur->stts_sample = 0;
+            cur->stts_index++;
+        }
+    }
+    cur->sample++;
+
+    if (++cur->chunk_sample == mov_lazy_chunk_samples(sc, cur->stsc_index)) {
+        cur->chunk_sample = 0;
+        cur->chunk++;
+        if (mov_stsc_index_valid(cur->stsc_index, sc->stsc_count) &&
+            cur->chunk + 1 == sc->stsc_data[cur->stsc_index + 1].first)
+            cur->stsc_index++;
+        cur->pos = sc->chunk_offsets[cur->chunk];
+    }
+
+    if (sc->lazy.chunk_packets)
+        return;
+    if (!sc->lazy.all_keys && !sc->keyframe_absent &&
+        sc->keyframes[cur->stss_index] < cur->sample + (int64_t)sc->lazy.key_off &&
+        cur->stss_index + 1 < sc->keyframe_count)
+        cur->stss_index++;
+    if (mov_lazy_is_keyframe(sc, cur))
+        cur->distance = 0;
+    else
+        cur->distance++;
+}
+
+static void mov_lazy_cursor_entry(const MOVStreamContext *sc, const MOVSampleCursor *cur,
+                                  AVIndexEntry *e)
+{
+    e->pos          = cur->pos;
+    e->timestamp    = cur->dts;
+    e->size         = mov_lazy_sample_size(sc, cur);
+    e->min_distance = cur->distance;
+    e->flags        = mov_lazy_is_keyframe(sc, cur) ? AVINDEX_KEYFRAME : 0;
+}
+
+static void mov_lazy_update_entry(MOVStreamContext *sc)
+{
+    if (sc->lazy.cur.sample < sc->lazy.nb_samples)
+        mov_lazy_cursor_entry(sc, &sc->lazy.cur, &sc->lazy.entry);
+}
+
+static int mov_get_nb_samples(const AVStream *st)
+{
+    const MOVStreamContext *sc = st->priv_data;
+
+    return sc->lazy.enabled ? sc->lazy.nb_samples : st->internal->nb_index_entries;
+}
+
+static int64_t mov_get_sample_timestamp(const AVStream *st, int sample)
+{
+    const MOVStreamContext *sc = st->priv_data;
+
+    if (sc->lazy.enabled)
+        return mov_lazy_sample_dts(sc, sample);
+    return st->internal->index_entries[sample].timestamp;
+}
+
+/* Index entry of the next sample to be read, or NULL at the end of the track. */
+static AVIndexEntry *mov_get_current_entry(AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+
+    if (sc->lazy.enabled)
+        return (unsigned)sc->current_sample < sc->lazy.nb_samples ? &sc->lazy.entry : NULL;
+    if (sc->current_sample < st->internal->nb_index_entries)
+        return &st->internal->index_entries[sc->current_sample];
+    return NULL;
+}
+
+/**
+ * Same as ff_index_search_timestamp(), but on the sample tables of a
+ * track with a lazy index.
+ */
+static int mov_lazy_search_timestamp(const MOVStreamContext *sc,
+                                     int64_t wanted_timestamp, int flags)
+{
+    int64_t a = -1, b = sc->lazy.nb_samples, m, timestamp;
+    int backward = flags & AVSEEK_FLAG_BACKWARD;
+
+    if (b && mov_lazy_sample_dts(sc, b - 1) < wanted_timestamp)
+        a = b - 1;
+
+    while (b - a > 1) {
+        m         = (a + b) >> 1;
+        timestamp = mov_lazy_sample_dts(sc, m);
+        if (timestamp >= wanted_timestamp)
+            b = m;
+        if (timestamp <= wanted_timestamp)
+            a = m;
+    }
+    m = backward ? a : b;
+
+    if (!(flags & AVSEEK_FLAG_ANY) && !sc->lazy.all_keys &&
+        m >= 0 && m < sc->lazy.nb_samples) {
+        if (sc->keyframe_absent) {
+            m = backward || !m ? 0 : sc->lazy.nb_samples;
+        } else {
+            unsigned int i = mov_lazy_find_keyframe(sc, m);
+
+            if (i < sc->keyframe_count && sc->keyframes[i] == m + sc->lazy.key_off)
+                ;
+            else if (backward)
+                m = i ? sc->keyframes[i - 1] - sc->lazy.key_off : -1;
+            else if (i < sc->keyframe_count)
+                m = FFMIN(sc->keyframes[i] - sc->lazy.key_off, sc->lazy.nb_samples);
+            else
+                m = sc->lazy.nb_samples;
+        }
+    }
+
+    if (m == sc->lazy.nb_samples)
+        return -1;
+    return m;
+}
+
+static void mov_free_lazy_index(MOVStreamContext *sc)
+{
+    av_freep(&sc->lazy.stts_first);
+    av_freep(&sc->lazy.stts_dts);
+    av_freep(&sc->lazy.stsc_first);
+    av_freep(&sc->lazy.stsc_dts);
+    sc->lazy.enabled = 0;
+}
+
+/**
+ * Keep the sample tables of st and resolve its samples on demand instead of
+ * expanding them into st->internal->index_entries. Only tracks whose index
+ * would be a plain walk over the tables qualify.
+ *
+ * @return 1 if the stream uses the lazy index, 0 if it needs the full index,
+ *         a negative AVERROR code on failure
+ */
+static int mov_init_lazy_index(MOVContext *mov, AVStream *st, int64_t current_dts)
+{
+    MOVStreamContext *sc = st->priv_data;
+    enum AVMediaType type = st->codecpar->codec_type;
+    unsigned int stsz_sample_size = sc->stsz_sample_size;
+    uint64_t total = 0, stream_size = 0, first;
+    unsigned int i;
+    if ((type != AVMEDIA_TYPE_AUDIO && type != AVMEDIA_TYPE_VIDEO) ||
+        st->internal->nb_index_entries ||
+        !sc->chunk_count || !sc->stsc_count || sc->stsc_data[0].first != 1 ||
+        (sc->elst_count && !mov->ignore_editlist && mov->advanced_editlist))
+        return 0;
+    if (sc->pseudo_stream_id != -1)
+        for (i = 0; i < sc->stsc_count; i++)
+            if (sc->stsc_data[i].id - 1 != sc->pseudo_stream_id)
+                return 0;
+
+    sc->lazy.chunk_packets = type == AVMEDIA_TYPE_AUDIO &&
+                             sc->stts_count == 1 && sc->stts_data[0].duration == 1;
+
+    if (sc->lazy.chunk_packets) {
+        unsigned int step = mov_lazy_packet_samples(sc);
+
+        if (sc->samples_per_frame >= 160 ||
+            (sc->samples_per_frame > 1 && !sc->bytes_per_frame))
+            return 0;
+        for (i = 0; i < sc->stsc_count; i++) {
+            unsigned int count = sc->stsc_data[i].count;
+
+            if (i != sc->stsc_count - 1 &&
+                sc->samples_per_frame && count % sc->samples_per_frame)
+                return 0;
+            if (mov_lazy_packet_bytes(sc, FFMIN(step, count)) > 0x3FFFFFFF)
+                return 0;
+            total += mov_get_stsc_samples(sc, i) / count * mov_lazy_chunk_samples(sc, i);
+        }
+    } else {
+        if (!sc->sample_count || sc->stps_count || (sc->rap_group_count && sc->rap_group))
+            return 0;
+        for (i = 0; i < sc->stts_count; i++)
+            if (sc->stts_data[i].duration < 0 ||
+                (!sc->stts_data[i].count && i + 1 < sc->stts_count))
+                return 0;
+        for (i = 0; i < sc->keyframe_count; i++)
+            if (sc->keyframes[i] < 0 || (i && sc->keyframes[i] <= sc->keyframes[i - 1]))
+                return 0;
+        for (i = 0; i < sc->stsc_count; i++)
+            total += mov_get_stsc_samples(sc, i);
+        if (total > sc->sample_count)
+            return 0;
+
+        /* The sequential path applies these checks chunk by chunk; only
+         * accept tables where that makes no difference. */
+        if (sc->sample_size > 0 && sc->sample_size < stsz_sample_size) {
+            unsigned int stsc_index = 0;
+            for (i = 0; i < sc->chunk_count; i++) {
+                int64_t next_offset = i + 1 < sc->chunk_count ? sc->chunk_offsets[i + 1] : INT64_MAX;
+                int64_t current_offset = sc->chunk_offsets[i];
+                while (mov_stsc_index_valid(stsc_index, sc->stsc_count) &&
+                       i + 1 == sc->stsc_data[stsc_index + 1].first)
+                    stsc_index++;
+                if (next_offset > current_offset &&
+                    sc->stsc_data[stsc_index].count * (int64_t)stsz_sample_size > next_offset - current_offset) {
+                    if (i)
+                        return 0;
+                    av_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too large), ignoring\n", stsz_sample_size);
+                    stsz_sample_size = sc->sample_size;
+                    break;
+                }
+            }
+        }
+        if (stsz_sample_size > 0 && stsz_sample_size < sc->sample_size) {
+            av_log(mov->fc, AV_LOG_WARNING, "STSZ sample size %d invalid (too small), ignoring\n", stsz_sample_size);
+            stsz_sample_size = sc->sample_size;
+        }
+        sc->stsz_sample_size = stsz_sample_size;
+
+        if (stsz_sample_size > 0) {
+            if (stsz_sample_size > 0x3FFFFFFF)
+                return 0;
+            stream_size = stsz_sample_size * total;
+        } else {
+            if (!sc->sample_sizes)
+                return 0;
+            for (i = 0; i < total; i++) {
+                if ((unsigned)sc->sample_sizes[i] > 0x3FFFFFFF)
+                    return 0;
+                stream_size += (unsigned)sc->sample_sizes[i];
+            }
+        }
+    }
+    if (!total || total >= UINT_MAX / sizeof(*st->internal->index_entries))
+        return 0;
+
+    sc->lazy.stsc_first = av_malloc_array(sc->stsc_count, sizeof(*sc->lazy.stsc_first));
+    if (sc->lazy.chunk_packets)
+        sc->lazy.stsc_dts = av_malloc_array(sc->stsc_count, sizeof(*sc->lazy.stsc_dts));
+    else {
+        sc->lazy.stts_first = av_malloc_array(sc->stts_count, sizeof(*sc->lazy.stts_first));
+        sc->lazy.stts_dts   = av_malloc_array(sc->stts_count, sizeof(*sc->lazy.stts_dts));
+    }
+    if (!sc->lazy.stsc_first || (sc->lazy.chunk_packets ? !sc->lazy.stsc_dts :
+                                 !sc->lazy.stts_first || !sc->lazy.stts_dts)) {
+        mov_free_lazy_index(sc);
+        return AVERROR(ENOMEM);
+    }
+
+    first = 0;
+    for (i = 0; i < sc->stsc_count; i++) {
+        int64_t samples = mov_get_stsc_samples(sc, i);
+
+        sc->lazy.stsc_first[i] = FFMIN(first, UINT_MAX);
+        if (sc->lazy.chunk_packets) {
+            sc->lazy.stsc_dts[i] = current_dts;
+            current_dts += samples;
+            first += samples / sc->stsc_data[i].count * mov_lazy_chunk_samples(sc, i);
+        } else {
+            first += samples;
+        }
+    }
+
+    if (!sc->lazy.chunk_packets) {
+        current_dts -= sc->dts_shift;
+        first = 0;
+        for (i = 0; i < sc->stts_count; i++) {
+            sc->lazy.stts_first[i] = FFMIN(first, UINT_MAX);
+            sc->lazy.stts_dts[i]   = current_dts;
+            first       += sc->stts_data[i].count;
+            current_dts += sc->stts_data[i].count * (int64_t)sc->stts_data[i].duration;
+        }
+
+        sc->lazy.key_off  = sc->keyframe_count && sc->keyframes[0] > 0;
+        sc->lazy.all_keys = sc->keyframe_absent ? type == AVMEDIA_TYPE_AUDIO
+                                                : !sc->keyframe_count;
+        if (st->duration > 0)
+            st->codecpar->bit_rate = stream_size * 8 * sc->time_scale / st->duration;
+    } else {
+        sc->lazy.all_keys = 1;
+    }
+
+    sc->lazy.enabled    = 1;
+    sc->lazy.nb_samples = total;
+    mov_lazy_cursor_seek(sc, &sc->lazy.cur, 0);
+    mov_lazy_update_entry(sc);
+
+    if (type == AVMEDIA_TYPE_VIDEO) {
+        MOVSampleCursor cur = sc->lazy.cur;
+        for (i = 0; i < FFMIN(total, 99); i++) {
+            ff_rfps_add_frame(mov->fc, st, cur.dts);
+            mov_lazy_cursor_next(sc, &cur);
+        }
+    }
+
+    av_log(mov->fc, AV_LOG_DEBUG, "stream %d: %u samples resolved on demand\n",
+           st->index, sc->lazy.nb_samples);
+    return 1;
+}
+
 #define MAX_REORDER_DELAY 16
 static void mov_estimate_video_delay(MOVContext *c, AVStream* st)
 {
@@ -3393,6 +3855,8 @@ static void mov_estimate_video_delay(MOVContext *c, AVStream* st)
     int64_t pts_buf[MAX_REORDER_DELAY + 1]; // Circular buffer to sort pts.
     int buf_start = 0;
     int j, r, num_swaps;
+    int nb_samples = mov_get_nb_samples(st);
+    MOVSampleCursor cur;
 
     for (j = 0; j < MAX_REORDER_DELAY + 1; j++)
         pts_buf[j] = INT64_MIN;
@@ -3400,14 +3864,18 @@ static void mov_estimate_video_delay(MOVContext *c, AVStream* st)
     if (st->codecpar->video_delay <= 0 && msc->ctts_data &&
         st->codecpar->codec_id == AV_CODEC_ID_H264) {
         st->codecpar->video_delay = 0;
-        for (ind = 0; ind < st->internal->nb_index_entries && ctts_ind < msc->ctts_count; ++ind) {
+        if (msc->lazy.enabled)
+            mov_lazy_cursor_seek(msc, &cur, 0);
+        for (ind = 0; ind < nb_samples && ctts_ind < msc->ctts_count; ++ind) {
+            int64_t dts = msc->lazy.enabled ? cur.dts : st->internal->index_entries[ind].timestamp;
+
             // Point j to the last elem of the buffer and insert the current pts there.
             j = buf_start;
             buf_start = (buf_start + 1);
             if (buf_start == MAX_REORDER_DELAY + 1)
                 buf_start = 0;
 
-            pts_buf[j] = st->internal->index_entries[ind].timestamp + msc->ctts_data[ctts_ind].duration;
+            pts_buf[j] = dts + msc->ctts_data[ctts_ind].duration;
 
             // The timestamps that are already in the sorted buffer, and are greater than the
             // current pts, are exactly the timestamps that need to be buffered to output PTS
@@ -3434,6 +3902,8 @@ static void mov_estimate_video_delay(MOVContext *c, AVStream* st)
                 ctts_ind++;
                 ctts_sample = 0;
             }
+            if (msc->lazy.enabled)
+                mov_lazy_cursor_next(msc, &cur);
         }
         av_log(c->fc, AV_LOG_DEBUG, "Setting codecpar->delay to %d for stream st: %d\n",
                st->codecpar->video_delay, st->index);
@@ -3450,6 +3920,10 @@ static void mov_current_sample_inc(MOVStreamContext *sc)
         sc->current_index_range++;
         sc->current_index = sc->current_index_range->start;
     }
+    if (sc->lazy.enabled) {
+        mov_lazy_cursor_next(sc, &sc->lazy.cur);
+        mov_lazy_update_entry(sc);
+    }
 }
 
 static void mov_current_sample_dec(MOVStreamContext *sc)
@@ -3462,6 +3936,10 @@ static void mov_current_sample_dec(MOVStreamContext *sc)
         sc->current_index_range--;
         sc->current_index = sc->current_index_range->end - 1;
     }
+    if (sc->lazy.enabled) {
+        mov_lazy_cursor_seek(sc, &sc->lazy.cur, sc->current_sample);
+        mov_lazy_update_entry(sc);
+    }
 }
 
 static void mov_current_sample_set(MOVStreamContext *sc, int current_sample)
@@ -3470,6 +3948,10 @@ static void mov_current_sample_set(MOVStreamContext *sc, int current_sample)
 
     sc->current_sample = current_sample;
     sc->current_index = current_sample;
+    if (sc->lazy.enabled) {
+        mov_lazy_cursor_seek(sc, &sc->lazy.cur, current_sample);
+        mov_lazy_update_entry(sc);
+    }
     if (!sc->index_ranges) {
         return;
     }
@@ -3849,9 +4331,12 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
             sc->start_pad = start_time;
     }
 
+    if (mov->lazy_index && !sc->lazy.expanded &&
+        mov_init_lazy_index(mov, st, current_dts) > 0) {
+        /* samples are resolved from the sample tables on demand */
     /* only use old uncompressed audio chunk demuxing when stts specifies it */
-    if (!(st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
-          sc->stts_count == 1 && sc->stts_data[0].duration == 1)) {
+    } else if (!(st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
+                 sc->stts_count == 1 && sc->stts_data[0].duration == 1)) {
         unsigned int current_sample = 0;
         unsigned int stts_sample = 0;
         unsigned int sample_size;
@@ -3968,7 +4453,8 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
                     av_log(mov->fc, AV_LOG_TRACE, "AVIndex stream %d, sample %u, offset %"PRIx64", dts %"PRId64", "
                             "size %u, distance %u, keyframe %d\n", st->index, current_sample,
                             current_offset, current_dts, sample_size, distance, keyframe);
-                    if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && st->internal->nb_index_entries < 100)
+                    if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && st->internal->nb_index_entries < 100 &&
+                        !sc->lazy.expanded)
                         ff_rfps_add_frame(mov->fc, st, current_dts);
                 }
 
@@ -4114,8 +4600,8 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
     }
 
     // Update start time of the stream.
-    if (st->start_time == AV_NOPTS_VALUE && st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && st->internal->nb_index_entries > 0) {
-        st->start_time = st->internal->index_entries[0].timestamp + sc->dts_shift;
+    if (st->start_time == AV_NOPTS_VALUE && st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO && mov_get_nb_samples(st) > 0) {
+        st->start_time = mov_get_sample_timestamp(st, 0) + sc->dts_shift;
         if (sc->ctts_data) {
             st->start_time += sc->ctts_data[0].duration;
         }
@@ -4124,6 +4610,43 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
     mov_estimate_video_delay(mov, st);
 }
 
+static void mov_free_sample_tables(MOVStreamContext *sc)
+{
+    av_freep(&sc->chunk_offsets);
+    av_freep(&sc->sample_sizes);
+    av_freep(&sc->keyframes);
+    av_freep(&sc->stts_data);
+    av_freep(&sc->stps_data);
+    av_freep(&sc->elst_data);
+    av_freep(&sc->rap_group);
+}
+
+/**
+ * Build the full index of a stream with a lazy index, for the code paths
+ * that work on st->internal->index_entries directly.
+ */
+static void mov_expand_lazy_index(MOVContext *mov, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int current_sample = sc->current_sample;
+
+    if (!sc->lazy.enabled)
+        return;
+
+    av_log(mov->fc, AV_LOG_DEBUG, "stream %d: building the full index\n", st->index);
+    mov_free_lazy_index(sc);
+    sc->lazy.expanded = 1;
+    mov_build_index(mov, st);
+    mov_free_sample_tables(sc);
+
+    /* ctts is now expanded to one entry per sample */
+    mov_current_sample_set(sc, current_sample);
+    if (sc->ctts_data) {
+        sc->ctts_index  = current_sample;
+        sc->ctts_sample = 0;
+    }
+}
+
 static int test_same_origin(const char *src, const char *ref) {
     char src_proto[64];
     char ref_proto[64];
@@ -4352,14 +4875,9 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         && sc->time_scale == st->codecpar->sample_rate) {
             st->need_parsing = AVSTREAM_PARSE_FULL;
     }
-    /* Do not need those anymore. */
-    av_freep(&sc->chunk_offsets);
-    av_freep(&sc->sample_sizes);
-    av_freep(&sc->keyframes);
-    av_freep(&sc->stts_data);
-    av_freep(&sc->stps_data);
-    av_freep(&sc->elst_data);
-    av_freep(&sc->rap_group);
+    /* Do not need those anymore, unless samples are resolved on demand. */
+    if (!sc->lazy.enabled)
+        mov_free_sample_tables(sc);
 
     return 0;
 }
@@ -4806,6 +5324,7 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     sc = st->priv_data;
     if (sc->pseudo_stream_id+1 != frag->stsd_id && sc->pseudo_stream_id != -1)
         return 0;
+    mov_expand_lazy_index(c, st);
 
     // Find the next frag_index index that has a valid index_entry for
     // the current track_id.
@@ -7209,6 +7728,7 @@ static void mov_read_chapters(AVFormatContext *s)
 
         sc = st->priv_data;
         cur_pos = avio_tell(sc->pb);
+        mov_expand_lazy_index(mov, st);
 
         if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
             st->disposition |= AV_DISPOSITION_ATTACHED_PIC | AV_DISPOSITION_TIMED_THUMBNAILS;
@@ -7399,6 +7919,7 @@ static int mov_read_close(AVFormatContext *s)
         av_freep(&sc->rap_group);
         av_freep(&sc->display_matrix);
         av_freep(&sc->index_ranges);
+        mov_free_lazy_index(sc);
 
         if (sc->extradata)
             for (j = 0; j < sc->stsd_count; j++)
@@ -7798,8 +8319,8 @@ static AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *avst = s->streams[i];
         MOVStreamContext *msc = avst->priv_data;
-        if (msc->pb && msc->current_sample < avst->internal->nb_index_entries) {
-            AVIndexEntry *current_sample = &avst->internal->index_entries[msc->current_sample];
+        AVIndexEntry *current_sample = mov_get_current_entry(avst);
+        if (msc->pb && current_sample) {
             int64_t dts = av_rescale(current_sample->timestamp, AV_TIME_BASE, msc->time_scale);
             av_log(s, AV_LOG_TRACE, "stream %d, sample %d, dts %"PRId64"\n", i, msc->current_sample, dts);
             if (!sample || (!(s->pb->seekable & AVIO_SEEKABLE_NORMAL) && current_sample->pos < sample->pos) ||
@@ -7907,7 +8428,7 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
 {
     MOVContext *mov = s->priv_data;
     MOVStreamContext *sc;
-    AVIndexEntry *sample;
+    AVIndexEntry *sample, lazy_sample;
     AVStream *st = NULL;
     int64_t current_index;
     int ret;
@@ -7922,6 +8443,11 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
         goto retry;
     }
     sc = st->priv_data;
+    if (sc->lazy.enabled) {
+        /* the cursor entry moves on with the current sample */
+        lazy_sample = *sample;
+        sample = &lazy_sample;
+    }
     /* must be done just before reading, to avoid infinite loop on sample */
     current_index = sc->current_index;
     mov_current_sample_inc(sc);
@@ -8002,8 +8528,8 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
             sc->ctts_sample = 0;
         }
     } else {
-        int64_t next_dts = (sc->current_sample < st->internal->nb_index_entries) ?
-            st->internal->index_entries[sc->current_sample].timestamp : st->duration;
+        int64_t next_dts = (sc->current_sample < mov_get_nb_samples(st)) ?
+            mov_get_sample_timestamp(st, sc->current_sample) : st->duration;
 
         if (next_dts >= pkt->dts)
             pkt->duration = next_dts - pkt->dts;
@@ -8082,9 +8608,12 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
     if (ret < 0)
         return ret;
 
-    sample = av_index_search_timestamp(st, timestamp, flags);
+    if (sc->lazy.enabled)
+        sample = mov_lazy_search_timestamp(sc, timestamp, flags);
+    else
+        sample = av_index_search_timestamp(st, timestamp, flags);
     av_log(s, AV_LOG_TRACE, "stream %d, timestamp %"PRId64", sample %d\n", st->index, timestamp, sample);
-    if (sample < 0 && st->internal->nb_index_entries && timestamp < st->internal->index_entries[0].timestamp)
+    if (sample < 0 && mov_get_nb_samples(st) && timestamp < mov_get_sample_timestamp(st, 0))
         sample = 0;
     if (sample < 0) /* not sure what to do */
         return AVERROR_INVALIDDATA;
@@ -8125,8 +8654,8 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
 static int64_t mov_get_skip_samples(AVStream *st, int sample)
 {
     MOVStreamContext *sc = st->priv_data;
-    int64_t first_ts = st->internal->index_entries[0].timestamp;
-    int64_t ts = st->internal->index_entries[sample].timestamp;
+    int64_t first_ts = mov_get_sample_timestamp(st, 0);
+    int64_t ts = mov_get_sample_timestamp(st, sample);
     int64_t off;
 
     if (st->codecpar->codec_type != AVMEDIA_TYPE_AUDIO)
@@ -8155,7 +8684,7 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
 
     if (mc->seek_individually) {
         /* adjust seek timestamp to found sample timestamp */
-        int64_t seek_timestamp = st->internal->index_entries[sample].timestamp;
+        int64_t seek_timestamp = mov_get_sample_timestamp(st, sample);
         st->internal->skip_samples = mov_get_skip_samples(st, sample);
 
         for (i = 0; i < s->nb_streams; i++) {
@@ -8238,6 +8767,8 @@ static const AVOption mov_options[] = {
     { "decryption_key", "The media decryption key (hex)", OFFSET(decryption_key), AV_OPT_TYPE_BINARY, .flags = AV_OPT_FLAG_DECODING_PARAM },
     { "enable_drefs", "Enable external track support.", OFFSET(enable_drefs), AV_OPT_TYPE_BOOL,
         {.i64 = 0}, 0, 1, FLAGS },
+    { "lazy_index", "Resolve samples from the sample tables on demand instead of building a full index",
+        OFFSET(lazy_index), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, FLAGS },
 
     { NULL },
 };
@@ -107,6 +107,7 @@ static const AVOption options[] = {
     { "wallclock", NULL, 0, AV_OPT_TYPE_CONST, {.i64 = MOV_PRFT_SRC_WALLCLOCK}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM, "prft"},
     { "pts", NULL, 0, AV_OPT_TYPE_CONST, {.i64 = MOV_PRFT_SRC_PTS}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM, "prft"},
     { "empty_hdlr_name", "write zero-length name string in hdlr atoms within mdia and minf atoms", offsetof(MOVMuxContext, empty_hdlr_name), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM},
+    { "faststart_reserve", "With faststart, reserve the estimated moov size before the data and only run the second pass if it does not fit", offsetof(MOVMuxContext, faststart_reserve), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM},
     { NULL },
 };
 
@@ -6382,6 +6383,66 @@ static int mov_create_dvd_sub_decoder_specific_info(MOVTrack *track,
     return 0;
 }
 
+/*
+ * Estimate the size of the moov atom from the duration hints of the streams,
+ * assuming the worst usual case for the sample tables: one chunk per sample
+ * with 64-bit offsets, plus composition offsets and sync samples for video.
+ * Returns 0 if a stream has no duration hint.
+ */
+static int estimate_moov_size(AVFormatContext *s)
+{
+    MOVMuxContext *mov = s->priv_data;
+    AVDictionaryEntry *t = NULL;
+    int64_t size = 4096 + 1024 * (mov->nb_streams - s->nb_streams) +
+                   128 * s->nb_chapters;
+    int i;
+
+    while ((t = av_dict_get(s->metadata, "", t, AV_DICT_IGNORE_SUFFIX)))
+        size += strlen(t->key) + strlen(t->value) + 32;
+
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        AVCodecParameters *par = st->codecpar;
+        AVRational rate;
+        int entry_size;
+
+        if (st->duration <= 0 || st->time_base.num <= 0) {
+            av_log(s, AV_LOG_VERBOSE, "No duration hint for stream #%d, "
+                   "not reserving space for the moov atom\n", i);
+            return 0;
+        }
+
+        switch (par->codec_type) {
+        case AVMEDIA_TYPE_VIDEO:
+            rate = st->avg_frame_rate.num > 0 ? st->avg_frame_rate : st->r_frame_rate;
+            if (rate.num <= 0 || rate.den <= 0)
+                rate = (AVRational){ 60, 1 };
+            entry_size = 4 + 8 + 8 + 4;
+            break;
+        case AVMEDIA_TYPE_AUDIO:
+            rate = (AVRational){ par->sample_rate,
+                                 par->frame_size > 1 ? par->frame_size : 1024 };
+            if (rate.num <= 0)
+                rate = (AVRational){ 50, 1 };
+            entry_size = 4 + 8 + 8;
+            break;
+        default:
+            rate = (AVRational){ 10, 1 };
+            entry_size = 4 + 8 + 8;
+            break;
+        }
+
+        size += 1024 + par->extradata_size;
+        size += (av_rescale_q(st->duration, st->time_base, av_inv_q(rate)) + 1) * entry_size;
+        for (t = NULL; (t = av_dict_get(st->metadata, "", t, AV_DICT_IGNORE_SUFFIX)); )
+            size += strlen(t->key) + strlen(t->value) + 32;
+        if (size > INT_MAX / 2)
+            return 0;
+    }
+
+    return size + size / 8;
+}
+
 static int mov_init(AVFormatContext *s)
 {
     MOVMuxContext *mov = s->priv_data;
@@ -6559,6 +6620,11 @@ static int mov_init(AVFormatContext *s)
         }
     }
 
+    /* before the stream time bases are changed to the track timescales */
+    if (mov->flags & FF_MOV_FLAG_FASTSTART && mov->faststart_reserve &&
+        !(mov->flags & FF_MOV_FLAG_FRAGMENT))
+        mov->moov_estimate = estimate_moov_size(s);
+
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *st= s->streams[i];
         MOVTrack *track= &mov->tracks[i];
@@ -6798,8 +6864,14 @@ static int mov_write_header(AVFormatContext *s)
             !mov->max_fragment_duration && !mov->max_fragment_size)
             mov->flags |= FF_MOV_FLAG_FRAG_KEYFRAME;
     } else {
-        if (mov->flags & FF_MOV_FLAG_FASTSTART)
+        if (mov->flags & FF_MOV_FLAG_FASTSTART) {
             mov->reserved_header_pos = avio_tell(pb);
+            if (mov->moov_estimate > 0) {
+                avio_wb32(pb, mov->moov_estimate);
+                ffio_wfourcc(pb, "free");
+                ffio_fill(pb, 0, mov->moov_estimate - 8);
+            }
+        }
         mov_write_mdat_tag(pb, mov);
     }
 
@@ -7062,7 +7134,26 @@ static int mov_write_trailer(AVFormatContext *s)
         }
         avio_seek(pb, mov->reserved_moov_size > 0 ? mov->reserved_header_pos : moov_pos, SEEK_SET);
 
-        if (mov->flags & FF_MOV_FLAG_FASTSTART) {
+        if (mov->moov_estimate > 0 &&
+            (res = get_moov_size(s)) >= 0 &&
+            (res == mov->moov_estimate || res + 8 <= mov->moov_estimate)) {
+            /* the moov atom fits in the reserved space */
+            int64_t size = mov->moov_estimate - res;
+            avio_seek(pb, mov->reserved_header_pos, SEEK_SET);
+            if ((res = mov_write_moov_tag(pb, mov, s)) < 0)
+                return res;
+            if (size) {
+                avio_wb32(pb, size);
+                ffio_wfourcc(pb, "free");
+            }
+            avio_seek(pb, moov_pos, SEEK_SET);
+        } else if (mov->flags & FF_MOV_FLAG_FASTSTART) {
+            if (res < 0)
+                return res;
+            if (mov->moov_estimate > 0)
+                av_log(s, AV_LOG_WARNING, "The moov atom does not fit in the "
+                       "%d bytes reserved, the reserved space is kept as padding\n",
+                       mov->moov_estimate);
             av_log(s, AV_LOG_INFO, "Starting second pass: moving the moov atom to the beginning of the file\n");
             res = shift_data(s);
             if (res < 0)
@@ -209,6 +209,8 @@ typedef struct MOVMuxContext {
 
     int reserved_moov_size; ///< 0 for disabled, -1 for automatic, size otherwise
     int64_t reserved_header_pos;
+    int faststart_reserve;
+    int moov_estimate;      ///< space reserved for the moov atom with faststart_reserve, 0 if none
 
     char *major_brand;
 
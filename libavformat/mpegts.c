@@ -48,6 +48,8 @@
 #define MAX_RESYNC_SIZE 65536
 
 #define MAX_PES_PAYLOAD 200 * 1024
+/* size limit of the unbounded video PES packets kept whole */
+#define MAX_COMPLETE_PES_PAYLOAD (64 << 20)
 
 #define MAX_MP4_DESCR_COUNT 16
 
@@ -162,6 +164,7 @@ struct MpegTSContext {
 
     int resync_size;
     int merge_pmt_versions;
+    int pes_complete_frames;
 
     /******************************************/
     /* private mpegts data */
@@ -173,6 +176,9 @@ struct MpegTSContext {
     int8_t crc_validity[NB_PID_MAX];
     /** filters for various streams specified by PMT + for the PAT and PMT */
     MpegTSFilter *pids[NB_PID_MAX];
+    /** bitmap of the pids whose packets are handled; packets of the other
+     *  pids are skipped unless they start a payload unit */
+    uint32_t active_pids[NB_PID_MAX / 32];
     int current_pid;
 
     AVStream *epg_stream;
@@ -198,6 +204,8 @@ static const AVOption options[] = {
      {.i64 = 0}, 0, 1, 0 },
     {"skip_clear", "skip clearing programs", offsetof(MpegTSContext, skip_clear), AV_OPT_TYPE_BOOL,
      {.i64 = 0}, 0, 1, 0 },
+    {"pes_complete_frames", "assume video PES packets carry complete frames and output them as they are", offsetof(MpegTSContext, pes_complete_frames), AV_OPT_TYPE_BOOL,
+     {.i64 = 0}, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { NULL },
 };
 
@@ -479,6 +487,19 @@ static void write_section_data(MpegTSContext *ts, MpegTSFilter *tss1,
     }
 }
 
+static av_always_inline int pid_is_active(const MpegTSContext *ts, int pid)
+{
+    return ts->active_pids[pid >> 5] & (1U << (pid & 31));
+}
+
+static void set_pid_active(MpegTSContext *ts, int pid, int active)
+{
+    if (active)
+        ts->active_pids[pid >> 5] |=  1U << (pid & 31);
+    else
+        ts->active_pids[pid >> 5] &= ~(1U << (pid & 31));
+}
+
 static MpegTSFilter *mpegts_open_filter(MpegTSContext *ts, unsigned int pid,
                                         enum MpegTSFilterType type)
 {
@@ -492,6 +513,7 @@ static MpegTSFilter *mpegts_open_filter(MpegTSContext *ts, unsigned int pid,
     if (!filter)
         return NULL;
     ts->pids[pid] = filter;
+    set_pid_active(ts, pid, 1);
 
     filter->type    = type;
     filter->pid     = pid;
@@ -569,6 +591,7 @@ static void mpegts_close_filter(MpegTSContext *ts, MpegTSFilter *filter)
 
     av_free(filter);
     ts->pids[pid] = NULL;
+    set_pid_active(ts, pid, 0);
 }
 
 static int analyze(const uint8_t *buf, int size, int packet_size,
@@ -952,6 +975,10 @@ static int mpegts_set_stream_info(AVStream *st, PESContext *pes,
         st->codecpar->codec_id  = old_codec_id;
         st->codecpar->codec_type = old_codec_type;
     }
+    /* the PES buffer is output as is, the parser only reads the headers */
+    if (pes->ts->pes_complete_frames &&
+        st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+        st->need_parsing = AVSTREAM_PARSE_HEADERS;
     if ((st->codecpar->codec_id == AV_CODEC_ID_NONE ||
             (st->internal->request_probe > 0 && st->internal->request_probe < AVPROBE_SCORE_STREAM_RETRY / 5)) &&
         st->probe_packets > 0 &&
@@ -1116,6 +1143,22 @@ static AVBufferRef *buffer_pool_get(MpegTSContext *ts, int size)
     return av_buffer_pool_get(ts->pools[index]);
 }
 
+/**
+ * Make room for size bytes of payload in an unbounded PES packet which is
+ * kept whole. Only the first growth copies out of the pool buffer, the
+ * following ones usually extend the allocation in place.
+ */
+static int grow_pes_buffer(PESContext *pes, int size)
+{
+    size_t needed = (size_t)size + AV_INPUT_BUFFER_PADDING_SIZE;
+
+    if (pes->buffer->size >= needed)
+        return 0;
+    return av_buffer_realloc(&pes->buffer,
+                             FFMIN(FFMAX(needed, 2 * pes->buffer->size),
+                                   MAX_COMPLETE_PES_PAYLOAD + AV_INPUT_BUFFER_PADDING_SIZE));
+}
+
 /* return non zero if a packet could be constructed */
 static int mpegts_push_data(MpegTSFilter *filter,
                             const uint8_t *buf, int buf_size, int is_start,
@@ -1358,8 +1401,16 @@ skip:
             break;
         case MPEGTS_PAYLOAD:
             if (pes->buffer) {
-                if (pes->data_index > 0 &&
-                    pes->data_index + buf_size > pes->total_size) {
+                if (ts->pes_complete_frames &&
+                    pes->total_size == MAX_PES_PAYLOAD &&
+                    pes->st->need_parsing == AVSTREAM_PARSE_HEADERS &&
+                    pes->data_index + buf_size > pes->total_size &&
+                    pes->data_index + buf_size <= MAX_COMPLETE_PES_PAYLOAD) {
+                    ret = grow_pes_buffer(pes, pes->data_index + buf_size);
+                    if (ret < 0)
+                        return ret;
+                } else if (pes->data_index > 0 &&
+                           pes->data_index + buf_size > pes->total_size) {
                     ret = new_pes_packet(pes, ts->pkt);
                     if (ret < 0)
                         return ret;
@@ -2713,6 +2764,28 @@ static void sdt_cb(MpegTSFilter *filter, const uint8_t *section, int section_len
 static int parse_pcr(int64_t *ppcr_high, int *ppcr_low,
                      const uint8_t *packet);
 
+/**
+ * Check whether the packets following a payload unit start can be skipped
+ * for this pid: the PES belongs to discarded streams and does not carry the
+ * PCR of a program.
+ */
+static int skip_pid_payload(MpegTSContext *ts, MpegTSFilter *tss)
+{
+    PESContext *pes;
+    int i;
+
+    if (tss->type != MPEGTS_PES)
+        return 0;
+    pes = tss->u.pes_filter.opaque;
+    if (!pes->st || pes->st->discard != AVDISCARD_ALL ||
+        (pes->sub_st && pes->sub_st->discard != AVDISCARD_ALL))
+        return 0;
+    for (i = 0; i < ts->stream->nb_programs; i++)
+        if (ts->stream->programs[i]->pcr_pid == tss->pid)
+            return 0;
+    return 1;
+}
+
 /* handle one TS packet */
 static int handle_packet(MpegTSContext *ts, const uint8_t *packet, int64_t pos)
 {
@@ -2723,6 +2796,8 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet, int64_t pos)
 
     pid = AV_RB16(packet + 1) & 0x1fff;
     is_start = packet[1] & 0x40;
+    if (!is_start && !pid_is_active(ts, pid))
+        return 0;
     tss = ts->pids[pid];
     if (ts->auto_guess && !tss && is_start) {
         add_pes_stream(ts, pid, -1);
@@ -2730,8 +2805,13 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet, int64_t pos)
     }
     if (!tss)
         return 0;
-    if (is_start)
+    if (is_start) {
+        /* the continuity counter was not followed while skipping */
+        if (!pid_is_active(ts, pid))
+            tss->last_cc = -1;
         tss->discard = discard_pid(ts, pid);
+        set_pid_active(ts, pid, !tss->discard && !skip_pid_payload(ts, tss));
+    }
     if (tss->discard)
         return 0;
     ts->current_pid = pid;
@@ -2928,6 +3008,41 @@ static void finished_reading_packet(AVFormatContext *s, int raw_packet_size)
         avio_skip(pb, skip);
 }
 
+/**
+ * Handle the packets which are already complete in the I/O buffer in place,
+ * skipping the packets of inactive pids without any call.
+ *
+ * @return the number of packets consumed, stopping at the first packet
+ *         without sync byte, or a negative error code
+ */
+static int handle_buffered_packets(MpegTSContext *ts, int max_packets)
+{
+    AVIOContext *pb = ts->stream->pb;
+    const int raw_packet_size = ts->raw_packet_size;
+    const uint8_t *p = pb->buf_ptr;
+    int i, nb, ret;
+
+    nb = FFMIN((pb->buf_end - pb->buf_ptr) / raw_packet_size, max_packets);
+    for (i = 0; i < nb && !ts->stop_parse; i++, p += raw_packet_size) {
+        int pid;
+        if (p[0] != 0x47)
+            break;
+        pid = AV_RB16(p + 1) & 0x1fff;
+        if (!(p[1] & 0x40) && !pid_is_active(ts, pid))
+            continue;
+        /* same position as after read_packet() */
+        pb->buf_ptr = (uint8_t *)p + TS_PACKET_SIZE;
+        ret = handle_packet(ts, p, avio_tell(pb));
+        if (ret != 0) {
+            pb->buf_ptr = (uint8_t *)p + raw_packet_size;
+            return ret;
+        }
+    }
+    pb->buf_ptr = (uint8_t *)p;
+
+    return i;
+}
+
 static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
 {
     AVFormatContext *s = ts->stream;
@@ -2969,6 +3084,15 @@ static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
         if (ts->stop_parse > 0)
             break;
 
+        ret = handle_buffered_packets(ts, nb_packets ? FFMIN(nb_packets - packet_num, INT_MAX) : INT_MAX);
+        if (ret < 0)
+            break;
+        if (ret > 0) {
+            packet_num += ret - 1;
+            ret = 0;
+            continue;
+        }
+
         ret = read_packet(s, packet, ts->raw_packet_size, &data);
         if (ret != 0)
             break;
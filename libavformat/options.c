@@ -196,6 +196,17 @@ static void io_close_default(AVFormatContext *s, AVIOContext *pb)
     avio_close(pb);
 }
 
+int ff_format_io_open_is_default(AVFormatContext *s)
+{
+#if FF_API_OLD_OPEN_CALLBACKS
+FF_DISABLE_DEPRECATION_WARNINGS
+    if (s->open_cb)
+        return 0;
+FF_ENABLE_DEPRECATION_WARNINGS
+#endif
+    return s->io_open == io_open_default;
+}
+
 static void avformat_get_context_defaults(AVFormatContext *s)
 {
     memset(s, 0, sizeof(AVFormatContext));
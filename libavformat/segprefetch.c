@@ -0,0 +1,466 @@
+/*
+ * Segment prefetching for the adaptive streaming demuxers
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <string.h>
+
+#include "libavutil/avstring.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "internal.h"
+#include "segprefetch.h"
+#include "url.h"
+
+#define CHUNK_SIZE 65536
+
+#if HAVE_THREADS
+/* Must be called with lock held. */
+static void entry_free(SegPrefetchPool *p, SegPrefetchEntry *e)
+{
+    p->bytes -= e->buf_size;
+    av_freep(&e->buf);
+    av_freep(&e->url);
+    av_dict_free(&e->avio_opts);
+    av_free(e);
+}
+
+/* Must be called with lock held. */
+static void entry_abandon(SegPrefetchPool *p, SegPrefetchEntry *e)
+{
+    if (e->state == SEG_PREFETCH_RUNNING)
+        e->abandoned = 1;
+    else
+        entry_free(p, e);
+}
+
+/* Must be called with lock held. */
+static void queue_remove(SegPrefetchQueue *q, int i, int abandon)
+{
+    if (abandon)
+        entry_abandon(q->pool, q->entries[i]);
+    memmove(q->entries + i, q->entries + i + 1,
+            (q->nb_entries - i - 1) * sizeof(*q->entries));
+    q->nb_entries--;
+}
+
+/* Pick the queued segment the demuxer will need first, over all queues.
+ * Must be called with lock held. */
+static SegPrefetchEntry *next_job(SegPrefetchPool *p)
+{
+    SegPrefetchEntry *job = NULL;
+    int i, j, best = INT_MAX;
+
+    for (i = 0; i < p->nb_queues; i++) {
+        SegPrefetchQueue *q = p->queues[i];
+        for (j = 0; j < q->nb_entries && j < best; j++) {
+            if (q->entries[j]->state == SEG_PREFETCH_QUEUED) {
+                job  = q->entries[j];
+                best = j;
+                break;
+            }
+        }
+    }
+    return job;
+}
+
+/* The segment being read by the demuxer may always grow, everything else
+ * has to stay below max_bytes. */
+static int may_grow(SegPrefetchPool *p, SegPrefetchEntry *e, int64_t size)
+{
+    return e == e->queue->cur || p->bytes + size <= p->max_bytes;
+}
+
+/* Interrupt the I/O of a worker once its segment is no longer needed, so
+ * that seeking and closing do not wait for the download. */
+static int check_interrupt(void *opaque)
+{
+    SegPrefetchEntry *e = opaque;
+    SegPrefetchPool *p = e->queue->pool;
+    int ret;
+
+    pthread_mutex_lock(&p->lock);
+    ret = p->abort || e->abandoned;
+    pthread_mutex_unlock(&p->lock);
+    return ret;
+}
+
+static int download(SegPrefetchPool *p, SegPrefetchEntry *e)
+{
+    AVIOContext *in = NULL;
+    FFIOInterruptChain int_cb;
+    int64_t size;
+    int ret;
+
+    ff_interrupt_chain_init(&int_cb, check_interrupt, e, &p->s->interrupt_callback);
+    ret = p->open(e->queue->opaque, e, &in, &size, &int_cb.cb);
+    if (ret < 0)
+        return ret;
+
+    for (;;) {
+        int64_t want = size > 0 ? size - e->data_len : CHUNK_SIZE;
+        uint8_t *dst;
+
+        if (want <= 0) {
+            ret = AVERROR_EOF;
+            break;
+        }
+        want = FFMIN(want, CHUNK_SIZE);
+
+        pthread_mutex_lock(&p->lock);
+        if (e->data_len + want > e->buf_size) {
+            int64_t new_size = size > 0 ? size : FFMAX(2 * e->buf_size, e->data_len + want);
+            uint8_t *buf;
+
+            while (!e->abandoned && !p->abort &&
+                   !may_grow(p, e, new_size - e->buf_size))
+                pthread_cond_wait(&p->cond, &p->lock);
+            if (e->abandoned || p->abort) {
+                pthread_mutex_unlock(&p->lock);
+                ret = AVERROR_EXIT;
+                break;
+            }
+            if (new_size > INT_MAX || !(buf = av_realloc(e->buf, new_size))) {
+                pthread_mutex_unlock(&p->lock);
+                ret = AVERROR(ENOMEM);
+                break;
+            }
+            p->bytes   += new_size - e->buf_size;
+            e->buf      = buf;
+            e->buf_size = new_size;
+        }
+        /* Only this thread moves e->buf and the demuxer never reads past
+         * data_len, so the data can be written without holding the lock. */
+        dst = e->buf + e->data_len;
+        pthread_mutex_unlock(&p->lock);
+
+        ret = avio_read(in, dst, want);
+        if (ret <= 0) {
+            if (!ret)
+                ret = AVERROR_EOF;
+            break;
+        }
+
+        pthread_mutex_lock(&p->lock);
+        e->data_len += ret;
+        pthread_cond_broadcast(&p->cond);
+        if (e->abandoned || p->abort)
+            ret = AVERROR_EXIT;
+        pthread_mutex_unlock(&p->lock);
+        if (ret < 0)
+            break;
+    }
+
+    ff_format_io_close(p->s, &in);
+    return ret;
+}
+
+static void *worker(void *arg)
+{
+    SegPrefetchPool *p = arg;
+
+    pthread_mutex_lock(&p->lock);
+    while (!p->abort) {
+        SegPrefetchEntry *e = next_job(p);
+        int ret;
+
+        if (!e) {
+            pthread_cond_wait(&p->cond, &p->lock);
+            continue;
+        }
+        e->state = SEG_PREFETCH_RUNNING;
+        pthread_mutex_unlock(&p->lock);
+
+        ret = download(p, e);
+
+        pthread_mutex_lock(&p->lock);
+        e->state = SEG_PREFETCH_DONE;
+        e->error = ret;
+        if (e->abandoned)
+            entry_free(p, e);
+        pthread_cond_broadcast(&p->cond);
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    return NULL;
+}
+
+int ff_segprefetch_init(SegPrefetchPool *p, int nb_threads)
+{
+    int i, ret;
+
+    if (!(p->workers = av_calloc(nb_threads, sizeof(*p->workers))))
+        return AVERROR(ENOMEM);
+    if ((ret = pthread_mutex_init(&p->lock, NULL))) {
+        av_freep(&p->workers);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&p->cond, NULL))) {
+        pthread_mutex_destroy(&p->lock);
+        av_freep(&p->workers);
+        return AVERROR(ret);
+    }
+
+    for (i = 0; i < nb_threads; i++) {
+        if ((ret = pthread_create(&p->workers[i], NULL, worker, p))) {
+            av_log(p->s, AV_LOG_ERROR, "pthread_create failed : %s\n", av_err2str(AVERROR(ret)));
+            break;
+        }
+        p->nb_workers++;
+    }
+    if (!p->nb_workers) {
+        pthread_cond_destroy(&p->cond);
+        pthread_mutex_destroy(&p->lock);
+        av_freep(&p->workers);
+        return AVERROR(ret);
+    }
+    return 0;
+}
+
+void ff_segprefetch_uninit(SegPrefetchPool *p)
+{
+    int i;
+
+    if (!p->workers)
+        return;
+
+    pthread_mutex_lock(&p->lock);
+    p->abort = 1;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+
+    for (i = 0; i < p->nb_workers; i++)
+        pthread_join(p->workers[i], NULL);
+
+    /* All workers are gone, so every entry is still owned by a queue. */
+    for (i = 0; i < p->nb_queues; i++) {
+        SegPrefetchQueue *q = p->queues[i];
+        while (q->nb_entries)
+            queue_remove(q, q->nb_entries - 1, 1);
+        if (q->cur)
+            entry_free(p, q->cur);
+        q->cur = NULL;
+        av_freep(&q->entries);
+        q->pool = NULL;
+    }
+    av_freep(&p->queues);
+    p->nb_queues = 0;
+
+    pthread_cond_destroy(&p->cond);
+    pthread_mutex_destroy(&p->lock);
+    av_freep(&p->workers);
+    p->nb_workers = 0;
+    p->abort = 0;
+}
+
+int ff_segprefetch_queue_add(SegPrefetchPool *p, SegPrefetchQueue *q,
+                             void *opaque, int max_entries)
+{
+    int ret;
+
+    if (max_entries <= 0 || max_entries > SEG_PREFETCH_MAX_ENTRIES)
+        return AVERROR(EINVAL);
+    if (!(q->entries = av_calloc(max_entries, sizeof(*q->entries))))
+        return AVERROR(ENOMEM);
+
+    q->pool        = p;
+    q->opaque      = opaque;
+    q->nb_entries  = 0;
+    q->max_entries = max_entries;
+    q->cur         = NULL;
+
+    pthread_mutex_lock(&p->lock);
+    ret = av_dynarray_add_nofree(&p->queues, &p->nb_queues, q);
+    pthread_mutex_unlock(&p->lock);
+
+    if (ret < 0) {
+        av_freep(&q->entries);
+        q->pool = NULL;
+    }
+    return ret;
+}
+
+void ff_segprefetch_schedule(SegPrefetchQueue *q, const SegPrefetchSegment *segs,
+                             int nb_segs, AVDictionary *avio_opts)
+{
+    SegPrefetchEntry *queue[SEG_PREFETCH_MAX_ENTRIES];
+    SegPrefetchPool *p = q->pool;
+    int n = 0, i;
+
+    if (!p)
+        return;
+
+    pthread_mutex_lock(&p->lock);
+    for (; n < FFMIN(nb_segs, q->max_entries); n++) {
+        const SegPrefetchSegment *seg = &segs[n];
+        SegPrefetchEntry *e = NULL;
+
+        for (i = 0; i < q->nb_entries; i++) {
+            if (q->entries[i]->url_offset == seg->url_offset &&
+                !strcmp(q->entries[i]->url, seg->url)) {
+                e = q->entries[i];
+                queue_remove(q, i, 0);
+                break;
+            }
+        }
+        if (!e) {
+            if (!(e = av_mallocz(sizeof(*e))))
+                break;
+            e->queue      = q;
+            e->url_offset = seg->url_offset;
+            e->size       = seg->size;
+            if (!(e->url = av_strdup(seg->url)) ||
+                av_dict_copy(&e->avio_opts, avio_opts, 0) < 0) {
+                entry_free(p, e);
+                break;
+            }
+        }
+        queue[n] = e;
+    }
+
+    /* whatever is left is no longer needed */
+    while (q->nb_entries)
+        queue_remove(q, q->nb_entries - 1, 1);
+    memcpy(q->entries, queue, n * sizeof(*queue));
+    q->nb_entries = n;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+}
+
+int ff_segprefetch_take(SegPrefetchQueue *q, const char *url, int64_t url_offset)
+{
+    SegPrefetchPool *p = q->pool;
+    int i;
+
+    if (!p)
+        return 0;
+
+    pthread_mutex_lock(&p->lock);
+    for (i = 0; i < q->nb_entries; i++) {
+        SegPrefetchEntry *e = q->entries[i];
+
+        if (e->url_offset != url_offset || strcmp(e->url, url))
+            continue;
+        /* the segments before it were skipped */
+        while (i--)
+            queue_remove(q, 0, 1);
+        if (e->state == SEG_PREFETCH_QUEUED ||
+            (e->state == SEG_PREFETCH_DONE && e->error != AVERROR_EOF && !e->data_len)) {
+            queue_remove(q, 0, 1);
+        } else {
+            q->cur = e;
+            queue_remove(q, 0, 0);
+            /* its worker may be waiting for memory it can use now */
+            pthread_cond_broadcast(&p->cond);
+        }
+        break;
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    return !!q->cur;
+}
+
+int ff_segprefetch_read(SegPrefetchQueue *q, uint8_t *buf, int buf_size)
+{
+    SegPrefetchPool *p = q->pool;
+    SegPrefetchEntry *e = q->cur;
+    int ret;
+
+    pthread_mutex_lock(&p->lock);
+    while (e->read_pos == e->data_len && e->state != SEG_PREFETCH_DONE) {
+        int64_t t = av_gettime() + 100000;
+        struct timespec tv = { .tv_sec  =  t / 1000000,
+                               .tv_nsec = (t % 1000000) * 1000 };
+        if (ff_check_interrupt(&p->s->interrupt_callback)) {
+            pthread_mutex_unlock(&p->lock);
+            return AVERROR_EXIT;
+        }
+        pthread_cond_timedwait(&p->cond, &p->lock, &tv);
+    }
+    if (e->read_pos < e->data_len) {
+        ret = FFMIN(buf_size, e->data_len - e->read_pos);
+        memcpy(buf, e->buf + e->read_pos, ret);
+        e->read_pos += ret;
+    } else {
+        ret = e->error;
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    return ret;
+}
+
+void ff_segprefetch_release(SegPrefetchQueue *q)
+{
+    SegPrefetchPool *p = q->pool;
+
+    if (!q->cur)
+        return;
+
+    pthread_mutex_lock(&p->lock);
+    entry_abandon(p, q->cur);
+    q->cur = NULL;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+}
+
+void ff_segprefetch_flush(SegPrefetchQueue *q)
+{
+    SegPrefetchPool *p = q->pool;
+
+    if (!p)
+        return;
+
+    pthread_mutex_lock(&p->lock);
+    while (q->nb_entries)
+        queue_remove(q, q->nb_entries - 1, 1);
+    if (q->cur)
+        entry_abandon(p, q->cur);
+    q->cur = NULL;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+}
+#else
+int ff_segprefetch_init(SegPrefetchPool *p, int nb_threads)
+{
+    return AVERROR(ENOSYS);
+}
+
+void ff_segprefetch_uninit(SegPrefetchPool *p) { }
+
+int ff_segprefetch_queue_add(SegPrefetchPool *p, SegPrefetchQueue *q,
+                             void *opaque, int max_entries)
+{
+    return AVERROR(ENOSYS);
+}
+
+void ff_segprefetch_schedule(SegPrefetchQueue *q, const SegPrefetchSegment *segs,
+                             int nb_segs, AVDictionary *avio_opts) { }
+
+int ff_segprefetch_take(SegPrefetchQueue *q, const char *url, int64_t url_offset)
+{
+    return 0;
+}
+
+int ff_segprefetch_read(SegPrefetchQueue *q, uint8_t *buf, int buf_size)
+{
+    return AVERROR_BUG;
+}
+
+void ff_segprefetch_release(SegPrefetchQueue *q) { }
+void ff_segprefetch_flush(SegPrefetchQueue *q) { }
+#endif
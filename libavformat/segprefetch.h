@@ -0,0 +1,163 @@
+/*
+ * Segment prefetching for the adaptive streaming demuxers
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_SEGPREFETCH_H
+#define AVFORMAT_SEGPREFETCH_H
+
+#include <stdint.h>
+
+#include "config.h"
+#include "libavutil/dict.h"
+#include "libavutil/thread.h"
+#include "avformat.h"
+#include "avio.h"
+
+#define SEG_PREFETCH_MAX_ENTRIES 64
+
+enum SegPrefetchState {
+    SEG_PREFETCH_QUEUED,
+    SEG_PREFETCH_RUNNING,
+    SEG_PREFETCH_DONE,
+};
+
+/**
+ * A media segment downloaded ahead of the demuxer by the workers of a
+ * SegPrefetchPool. The segment location is copied, since the segment lists
+ * of live streams are replaced on every reload. Everything below avio_opts
+ * is protected by SegPrefetchPool.lock.
+ */
+typedef struct SegPrefetchEntry {
+    struct SegPrefetchQueue *queue;
+    char *url;
+    int64_t url_offset;
+    int64_t size;           ///< -1 if the segment extends to the end of url
+    AVDictionary *avio_opts;
+
+    enum SegPrefetchState state;
+    int abandoned;          ///< no longer referenced by the queue, the worker frees it
+    int error;              ///< AVERROR_EOF once the whole segment was downloaded
+    uint8_t *buf;
+    int64_t buf_size;       ///< accounted in SegPrefetchPool.bytes
+    int64_t data_len;
+    int64_t read_pos;
+} SegPrefetchEntry;
+
+/**
+ * The segments prefetched for one stream of the demuxer (an HLS playlist
+ * or a DASH representation).
+ */
+typedef struct SegPrefetchQueue {
+    struct SegPrefetchPool *pool;   ///< NULL until ff_segprefetch_queue_add()
+    void *opaque;                   ///< passed to SegPrefetchPool.open
+
+    /* segments queued for or being downloaded, in playback order */
+    SegPrefetchEntry **entries;
+    int nb_entries;
+    int max_entries;
+    /* the segment the demuxer currently reads, see ff_segprefetch_take() */
+    SegPrefetchEntry *cur;
+} SegPrefetchQueue;
+
+/**
+ * Location of a segment passed to ff_segprefetch_schedule(). A segment is
+ * identified by its url and url_offset.
+ */
+typedef struct SegPrefetchSegment {
+    const char *url;
+    int64_t url_offset;
+    int64_t size;
+} SegPrefetchSegment;
+
+typedef struct SegPrefetchPool {
+    AVFormatContext *s;
+    int64_t max_bytes;
+
+    /**
+     * Open the segment e for reading, called from the worker threads.
+     * On success, *pb must be positioned at the start of the segment and
+     * *size be set to its size, or to a negative value if unknown.
+     * int_cb must be used for all I/O.
+     */
+    int (*open)(void *opaque, SegPrefetchEntry *e, AVIOContext **pb,
+                int64_t *size, AVIOInterruptCB *int_cb);
+
+#if HAVE_THREADS
+    SegPrefetchQueue **queues;
+    int nb_queues;
+    pthread_t *workers;
+    int nb_workers;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int abort;
+    int64_t bytes;
+#endif
+} SegPrefetchPool;
+
+/**
+ * Start nb_threads workers. s, max_bytes and open must be set.
+ * @return 0 if at least one worker runs, a negative error code otherwise
+ */
+int ff_segprefetch_init(SegPrefetchPool *p, int nb_threads);
+
+/**
+ * Stop the workers and free all entries of all queues.
+ */
+void ff_segprefetch_uninit(SegPrefetchPool *p);
+
+/**
+ * Attach q to the pool, it can then hold up to max_entries entries, at
+ * most SEG_PREFETCH_MAX_ENTRIES.
+ */
+int ff_segprefetch_queue_add(SegPrefetchPool *p, SegPrefetchQueue *q,
+                             void *opaque, int max_entries);
+
+/**
+ * Set the segments following the current one to download, in playback
+ * order. Entries of segments that are not listed are dropped, at most
+ * max_entries are kept.
+ */
+void ff_segprefetch_schedule(SegPrefetchQueue *q, const SegPrefetchSegment *segs,
+                             int nb_segs, AVDictionary *avio_opts);
+
+/**
+ * Hand the prefetched segment url/url_offset to the demuxer as q->cur, if
+ * there is one. The entries queued before it are dropped. A segment no
+ * worker has started on yet, or whose download failed right away, is
+ * dropped too, and the caller has to open it directly.
+ * @return 1 if q->cur was set, 0 otherwise
+ */
+int ff_segprefetch_take(SegPrefetchQueue *q, const char *url, int64_t url_offset);
+
+/**
+ * Read from q->cur, waiting for the worker if needed.
+ */
+int ff_segprefetch_read(SegPrefetchQueue *q, uint8_t *buf, int buf_size);
+
+/**
+ * Drop q->cur once the demuxer is done with it.
+ */
+void ff_segprefetch_release(SegPrefetchQueue *q);
+
+/**
+ * Drop all prefetched data of q, e.g. after seeking.
+ */
+void ff_segprefetch_flush(SegPrefetchQueue *q);
+
+#endif /* AVFORMAT_SEGPREFETCH_H */
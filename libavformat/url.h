@@ -87,6 +87,11 @@ typedef struct URLProtocol {
                                      int *numhandles);
     int (*url_get_short_seek)(URLContext *h);
     int (*url_shutdown)(URLContext *h, int flags);
+    /**
+     * Wait until all the data passed to url_write has been handed over to
+     * the underlying resource. Only needed by protocols deferring writes.
+     */
+    int (*url_flush)(URLContext *h);
     int priv_data_size;
     const AVClass *priv_data_class;
     int flags;
@@ -257,6 +262,14 @@ int ffurl_get_multi_file_handle(URLContext *h, int **handles, int *numhandles);
  */
 int ffurl_get_short_seek(URLContext *h);
 
+/**
+ * Wait until the data written so far has been handed over to the
+ * underlying resource, for protocols that defer writes.
+ *
+ * @return 0 on success, or a deferred write error.
+ */
+int ffurl_flush(URLContext *h);
+
 /**
  * Signal the URLContext that we are done reading or writing the stream.
  *
@@ -275,6 +288,24 @@ int ffurl_shutdown(URLContext *h, int flags);
  */
 int ff_check_interrupt(AVIOInterruptCB *cb);
 
+/**
+ * Interrupt callback for I/O done by a helper thread on behalf of a
+ * (de)muxer, e.g. to prefetch data. The I/O is interrupted when check
+ * returns nonzero, or when the parent interrupt callback requests it.
+ */
+typedef struct FFIOInterruptChain {
+    AVIOInterruptCB cb;         ///< the callback to pass to the I/O functions
+    int (*check)(void *opaque);
+    void *opaque;
+    AVIOInterruptCB *parent;
+} FFIOInterruptChain;
+
+/**
+ * Set up ic, which must stay valid as long as I/O uses ic->cb.
+ */
+void ff_interrupt_chain_init(FFIOInterruptChain *ic, int (*check)(void *opaque),
+                             void *opaque, AVIOInterruptCB *parent);
+
 /* udp.c */
 int ff_udp_set_remote_url(URLContext *h, const char *uri);
 int ff_udp_get_local_port(URLContext *h);
@@ -42,6 +42,9 @@
 
 #include "avformat.h"
 #include "avio_internal.h"
+#if CONFIG_HTTP_PROTOCOL
+#include "http.h"
+#endif
 #include "id3v2.h"
 #include "internal.h"
 #if CONFIG_NETWORK
@@ -1992,6 +1995,128 @@ int av_add_index_entry(AVStream *st, int64_t pos, int64_t timestamp,
                               timestamp, size, distance, flags);
 }
 
+int ff_index_batch_add(AVStream *st, int64_t pos, int64_t timestamp,
+                       int size, int distance, int flags)
+{
+    AVStreamInternal *sti = st->internal;
+    AVIndexEntry *entries, *ie;
+
+    if ((unsigned) sti->nb_index_entries + sti->nb_index_batch + 1 >=
+        UINT_MAX / sizeof(AVIndexEntry))
+        return AVERROR(ENOMEM);
+
+    timestamp = wrap_timestamp(st, timestamp);
+    if (timestamp == AV_NOPTS_VALUE)
+        return AVERROR(EINVAL);
+
+    if (size < 0 || size > 0x3FFFFFFF)
+        return AVERROR(EINVAL);
+
+    if (is_relative(timestamp)) //FIXME this maintains previous behavior but we should shift by the correct offset once known
+        timestamp -= RELATIVE_TS_BASE;
+
+    entries = av_fast_realloc(sti->index_batch,
+                              &sti->index_batch_allocated_size,
+                              (sti->nb_index_batch + 1) *
+                              sizeof(AVIndexEntry));
+    if (!entries)
+        return AVERROR(ENOMEM);
+    sti->index_batch = entries;
+
+    ie = &entries[sti->nb_index_batch++];
+    ie->pos          = pos;
+    ie->timestamp    = timestamp;
+    ie->min_distance = distance;
+    ie->size         = size;
+    ie->flags        = flags;
+
+    return 0;
+}
+
+/* Stable merge sort by timestamp, tmp must have room for nb entries. */
+static void sort_index_entries(AVIndexEntry *entries, AVIndexEntry *tmp, int nb)
+{
+    AVIndexEntry *dst = entries;
+    int width, i;
+
+    for (i = 1; i < nb && entries[i - 1].timestamp <= entries[i].timestamp; i++)
+        ;
+    if (i == nb)
+        return;
+
+    for (width = 1; width < nb; width *= 2) {
+        for (i = 0; i < nb; i += 2 * width) {
+            int a = i, a_end = FFMIN(i + width, nb);
+            int b = a_end, b_end = FFMIN(i + 2 * width, nb);
+            int k = i;
+
+            while (a < a_end && b < b_end)
+                tmp[k++] = entries[b].timestamp < entries[a].timestamp ?
+                           entries[b++] : entries[a++];
+            while (a < a_end)
+                tmp[k++] = entries[a++];
+            while (b < b_end)
+                tmp[k++] = entries[b++];
+        }
+        FFSWAP(AVIndexEntry *, entries, tmp);
+    }
+    if (entries != dst)
+        memcpy(dst, entries, nb * sizeof(*entries));
+}
+
+int ff_index_batch_commit(AVStream *st)
+{
+    AVStreamInternal *sti = st->internal;
+    AVIndexEntry *old = sti->index_entries, *batch = sti->index_batch;
+    AVIndexEntry *entries;
+    int nb_old = sti->nb_index_entries, nb_batch = sti->nb_index_batch;
+    int i = 0, j = 0, k = 0;
+
+    if (!nb_batch)
+        return 0;
+
+    entries = av_malloc_array(nb_old + nb_batch, sizeof(*entries));
+    if (!entries) {
+        av_freep(&sti->index_batch);
+        sti->nb_index_batch = 0;
+        sti->index_batch_allocated_size = 0;
+        return AVERROR(ENOMEM);
+    }
+
+    /* the new array is free until the merge below, use it for sorting */
+    sort_index_entries(batch, entries, nb_batch);
+
+    /* Existing entries go before queued ones with the same timestamp, and a
+     * queued entry replaces the entry it has the same timestamp as, like
+     * ff_add_index_entry() does. */
+    while (i < nb_old || j < nb_batch) {
+        AVIndexEntry e;
+
+        if (j == nb_batch || (i < nb_old && old[i].timestamp <= batch[j].timestamp)) {
+            entries[k++] = old[i++];
+            continue;
+        }
+        e = batch[j++];
+        if (k && entries[k - 1].timestamp == e.timestamp) {
+            if (entries[k - 1].pos == e.pos && e.min_distance < entries[k - 1].min_distance)
+                e.min_distance = entries[k - 1].min_distance;
+            entries[k - 1] = e;
+        } else {
+            entries[k++] = e;
+        }
+    }
+
+    av_free(old);
+    sti->index_entries = entries;
+    sti->nb_index_entries = k;
+    sti->index_entries_allocated_size = (nb_old + nb_batch) * sizeof(*entries);
+
+    av_freep(&sti->index_batch);
+    sti->nb_index_batch = 0;
+    sti->index_batch_allocated_size = 0;
+    return 0;
+}
+
 int ff_index_search_timestamp(const AVIndexEntry *entries, int nb_entries,
                               int64_t wanted_timestamp, int flags)
 {
@@ -4367,6 +4492,7 @@ static void free_stream(AVStream **pst)
         av_bsf_free(&st->internal->bsfc);
         av_freep(&st->internal->priv_pts);
         av_freep(&st->internal->index_entries);
+        av_freep(&st->internal->index_batch);
         av_freep(&st->internal->probe_data.buf);
 
         av_bsf_free(&st->internal->extract_extradata.bsf);
@@ -5015,6 +5141,9 @@ int avformat_network_init(void)
 
 int avformat_network_deinit(void)
 {
+#if CONFIG_HTTP_PROTOCOL
+    ff_http_pool_flush();
+#endif
 #if CONFIG_NETWORK
     ff_network_close();
     ff_tls_deinit();
@@ -258,6 +258,7 @@ AVBufferPool *av_buffer_pool_init2(int size, void *opaque,
     pool->alloc     = av_buffer_alloc; // fallback
     pool->pool_free = pool_free;
 
+    atomic_init(&pool->head, 0);
     atomic_init(&pool->refcount, 1);
 
     return pool;
@@ -274,24 +275,87 @@ AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size))
     pool->size     = size;
     pool->alloc    = alloc ? alloc : av_buffer_alloc;
 
+    atomic_init(&pool->head, 0);
     atomic_init(&pool->refcount, 1);
 
     return pool;
 }
 
+static BufferPoolEntry *pool_entry(AVBufferPool *pool, uintptr_t index)
+{
+    int chunk = av_log2((index >> BUFFER_POOL_CHUNK_BITS) + 1);
+    return &pool->chunks[chunk][index - (((uintptr_t)1 << chunk) - 1) *
+                                         BUFFER_POOL_CHUNK_SIZE];
+}
+
+/* push an entry onto the free list */
+static void pool_push(AVBufferPool *pool, BufferPoolEntry *buf)
+{
+    intptr_t head = atomic_load_explicit(&pool->head, memory_order_relaxed);
+    intptr_t next;
+
+    do {
+        atomic_store_explicit(&buf->next, (uintptr_t)head & BUFFER_POOL_INDEX_MASK,
+                              memory_order_relaxed);
+        next = (((uintptr_t)head & ~BUFFER_POOL_INDEX_MASK) +
+                ((uintptr_t)1 << BUFFER_POOL_INDEX_BITS)) | (buf->index + 1);
+    } while (!atomic_compare_exchange_weak_explicit(&pool->head, &head, next,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+}
+
+/* pop an entry from the free list, return NULL if it is empty */
+static BufferPoolEntry *pool_pop(AVBufferPool *pool)
+{
+    intptr_t head = atomic_load_explicit(&pool->head, memory_order_acquire);
+    BufferPoolEntry *buf;
+    intptr_t next;
+
+    do {
+        uintptr_t index = (uintptr_t)head & BUFFER_POOL_INDEX_MASK;
+        if (!index)
+            return NULL;
+        buf  = pool_entry(pool, index - 1);
+        /* the tag increment makes the CAS fail if buf was popped and
+         * pushed back concurrently, so a stale next is never installed */
+        next = (((uintptr_t)head & ~BUFFER_POOL_INDEX_MASK) +
+                ((uintptr_t)1 << BUFFER_POOL_INDEX_BITS)) |
+               (uintptr_t)atomic_load_explicit(&buf->next, memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(&pool->head, &head, next,
+                                                    memory_order_acquire,
+                                                    memory_order_acquire));
+
+    return buf;
+}
+
+/* return an entry to the free list it belongs to */
+static void pool_release_entry(AVBufferPool *pool, BufferPoolEntry *buf)
+{
+    if (buf->index < BUFFER_POOL_MAX_ENTRIES) {
+        pool_push(pool, buf);
+        return;
+    }
+
+    ff_mutex_lock(&pool->mutex);
+    buf->overflow_next = pool->overflow;
+    pool->overflow     = buf;
+    ff_mutex_unlock(&pool->mutex);
+}
+
 /*
  * This function gets called when the pool has been uninited and
  * all the buffers returned to it.
  */
 static void buffer_pool_free(AVBufferPool *pool)
 {
-    while (pool->pool) {
-        BufferPoolEntry *buf = pool->pool;
-        pool->pool = buf->next;
+    unsigned i;
 
+    for (i = 0; i < pool->nb_entries; i++) {
+        BufferPoolEntry *buf = pool_entry(pool, i);
         buf->free(buf->opaque, buf->data);
-        av_freep(&buf);
     }
+    for (i = 0; i < BUFFER_POOL_MAX_CHUNKS; i++)
+        av_freep(&pool->chunks[i]);
     ff_mutex_destroy(&pool->mutex);
 
     if (pool->pool_free)
@@ -321,43 +385,62 @@ static void pool_release_buffer(void *opaque, uint8_t *data)
     if(CONFIG_MEMORY_POISONING)
         memset(buf->data, FF_MEMORY_POISON, pool->size);
 
-    ff_mutex_lock(&pool->mutex);
-    buf->next = pool->pool;
-    pool->pool = buf;
-    ff_mutex_unlock(&pool->mutex);
+    pool_release_entry(pool, buf);
 
     if (atomic_fetch_sub_explicit(&pool->refcount, 1, memory_order_acq_rel) == 1)
         buffer_pool_free(pool);
 }
 
 /* allocate a new buffer and override its free() callback so that
- * it is returned to the pool on free */
+ * it is returned to the pool on free, must be called with the pool
+ * mutex held */
 static AVBufferRef *pool_alloc_buffer(AVBufferPool *pool)
 {
     BufferPoolEntry *buf;
     AVBufferRef     *ret;
+    unsigned index = pool->nb_entries;
+    int chunk = av_log2((index >> BUFFER_POOL_CHUNK_BITS) + 1);
 
     av_assert0(pool->alloc || pool->alloc2);
 
+    if (chunk >= BUFFER_POOL_MAX_CHUNKS)
+        return NULL;
+
+    if (!pool->chunks[chunk]) {
+        pool->chunks[chunk] = av_mallocz_array((size_t)BUFFER_POOL_CHUNK_SIZE << chunk,
+                                               sizeof(*pool->chunks[chunk]));
+        if (!pool->chunks[chunk])
+            return NULL;
+    }
+
     ret = pool->alloc2 ? pool->alloc2(pool->opaque, pool->size) :
                          pool->alloc(pool->size);
     if (!ret)
         return NULL;
 
-    buf = av_mallocz(sizeof(*buf));
-    if (!buf) {
-        av_buffer_unref(&ret);
-        return NULL;
-    }
+    buf = pool_entry(pool, index);
 
     buf->data   = ret->buffer->data;
     buf->opaque = ret->buffer->opaque;
     buf->free   = ret->buffer->free;
     buf->pool   = pool;
+    buf->index  = index;
+    atomic_init(&buf->next, 0);
 
     ret->buffer->opaque = buf;
     ret->buffer->free   = pool_release_buffer;
 
+    pool->nb_entries++;
+
+    return ret;
+}
+
+static AVBufferRef *pool_wrap_entry(AVBufferPool *pool, BufferPoolEntry *buf)
+{
+    AVBufferRef *ret = av_buffer_create(buf->data, pool->size,
+                                        pool_release_buffer, buf, 0);
+    if (!ret)
+        pool_release_entry(pool, buf);
     return ret;
 }
 
@@ -366,19 +449,23 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
     AVBufferRef *ret;
     BufferPoolEntry *buf;
 
-    ff_mutex_lock(&pool->mutex);
-    buf = pool->pool;
-    if (buf) {
-        ret = av_buffer_create(buf->data, pool->size, pool_release_buffer,
-                               buf, 0);
-        if (ret) {
-            pool->pool = buf->next;
-            buf->next = NULL;
+    /* fast path: reuse a buffer returned to the pool without locking */
+    buf = pool_pop(pool);
+    if (!buf) {
+        ret = NULL;
+        ff_mutex_lock(&pool->mutex);
+        /* another thread may have released a buffer in the meantime */
+        buf = pool_pop(pool);
+        if (!buf && pool->overflow) {
+            buf = pool->overflow;
+            pool->overflow = buf->overflow_next;
         }
-    } else {
-        ret = pool_alloc_buffer(pool);
+        if (!buf)
+            ret = pool_alloc_buffer(pool);
+        ff_mutex_unlock(&pool->mutex);
     }
-    ff_mutex_unlock(&pool->mutex);
+    if (buf)
+        ret = pool_wrap_entry(pool, buf);
 
     if (ret)
         atomic_fetch_add_explicit(&pool->refcount, 1, memory_order_relaxed);
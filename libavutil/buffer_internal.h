@@ -71,12 +71,58 @@ typedef struct BufferPoolEntry {
     void (*free)(void *opaque, uint8_t *data);
 
     AVBufferPool *pool;
-    struct BufferPoolEntry *next;
+
+    /* position of this entry in the pool's entry table */
+    uintptr_t index;
+    /* 1-based index of the next free entry, 0 terminates the free list */
+    atomic_intptr_t next;
+    /* next free entry on the locked overflow list */
+    struct BufferPoolEntry *overflow_next;
 } BufferPoolEntry;
 
+/*
+ * The free list head packs a 1-based entry index in the low bits of an
+ * intptr_t and a modification tag in the remaining bits, so that it can be
+ * updated with a single pointer-sized compare-and-swap without suffering
+ * from the ABA problem.
+ *
+ * A pop can only be corrupted if the tag wraps around while another thread
+ * is between loading the head and its compare-and-swap. On 64-bit targets
+ * both halves have 32 bits. On 32-bit targets the index only gets 12 bits,
+ * so that the tag has 20 bits and needs about a million pushes and pops
+ * within that window to wrap.
+ *
+ * Only the first BUFFER_POOL_MAX_ENTRIES entries of a pool are on the
+ * lock-free list. Entries past that are kept on a free list protected by
+ * the pool mutex, so larger pools still work, just with locking.
+ */
+#define BUFFER_POOL_INDEX_BITS  (sizeof(intptr_t) >= 8 ? 32 : 12)
+#define BUFFER_POOL_INDEX_MASK  (((uintptr_t)1 << BUFFER_POOL_INDEX_BITS) - 1)
+#define BUFFER_POOL_MAX_ENTRIES (BUFFER_POOL_INDEX_MASK - 1)
+
+/*
+ * Entries are stored in chunks of geometrically increasing size, chunk n
+ * holding (BUFFER_POOL_CHUNK_SIZE << n) entries. Entries never move once
+ * allocated, so they can be looked up by index without locking.
+ */
+#define BUFFER_POOL_CHUNK_BITS  4
+#define BUFFER_POOL_CHUNK_SIZE  (1 << BUFFER_POOL_CHUNK_BITS)
+#define BUFFER_POOL_MAX_CHUNKS  32
+
 struct AVBufferPool {
+    /*
+     * Protects allocation of new entries only, getting and releasing
+     * buffers already in the pool is lock-free.
+     */
     AVMutex mutex;
-    BufferPoolEntry *pool;
+
+    /* tagged head of the free list, see BUFFER_POOL_INDEX_BITS */
+    atomic_intptr_t head;
+    /* free entries past BUFFER_POOL_MAX_ENTRIES, protected by mutex */
+    struct BufferPoolEntry *overflow;
+
+    BufferPoolEntry *chunks[BUFFER_POOL_MAX_CHUNKS];
+    unsigned nb_entries;
 
     /*
      * This is used to track when the pool is to be freed.
@@ -0,0 +1,167 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * This test program hammers a single AVBufferPool from several threads and
+ * checks that a pooled buffer is never handed out twice at the same time.
+ * With -b it also reports the get/release throughput of the pool.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/buffer.h"
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/mem.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+
+#define MAX_THREADS   64
+#define BUFS_PER_ITER 4
+#define BUF_SIZE      64
+#define MANY_BUFS     5000
+
+typedef struct ThreadArg {
+    AVBufferPool *pool;
+    int id;
+    int iterations;
+    int errors;
+} ThreadArg;
+
+static void *thread_main(void *opaque)
+{
+    ThreadArg *arg = opaque;
+    AVBufferRef *bufs[BUFS_PER_ITER];
+    int i, j;
+
+    for (i = 0; i < arg->iterations; i++) {
+        for (j = 0; j < BUFS_PER_ITER; j++) {
+            bufs[j] = av_buffer_pool_get(arg->pool);
+            if (!bufs[j]) {
+                arg->errors++;
+                break;
+            }
+            memset(bufs[j]->data, arg->id * BUFS_PER_ITER + j, BUF_SIZE);
+        }
+        while (j--) {
+            int k;
+            for (k = 0; k < BUF_SIZE; k++) {
+                if (bufs[j]->data[k] != ((arg->id * BUFS_PER_ITER + j) & 0xFF)) {
+                    arg->errors++;
+                    break;
+                }
+            }
+            av_buffer_unref(&bufs[j]);
+        }
+    }
+
+    return NULL;
+}
+
+/* Hold more buffers at once than the lock-free free list can index on
+ * 32-bit targets, then return them all and get them again. */
+static int test_many_buffers(void)
+{
+    AVBufferPool *pool = av_buffer_pool_init(BUF_SIZE, NULL);
+    AVBufferRef **bufs = av_calloc(MANY_BUFS, sizeof(*bufs));
+    int i, pass, errors = 0;
+
+    if (!pool || !bufs) {
+        av_buffer_pool_uninit(&pool);
+        av_free(bufs);
+        return 1;
+    }
+
+    for (pass = 0; pass < 2; pass++) {
+        for (i = 0; i < MANY_BUFS; i++) {
+            bufs[i] = av_buffer_pool_get(pool);
+            if (!bufs[i]) {
+                errors++;
+                break;
+            }
+            AV_WN32(bufs[i]->data, i);
+        }
+        while (i--) {
+            if (AV_RN32(bufs[i]->data) != i)
+                errors++;
+            av_buffer_unref(&bufs[i]);
+        }
+    }
+
+    av_buffer_pool_uninit(&pool);
+    av_free(bufs);
+
+    return errors;
+}
+
+int main(int argc, char **argv)
+{
+    ThreadArg args[MAX_THREADS];
+    pthread_t threads[MAX_THREADS];
+    AVBufferPool *pool;
+    int nb_threads = 8, iterations = 20000, bench = 0;
+    int i, ret, errors = 0;
+    int64_t t0, t1;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-b"))
+            bench = 1;
+        else if (!strncmp(argv[i], "-t", 2))
+            nb_threads = av_clip(atoi(argv[i] + 2), 1, MAX_THREADS);
+        else if (!strncmp(argv[i], "-n", 2))
+            iterations = FFMAX(atoi(argv[i] + 2), 1);
+    }
+
+    errors = test_many_buffers();
+
+    pool = av_buffer_pool_init(BUF_SIZE, NULL);
+    if (!pool)
+        return 1;
+
+    t0 = av_gettime_relative();
+    for (i = 0; i < nb_threads; i++) {
+        args[i].pool       = pool;
+        args[i].id         = i;
+        args[i].iterations = iterations;
+        args[i].errors     = 0;
+        if ((ret = pthread_create(&threads[i], NULL, thread_main, &args[i]))) {
+            fprintf(stderr, "pthread_create failed: %s.\n", strerror(ret));
+            return 1;
+        }
+    }
+    for (i = 0; i < nb_threads; i++) {
+        pthread_join(threads[i], NULL);
+        errors += args[i].errors;
+    }
+    t1 = av_gettime_relative();
+
+    av_buffer_pool_uninit(&pool);
+
+    if (bench)
+        printf("%d threads: %.1f ns per get/release pair\n", nb_threads,
+               (t1 - t0) * 1000.0 / ((double)nb_threads * iterations * BUFS_PER_ITER));
+
+    if (errors) {
+        fprintf(stderr, "%d errors\n", errors);
+        return 2;
+    }
+
+    return 0;
+}
@@ -159,6 +159,9 @@ static const struct {
     #if CONFIG_AFIR_FILTER
         { "af_afir", checkasm_check_afir },
     #endif
+    #if CONFIG_DNN
+        { "dnn_native", checkasm_check_dnn_native },
+    #endif
     #if CONFIG_BLEND_FILTER
         { "vf_blend", checkasm_check_blend },
     #endif
@@ -0,0 +1,83 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <float.h>
+
+#include "libavfilter/dnn/dnn_backend_native.h"
+#include "libavutil/internal.h"
+#include "libavutil/mem_internal.h"
+#include "checkasm.h"
+
+#define LEN 300
+
+#define randomize_buffer(buf)                 \
+do {                                          \
+    int i;                                    \
+    double bmg[2], stddev = 1.0, mean = 0.0;  \
+                                              \
+    for (i = 0; i < LEN; i += 2) {            \
+        av_bmg_get(&checkasm_lfg, bmg);       \
+        buf[i]     = bmg[0] * stddev + mean;  \
+        buf[i + 1] = bmg[1] * stddev + mean;  \
+    }                                         \
+} while(0);
+
+static void test_dot_product(const float *a, const float *b)
+{
+    static const int lens[] = { 1, 3, 7, 8, 9, 16, 31, 32, 33, 40, 63, 64,
+                                72, 100, 127, 192, 257, LEN - 8 };
+    float bias = 0.5f;
+
+    declare_func_float(float, float sum, const float *a, const float *b, int len);
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(lens); i++) {
+        int len = lens[i];
+        float ref, new;
+        double t = fabs(bias) + 1.0;
+
+        for (int j = 0; j < len; j++)
+            t += fabs(a[j] * b[j]);
+
+        ref = call_ref(bias, a, b, len);
+        new = call_new(bias, a, b, len);
+        if (!float_near_abs_eps(ref, new, t * 2 * FLT_EPSILON)) {
+            fprintf(stderr, "len %d: %- .12f - %- .12f = % .12g\n",
+                    len, ref, new, ref - new);
+            fail();
+            break;
+        }
+    }
+    bench_new(bias, a, b, 192);
+}
+
+void checkasm_check_dnn_native(void)
+{
+    LOCAL_ALIGNED_32(float, a, [LEN]);
+    LOCAL_ALIGNED_32(float, b, [LEN]);
+    NativeDSPContext dsp;
+
+    ff_dnn_native_dsp_init(&dsp);
+
+    randomize_buffer(a);
+    randomize_buffer(b);
+
+    /* the layers pass row pointers at any float offset */
+    if (check_func(dsp.dot_product, "dot_product"))
+        test_dot_product(a + 1, b + 3);
+    report("dot_product");
+}
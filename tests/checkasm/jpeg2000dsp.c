@@ -20,12 +20,15 @@
 
 #include "checkasm.h"
 #include "libavcodec/jpeg2000dsp.h"
+#include "libavcodec/jpeg2000dwt.h"
 #include "libavutil/common.h"
 #include "libavutil/internal.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/mem_internal.h"
 
 #define BUF_SIZE 512
+#define DWT_ROWS 66
+#define DWT_BORDER 8
 
 #define randomize_buffers()                 \
     do {                                    \
@@ -89,9 +92,40 @@ static void check_ict_float(void)
     bench_new(new0, new1, new2, BUF_SIZE);
 }
 
+static void check_dwt_lift(void)
+{
+    LOCAL_ALIGNED_32(int32_t, src, [(DWT_ROWS + 2 * DWT_BORDER) * FF_DWT_STRIP_COLS]);
+    LOCAL_ALIGNED_32(int32_t, ref, [(DWT_ROWS + 2 * DWT_BORDER) * FF_DWT_STRIP_COLS]);
+    LOCAL_ALIGNED_32(int32_t, new, [(DWT_ROWS + 2 * DWT_BORDER) * FF_DWT_STRIP_COLS]);
+    const int size = (DWT_ROWS + 2 * DWT_BORDER) * FF_DWT_STRIP_COLS;
+    int32_t *ref_p = ref + DWT_BORDER * FF_DWT_STRIP_COLS;
+    int32_t *new_p = new + DWT_BORDER * FF_DWT_STRIP_COLS;
+    int i, i0, i1;
+
+    declare_func(void, int32_t *p, int i0, int i1);
+
+    /* all band parities and lengths, including the shortest ones */
+    for (i0 = 0; i0 < 2; i0++) {
+        for (i1 = i0 + 2; i1 <= DWT_ROWS; i1 += 1 + (i1 > 8) * 7) {
+            /* up to 24 bits, as the integer 9/7 input after I_PRESHIFT */
+            for (i = 0; i < size; i++)
+                src[i] = (int32_t)(rnd() & 0xffffff) - 0x800000;
+            memcpy(ref, src, size * sizeof(*src));
+            memcpy(new, src, size * sizeof(*src));
+            call_ref(ref_p, i0, i1);
+            call_new(new_p, i0, i1);
+            if (memcmp(ref, new, size * sizeof(*src)))
+                fail();
+        }
+    }
+    memcpy(new, src, size * sizeof(*src));
+    bench_new(new_p, 0, DWT_ROWS);
+}
+
 void checkasm_check_jpeg2000dsp(void)
 {
     Jpeg2000DSPContext h;
+    DWTDSPContext dwt;
 
     ff_jpeg2000dsp_init(&h);
 
@@ -101,4 +135,13 @@ void checkasm_check_jpeg2000dsp(void)
         check_ict_float();
 
     report("mct_decode");
+
+    ff_jpeg2000dwt_dsp_init(&dwt);
+
+    if (check_func(dwt.sd_lift53, "jpeg2000_sd_lift53"))
+        check_dwt_lift();
+    if (check_func(dwt.sd_lift97_int, "jpeg2000_sd_lift97_int"))
+        check_dwt_lift();
+
+    report("dwt");
 }
@@ -101,6 +101,7 @@ static int test_with_same_dilate(void)
     NativeContext ctx;
     ctx.class = &dnn_native_class;
     ctx.options.conv2d_threads = 1;
+    ctx.slicethread = NULL;
 
     params.activation = TANH;
     params.has_bias = 1;
@@ -205,6 +206,7 @@ static int test_with_valid(void)
     NativeContext ctx;
     ctx.class = &dnn_native_class;
     ctx.options.conv2d_threads = 1;
+    ctx.slicethread = NULL;
 
     params.activation = TANH;
     params.has_bias = 1;
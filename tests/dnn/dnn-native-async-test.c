@@ -0,0 +1,238 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Run a small native model on a sequence of frames with async=1 and several
+ * inference workers, and check that the results come back in submission
+ * order and match the synchronous execution of the same model.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/frame.h"
+#include "libavutil/intfloat.h"
+#include "libavutil/time.h"
+#include "libavfilter/dnn/dnn_backend_native.h"
+
+#define NB_FRAMES 24
+#define NB_CH     4
+
+static void put_le32(FILE *f, uint32_t v)
+{
+    uint8_t buf[4] = { v, v >> 8, v >> 16, v >> 24 };
+    fwrite(buf, 1, 4, f);
+}
+
+static void put_conv2d(FILE *f, int input_num, int output_num, int activation,
+                       int input_index, int output_index, unsigned *seed)
+{
+    int kernel_size = 3;
+
+    put_le32(f, DLT_CONV2D);
+    put_le32(f, 1);                 // dilation
+    put_le32(f, SAME);
+    put_le32(f, activation);
+    put_le32(f, input_num);
+    put_le32(f, output_num);
+    put_le32(f, kernel_size);
+    put_le32(f, 1);                 // has_bias
+    for (int i = 0; i < output_num * kernel_size * kernel_size * input_num; i++) {
+        *seed = *seed * 1664525 + 1013904223;
+        put_le32(f, av_float2int(((*seed >> 8) / (float)(1 << 24) - 0.5f) * 0.5f));
+    }
+    for (int i = 0; i < output_num; i++)
+        put_le32(f, av_float2int(0.01f * i));
+    put_le32(f, input_index);
+    put_le32(f, output_index);
+}
+
+static void put_operand(FILE *f, int index, const char *name, int type, int channels)
+{
+    put_le32(f, index);
+    put_le32(f, strlen(name));
+    fwrite(name, 1, strlen(name), f);
+    put_le32(f, type);
+    put_le32(f, DNN_FLOAT);
+    put_le32(f, 1);
+    put_le32(f, 0);
+    put_le32(f, 0);
+    put_le32(f, channels);
+}
+
+/* two 3x3 convolutions, 1 -> NB_CH -> 1 channels */
+static int write_model(const char *filename)
+{
+    FILE *f = fopen(filename, "wb");
+    unsigned seed = 1;
+
+    if (!f)
+        return -1;
+    fwrite("FFMPEGDNNNATIVE", 1, 15, f);
+    put_le32(f, 1);
+    put_le32(f, 0);
+    put_conv2d(f, 1, NB_CH, RELU, 0, 1, &seed);
+    put_conv2d(f, NB_CH, 1, TANH, 1, 2, &seed);
+    put_operand(f, 0, "x", DOT_INPUT, 1);
+    put_operand(f, 1, "conv", DOT_INTERMEDIATE, NB_CH);
+    put_operand(f, 2, "y", DOT_OUTPUT, 1);
+    put_le32(f, 2);
+    put_le32(f, 3);
+    return fclose(f) ? -1 : 0;
+}
+
+static AVFrame *alloc_frame(int width, int height)
+{
+    AVFrame *frame = av_frame_alloc();
+
+    if (!frame)
+        return NULL;
+    frame->format = AV_PIX_FMT_GRAYF32;
+    frame->width  = width;
+    frame->height = height;
+    if (av_frame_get_buffer(frame, 0) < 0)
+        av_frame_free(&frame);
+    return frame;
+}
+
+/* frames of changing size, so that every worker sees several shapes */
+static AVFrame *make_input(int n)
+{
+    AVFrame *frame = alloc_frame(16 + (n % 3) * 7, 9 + (n % 4) * 5);
+
+    if (!frame)
+        return NULL;
+    for (int y = 0; y < frame->height; y++) {
+        float *row = (float *)(frame->data[0] + y * frame->linesize[0]);
+        for (int x = 0; x < frame->width; x++)
+            row[x] = ((x * 7 + y * 13 + n * 29) % 64) / 64.0f;
+    }
+    frame->pts = n;
+    return frame;
+}
+
+static int compare_frames(const AVFrame *a, const AVFrame *b)
+{
+    if (a->width != b->width || a->height != b->height)
+        return -1;
+    for (int y = 0; y < a->height; y++)
+        if (memcmp(a->data[0] + y * a->linesize[0], b->data[0] + y * b->linesize[0],
+                   a->width * sizeof(float)))
+            return -1;
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *output_name = "y";
+    AVFrame *ref[NB_FRAMES] = { NULL };
+    DNNModel *model = NULL;
+    int nb_received = 0, ret = 1;
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <model file>\n", argv[0]);
+        return 1;
+    }
+    if (write_model(argv[1]) < 0) {
+        fprintf(stderr, "Failed to write %s\n", argv[1]);
+        return 1;
+    }
+
+    model = ff_dnn_load_model_native(argv[1], NULL, NULL);
+    if (!model) {
+        fprintf(stderr, "Failed to load the model\n");
+        return 1;
+    }
+    for (int n = 0; n < NB_FRAMES; n++) {
+        AVFrame *in = make_input(n);
+
+        ref[n] = in ? alloc_frame(in->width, in->height) : NULL;
+        if (!ref[n] || ff_dnn_execute_model_native(model, "x", in, &output_name, 1, ref[n]) != DNN_SUCCESS) {
+            fprintf(stderr, "Synchronous inference failed on frame %d\n", n);
+            av_frame_free(&in);
+            goto end;
+        }
+        av_frame_free(&in);
+    }
+    ff_dnn_free_model_native(&model);
+
+    model = ff_dnn_load_model_native(argv[1], "nireq=3&conv2d_threads=2", NULL);
+    if (!model) {
+        fprintf(stderr, "Failed to load the model for async execution\n");
+        goto end;
+    }
+    for (int n = 0; n <= NB_FRAMES; n++) {
+        DNNAsyncStatusType status;
+
+        if (n < NB_FRAMES) {
+            AVFrame *in = make_input(n);
+            AVFrame *out = in ? alloc_frame(in->width, in->height) : NULL;
+
+            if (!out || ff_dnn_execute_model_async_native(model, "x", in, &output_name, 1, out) != DNN_SUCCESS) {
+                fprintf(stderr, "Failed to submit frame %d\n", n);
+                av_frame_free(&in);
+                av_frame_free(&out);
+                goto end;
+            }
+        } else {
+            ff_dnn_flush_native(model);
+        }
+
+        // take what is ready after each submission, and everything at the end
+        for (;;) {
+            AVFrame *in = NULL, *out = NULL;
+
+            status = ff_dnn_get_async_result_native(model, &in, &out);
+            if (status == DAST_NOT_READY && n == NB_FRAMES) {
+                av_usleep(1000);
+                continue;
+            }
+            if (status != DAST_SUCCESS)
+                break;
+
+            if (in->pts != nb_received) {
+                fprintf(stderr, "Got frame %"PRId64", expected %d\n", in->pts, nb_received);
+                status = DAST_FAIL;
+            } else if (compare_frames(out, ref[nb_received]) < 0) {
+                fprintf(stderr, "Frame %d differs from the synchronous result\n", nb_received);
+                status = DAST_FAIL;
+            }
+            av_frame_free(&in);
+            av_frame_free(&out);
+            if (status == DAST_FAIL)
+                goto end;
+            nb_received++;
+        }
+        if (status == DAST_FAIL) {
+            fprintf(stderr, "Async inference failed\n");
+            goto end;
+        }
+    }
+
+    if (nb_received != NB_FRAMES) {
+        fprintf(stderr, "Got %d frames, expected %d\n", nb_received, NB_FRAMES);
+        goto end;
+    }
+    ret = 0;
+
+end:
+    ff_dnn_free_model_native(&model);
+    for (int n = 0; n < NB_FRAMES; n++)
+        av_frame_free(&ref[n]);
+    return ret;
+}
@@ -33,6 +33,11 @@ fate-dnn-layer-avgpool: $(DNNTESTSDIR)/dnn-layer-avgpool-test$(EXESUF)
 fate-dnn-layer-avgpool: CMD = run $(DNNTESTSDIR)/dnn-layer-avgpool-test$(EXESUF)
 fate-dnn-layer-avgpool: CMP = null
 
+FATE_DNN += fate-dnn-native-async
+fate-dnn-native-async: $(DNNTESTSDIR)/dnn-native-async-test$(EXESUF)
+fate-dnn-native-async: CMD = run $(DNNTESTSDIR)/dnn-native-async-test$(EXESUF) $(TARGET_PATH)/tests/data/fate/dnn-native-async.model
+fate-dnn-native-async: CMP = null
+
 FATE-$(CONFIG_DNN) += $(FATE_DNN)
 
 fate-dnn: $(FATE_DNN)
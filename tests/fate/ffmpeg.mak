@@ -86,6 +86,14 @@ fate-unknown_layout-ac3: CMD = md5 -auto_conversion_filters \
   -guess_layout_max 0 -f s32le -ac 1 -ar 44100 -i $(TARGET_PATH)/$(AREF) \
   -f ac3 -flags +bitexact -c ac3_fixed
 
+FATE_FFMPEG-$(call ALLYES, MOV_DEMUXER MOV_MUXER FILE_PROTOCOL) += fate-ffmpeg-async-write
+fate-ffmpeg-async-write: fate-lavf-mov
+fate-ffmpeg-async-write: CMD = transcode mov tests/data/lavf/lavf.mov mov "-c copy -async_write 1 -async_buffers 2" "-c copy"
+
+FATE_FFMPEG-$(call ALLYES, MOV_DEMUXER MOV_MUXER) += fate-ffmpeg-faststart-reserve
+fate-ffmpeg-faststart-reserve: fate-lavf-mov
+fate-ffmpeg-faststart-reserve: CMD = transcode mov tests/data/lavf/lavf.mov mov "-c copy -movflags +faststart -faststart_reserve 1" "-c copy"
+
 
 FATE_STREAMCOPY-$(call ALLYES, EAC3_DEMUXER MOV_MUXER) += fate-copy-trac3074
 fate-copy-trac3074: $(SAMPLES)/eac3/csi_miami_stereo_128_spx.eac3
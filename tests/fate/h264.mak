@@ -188,6 +188,13 @@ FATE_H264_REINIT_TESTS := large_420_8-to-small_420_8                    \
                           small_420_9-to-small_420_8                    \
                           small_422_9-to-small_420_9                    \
 
+# single slice pictures decoded with the row pipeline (decode and deblocking
+# in parallel), compared with the reference of the serial decode
+FATE_H264_SLICE_THREADS := fate-h264-slice-threads-ba1_sony_d             \
+                           fate-h264-slice-threads-caba1_sony_d           \
+                           fate-h264-slice-threads-sva_base_b             \
+                           fate-h264-slice-threads-frext-hpcv_brcm_a      \
+
 FATE_H264  := $(FATE_H264:%=fate-h264-conformance-%)                    \
               $(FATE_H264_REINIT_TESTS:%=fate-h264-reinit-%)            \
               fate-h264-extreme-plane-pred                              \
@@ -197,7 +204,8 @@ FATE_H264  := $(FATE_H264:%=fate-h264-conformance-%)                    \
               fate-h264-missing-frame                                   \
               fate-h264-ref-pic-mod-overflow                            \
               fate-h264-timecode                                        \
-              fate-h264-encparams
+              fate-h264-encparams                                       \
+              $(FATE_H264_SLICE_THREADS)
 
 FATE_H264-$(call DEMDEC, H264, H264) += $(FATE_H264)
 FATE_H264-$(call DEMDEC,  MOV, H264) += fate-h264-crop-to-container
@@ -444,6 +452,12 @@ fate-h264-3386:                                   CMD = framecrc -i $(TARGET_SAM
 fate-h264-missing-frame:                          CMD = framecrc -i $(TARGET_SAMPLES)/h264/nondeterministic_cut.h264
 fate-h264-timecode:                               CMD = framecrc -i $(TARGET_SAMPLES)/h264/crew_cif_timecode-2.h264
 
+fate-h264-slice-threads-ba1_sony_d:               CMD = threads=4 thread_type=slice framecrc -i $(TARGET_SAMPLES)/h264-conformance/BA1_Sony_D.jsv
+fate-h264-slice-threads-caba1_sony_d:             CMD = threads=4 thread_type=slice framecrc -i $(TARGET_SAMPLES)/h264-conformance/CABA1_Sony_D.jsv
+fate-h264-slice-threads-sva_base_b:               CMD = threads=4 thread_type=slice framecrc -i $(TARGET_SAMPLES)/h264-conformance/SVA_Base_B.264
+fate-h264-slice-threads-frext-hpcv_brcm_a:        CMD = threads=4 thread_type=slice framecrc -i $(TARGET_SAMPLES)/h264-conformance/FRext/HPCV_BRCM_A.264
+fate-h264-slice-threads-%:                        REF = $(SRC_PATH)/tests/ref/fate/h264-conformance-$(@:fate-h264-slice-threads-%=%)
+
 fate-h264-reinit-%:                               CMD = framecrc -i $(TARGET_SAMPLES)/h264/$(@:fate-h264-%=%).h264 -vf scale,format=yuv444p10le,scale=w=352:h=288
 
 fate-h264-dts_5frames:                            CMD = probeframes $(TARGET_SAMPLES)/h264/dts_5frames.mkv
@@ -230,7 +230,23 @@ FATE_HEVC_LARGE += fate-hevc-conformance-$(1)
 fate-hevc-conformance-$(1): CMD = framecrc -flags unaligned -i $(TARGET_SAMPLES)/hevc-conformance/$(1).bit -pix_fmt yuv444p12le -vf scale
 endef
 
+# slice segments without entry points decoded with the CTB pipeline (decode
+# and in-loop filters in parallel), compared with the serial reference
+HEVC_SAMPLES_SLICE_THREADS =    \
+    DBLK_A_SONY_3               \
+    DBLK_B_SONY_3               \
+    DBLK_C_SONY_3               \
+    SAO_A_MediaTek_4            \
+    SAO_B_MediaTek_5            \
+
+define FATE_HEVC_TEST_SLICE_THREADS
+FATE_HEVC += fate-hevc-slice-threads-$(1)
+fate-hevc-slice-threads-$(1): CMD = threads=4 thread_type=slice framecrc -flags unaligned -i $(TARGET_SAMPLES)/hevc-conformance/$(1).bit -pix_fmt yuv420p
+fate-hevc-slice-threads-$(1): REF = $(SRC_PATH)/tests/ref/fate/hevc-conformance-$(1)
+endef
+
 $(foreach N,$(HEVC_SAMPLES),$(eval $(call FATE_HEVC_TEST,$(N))))
+$(foreach N,$(HEVC_SAMPLES_SLICE_THREADS),$(eval $(call FATE_HEVC_TEST_SLICE_THREADS,$(N))))
 $(foreach N,$(HEVC_SAMPLES_10BIT),$(eval $(call FATE_HEVC_TEST_10BIT,$(N))))
 $(foreach N,$(HEVC_SAMPLES_422_10BIT),$(eval $(call FATE_HEVC_TEST_422_10BIT,$(N))))
 $(foreach N,$(HEVC_SAMPLES_422_10BIN),$(eval $(call FATE_HEVC_TEST_422_10BIN,$(N))))
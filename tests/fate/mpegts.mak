@@ -20,6 +20,12 @@ fate-mpegts-probe-pmt-merge: SRC = $(TARGET_SAMPLES)/mpegts/pmtchange.ts
 fate-mpegts-probe-pmt-merge: CMD = run $(PROBE_CODEC_NAME_COMMAND) -merge_pmt_versions 1 -i "$(SRC)"
 
 
+FATE_MPEGTS_FFMPEG-$(call ALLYES, MPEGTS_DEMUXER MPEGVIDEO_PARSER FRAMECRC_MUXER) += fate-mpegts-pes-complete-frames
+fate-mpegts-pes-complete-frames: fate-lavf-ts
+fate-mpegts-pes-complete-frames: CMD = framecrc -pes_complete_frames 1 -i $(TARGET_PATH)/tests/data/lavf/lavf.ts -c copy
+
+
 FATE_SAMPLES_FFPROBE += $(FATE_MPEGTS_PROBE-yes)
+FATE_FFMPEG += $(FATE_MPEGTS_FFMPEG-yes)
 
-fate-mpegts: $(FATE_MPEGTS_PROBE-yes)
+fate-mpegts: $(FATE_MPEGTS_PROBE-yes) $(FATE_MPEGTS_FFMPEG-yes)
@@ -246,6 +246,35 @@ fate-seek-lavf-y4m:      SRC = lavf/lavf.y4m
 
 FATE_SEEK += $(FATE_SEEK_LAVF-yes:%=fate-seek-lavf-%)
 
+# same files with the mov sample tables resolved on demand, the output must
+# match the one with a fully built index
+
+FATE_SEEK_LAZY_INDEX-$(call ENCDEC,  PCM_S16BE,           MOV) += fate-seek-acodec-pcm-s16be-lazy-index
+FATE_SEEK_LAZY_INDEX-$(call ENCDEC2, MPEG4,     PCM_ALAW, MOV) += fate-seek-lavf-mov-lazy-index
+
+fate-seek-acodec-pcm-s16be-lazy-index: fate-acodec-pcm-s16be
+fate-seek-acodec-pcm-s16be-lazy-index: CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/fate/acodec-pcm-s16be.mov -advanced_editlist 0 -lazy_index 1
+fate-seek-acodec-pcm-s16be-lazy-index: REF = $(SRC_PATH)/tests/ref/seek/acodec-pcm-s16be
+fate-seek-lavf-mov-lazy-index: fate-lavf-mov
+fate-seek-lavf-mov-lazy-index: CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/lavf/lavf.mov -advanced_editlist 0 -lazy_index 1
+fate-seek-lavf-mov-lazy-index: REF = $(SRC_PATH)/tests/ref/seek/lavf-mov
+
+FATE_SEEK_LAZY_INDEX += $(FATE_SEEK_LAZY_INDEX-yes)
+
+# same file read through the file protocol mmap and large read paths
+
+FATE_SEEK_FILE_OPTS-$(call ENCDEC2, MPEG4, PCM_ALAW, MOV) += fate-seek-lavf-mov-mmap
+FATE_SEEK_FILE_OPTS-$(call ENCDEC2, MPEG4, PCM_ALAW, MOV) += fate-seek-lavf-mov-read-size
+
+fate-seek-lavf-mov-mmap: fate-lavf-mov
+fate-seek-lavf-mov-mmap: CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/lavf/lavf.mov -mmap 1 -fadvise willneed
+fate-seek-lavf-mov-mmap: REF = $(SRC_PATH)/tests/ref/seek/lavf-mov
+fate-seek-lavf-mov-read-size: fate-lavf-mov
+fate-seek-lavf-mov-read-size: CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/lavf/lavf.mov -read_size 1048576 -fadvise sequential+willneed
+fate-seek-lavf-mov-read-size: REF = $(SRC_PATH)/tests/ref/seek/lavf-mov
+
+FATE_SEEK_FILE_OPTS += $(FATE_SEEK_FILE_OPTS-yes)
+
 # extra files
 
 FATE_SEEK_EXTRA-$(CONFIG_MP3_DEMUXER)   += fate-seek-extra-mp3
@@ -267,11 +296,11 @@ fate-seek-mkv-codec-delay:   CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_
 FATE_SEEK_EXTRA += $(FATE_SEEK_EXTRA-yes)
 
 
-$(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA): libavformat/tests/seek$(EXESUF)
+$(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA) $(FATE_SEEK_LAZY_INDEX) $(FATE_SEEK_FILE_OPTS): libavformat/tests/seek$(EXESUF)
 $(FATE_SEEK) $(FATE_SAMPLES_SEEK): CMD = run libavformat/tests/seek$(EXESUF) $(TARGET_PATH)/tests/data/$(SRC)
 $(FATE_SEEK) $(FATE_SAMPLES_SEEK): fate-seek-%: fate-%
 fate-seek-%: REF = $(SRC_PATH)/tests/ref/seek/$(@:fate-seek-%=%)
 
-FATE_AVCONV += $(FATE_SEEK)
+FATE_AVCONV += $(FATE_SEEK) $(FATE_SEEK_LAZY_INDEX) $(FATE_SEEK_FILE_OPTS)
 FATE_SAMPLES_AVCONV += $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
-fate-seek:     $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA)
+fate-seek:     $(FATE_SEEK) $(FATE_SAMPLES_SEEK) $(FATE_SEEK_EXTRA) $(FATE_SEEK_LAZY_INDEX) $(FATE_SEEK_FILE_OPTS)
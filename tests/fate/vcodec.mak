@@ -408,7 +408,7 @@ FATE_VCODEC-$(call ENCDEC, RV20, RM)    += rv20
 fate-vsynth%-rv20:               ENCOPTS = -qscale 10
 fate-vsynth%-rv20:               FMT     = rm
 
-FATE_VCODEC-$(call ENCDEC, SNOW, AVI)   += snow snow-hpel snow-ll
+FATE_VCODEC-$(call ENCDEC, SNOW, AVI)   += snow snow-hpel snow-ll snow-thread
 fate-vsynth%-snow:               ENCOPTS = -qscale 2 -flags +qpel \
                                            -motion_est iter -dia_size 2      \
                                            -cmp 12 -subcmp 12 -s 128x64
@@ -420,6 +420,12 @@ fate-vsynth%-snow-hpel:          ENCOPTS = -qscale 2              \
 fate-vsynth%-snow-ll:            ENCOPTS = -qscale .001 -pred 1 \
                                            -flags +mv4+qpel
 
+fate-vsynth%-snow-thread:        ENCOPTS = -qscale 2 -flags +qpel \
+                                           -motion_est iter -dia_size 2      \
+                                           -cmp 12 -subcmp 12 -s 128x64      \
+                                           -threads 2
+fate-vsynth%-snow-thread:        DECINOPTS = -threads 2
+
 FATE_VCODEC-$(call ENCDEC, SVQ1, MOV)   += svq1
 fate-vsynth%-svq1:               ENCOPTS = -qscale 3 -pix_fmt yuv410p
 fate-vsynth%-svq1:               FMT     = mov
@@ -466,7 +472,8 @@ FATE_VSYNTH2 = $(FATE_VCODEC:%=fate-vsynth2-%)
 FATE_VSYNTH_LENA = $(FATE_VCODEC:%=fate-vsynth_lena-%)
 # Redundant tests because they just resize the input
 RESIZE_OFF   = dnxhd-720p dnxhd-720p-rd dnxhd-720p-10bit dnxhd-1080i \
-               dv dv-411 dv-50 avui snow snow-hpel snow-ll vc2-420p \
+               dv dv-411 dv-50 avui snow snow-hpel snow-ll snow-thread \
+               vc2-420p \
                vc2-420p10 vc2-420p12 vc2-422p vc2-422p10 vc2-422p12 \
                vc2-444p vc2-444p10 vc2-444p12 vc2-thaar vc2-t5_3
 # Incorrect parameters - usually size or color format restrictions
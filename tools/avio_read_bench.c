@@ -0,0 +1,157 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Measure the read throughput of a protocol through AVIOContext with
+ * different sets of protocol options.
+ */
+
+#include "config.h"
+#if HAVE_UNISTD_H
+#include <unistd.h>             /* getopt */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/dict.h"
+#include "libavutil/log.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "libavformat/avio.h"
+
+#if !HAVE_GETOPT
+#include "compat/getopt.c"
+#endif
+
+static const char *const default_configs[] = {
+    "",
+    "read_size=1048576",
+    "read_size=1048576:fadvise=sequential+willneed",
+    "mmap=1",
+    "mmap=1:direct=1",
+};
+
+static void usage(void)
+{
+    printf("Measure the read throughput of an input with several sets of protocol options.\n");
+    printf("Usage: avio_read_bench [OPTIONS] URL [OPTIONS_STRING...]\n");
+    printf("\n"
+           "Options:\n"
+           "-b BYTES       set the size of each avio_read() call, default 16384\n"
+           "-r RUNS        set the number of runs per options string, default 5\n"
+           "-h             print this help\n"
+           "Options strings are key=value pairs separated by ':'; direct=1 opens\n"
+           "the context with AVIO_FLAG_DIRECT. The default strings compare the\n"
+           "plain, large read, fadvise and mmap file protocol modes.\n");
+}
+
+static int bench_config(const char *url, const char *config, uint8_t *buf,
+                        int chunk, int runs)
+{
+    int64_t best = INT64_MAX, size = 0;
+    int i, ret;
+
+    for (i = 0; i < runs; i++) {
+        AVDictionary *opts = NULL;
+        AVDictionaryEntry *e;
+        AVIOContext *pb = NULL;
+        int flags = AVIO_FLAG_READ;
+        int64_t t, bytes = 0;
+
+        if ((ret = av_dict_parse_string(&opts, config, "=", ":", 0)) < 0)
+            return ret;
+        if ((e = av_dict_get(opts, "direct", NULL, 0))) {
+            if (atoi(e->value))
+                flags |= AVIO_FLAG_DIRECT;
+            av_dict_set(&opts, "direct", NULL, 0);
+        }
+
+        t = av_gettime_relative();
+        ret = avio_open2(&pb, url, flags, NULL, &opts);
+        av_dict_free(&opts);
+        if (ret < 0)
+            return ret;
+        while ((ret = avio_read(pb, buf, chunk)) > 0)
+            bytes += ret;
+        t = av_gettime_relative() - t;
+
+        avio_closep(&pb);
+        if (ret < 0 && ret != AVERROR_EOF)
+            return ret;
+
+        size = bytes;
+        best = FFMIN(best, FFMAX(t, 1));
+    }
+
+    printf("%-50s %12"PRId64" bytes %10.1f MB/s\n",
+           *config ? config : "(defaults)", size, size / (double)best);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *url;
+    uint8_t *buf;
+    int chunk = 16384, runs = 5;
+    int i, c, ret = 0;
+
+    av_log_set_level(AV_LOG_ERROR);
+
+    while ((c = getopt(argc, argv, "b:hr:")) != -1) {
+        switch (c) {
+        case 'b':
+            chunk = FFMAX(atoi(optarg), 1);
+            break;
+        case 'h':
+            usage();
+            return 0;
+        case 'r':
+            runs = FFMAX(atoi(optarg), 1);
+            break;
+        case '?':
+            return 1;
+        }
+    }
+
+    if (optind >= argc) {
+        usage();
+        return 1;
+    }
+    url = argv[optind++];
+
+    buf = av_malloc(chunk);
+    if (!buf)
+        return 1;
+
+    if (optind < argc) {
+        for (i = optind; i < argc && ret >= 0; i++)
+            ret = bench_config(url, argv[i], buf, chunk, runs);
+    } else {
+        for (i = 0; i < FF_ARRAY_ELEMS(default_configs) && ret >= 0; i++)
+            ret = bench_config(url, default_configs[i], buf, chunk, runs);
+    }
+
+    av_free(buf);
+
+    if (ret < 0) {
+        fprintf(stderr, "Failed to read %s: %s\n", url, av_err2str(ret));
+        return 1;
+    }
+    return 0;
+}
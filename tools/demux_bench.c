@@ -0,0 +1,175 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Measure the demuxing throughput of a file, optionally keeping only some
+ * of its streams as a player or a remuxer selecting one program would.
+ * Opening the file and probing the streams are not included in the time.
+ */
+
+#include "config.h"
+#if HAVE_UNISTD_H
+#include <unistd.h>             /* getopt */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/dict.h"
+#include "libavutil/log.h"
+#include "libavutil/time.h"
+#include "libavformat/avformat.h"
+
+#if !HAVE_GETOPT
+#include "compat/getopt.c"
+#endif
+
+#define MAX_KEEP 64
+
+static void usage(void)
+{
+    printf("Measure the demuxing throughput of a file.\n");
+    printf("Usage: demux_bench [OPTIONS] FILE\n");
+    printf("\n"
+           "Options:\n"
+           "-f FORMAT      force the input format\n"
+           "-o OPTIONS     set demuxer options, key=value pairs separated by ':'\n"
+           "-p PROGRAM     keep only the streams of the program with this id\n"
+           "-s INDEX       keep only this stream, may be repeated\n"
+           "-r RUNS        set the number of runs, default 5\n"
+           "-h             print this help\n");
+}
+
+static int bench_run(const char *filename, AVInputFormat *fmt, const char *opts_str,
+                     int program_id, const int *keep, int nb_keep,
+                     int64_t *bytes, int64_t *packets, int64_t *time)
+{
+    AVFormatContext *s = NULL;
+    AVDictionary *opts = NULL;
+    AVPacket pkt;
+    int64_t t, start;
+    int i, ret;
+
+    if (opts_str && (ret = av_dict_parse_string(&opts, opts_str, "=", ":", 0)) < 0)
+        return ret;
+
+    ret = avformat_open_input(&s, filename, fmt, &opts);
+    av_dict_free(&opts);
+    if (ret < 0)
+        return ret;
+    if ((ret = avformat_find_stream_info(s, NULL)) < 0) {
+        avformat_close_input(&s);
+        return ret;
+    }
+
+    if (program_id >= 0 || nb_keep) {
+        for (i = 0; i < s->nb_streams; i++)
+            s->streams[i]->discard = AVDISCARD_ALL;
+        for (i = 0; i < s->nb_programs && program_id >= 0; i++) {
+            AVProgram *p = s->programs[i];
+            int j;
+            if (p->id != program_id) {
+                p->discard = AVDISCARD_ALL;
+                continue;
+            }
+            for (j = 0; j < p->nb_stream_indexes; j++)
+                s->streams[p->stream_index[j]]->discard = AVDISCARD_DEFAULT;
+        }
+        for (i = 0; i < nb_keep; i++)
+            if (keep[i] < s->nb_streams)
+                s->streams[keep[i]]->discard = AVDISCARD_DEFAULT;
+    }
+
+    /* only the packet reading loop is timed */
+    t = av_gettime_relative();
+    start = avio_tell(s->pb);
+    *packets = 0;
+    while ((ret = av_read_frame(s, &pkt)) >= 0) {
+        (*packets)++;
+        av_packet_unref(&pkt);
+    }
+    *time  = FFMAX(av_gettime_relative() - t, 1);
+    *bytes = avio_tell(s->pb) - start;
+
+    avformat_close_input(&s);
+
+    return ret == AVERROR_EOF ? 0 : ret;
+}
+
+int main(int argc, char **argv)
+{
+    AVInputFormat *fmt = NULL;
+    const char *opts = NULL;
+    int keep[MAX_KEEP], nb_keep = 0;
+    int program_id = -1, runs = 5;
+    int64_t best = INT64_MAX, bytes = 0, packets = 0;
+    int i, c, ret = 0;
+
+    av_log_set_level(AV_LOG_ERROR);
+
+    while ((c = getopt(argc, argv, "f:ho:p:r:s:")) != -1) {
+        switch (c) {
+        case 'f':
+            if (!(fmt = av_find_input_format(optarg))) {
+                fprintf(stderr, "Unknown input format %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'h':
+            usage();
+            return 0;
+        case 'o':
+            opts = optarg;
+            break;
+        case 'p':
+            program_id = atoi(optarg);
+            break;
+        case 'r':
+            runs = FFMAX(atoi(optarg), 1);
+            break;
+        case 's':
+            if (nb_keep < MAX_KEEP)
+                keep[nb_keep++] = atoi(optarg);
+            break;
+        case '?':
+            return 1;
+        }
+    }
+
+    if (optind >= argc) {
+        usage();
+        return 1;
+    }
+
+    for (i = 0; i < runs && ret >= 0; i++) {
+        int64_t t;
+        ret = bench_run(argv[optind], fmt, opts, program_id, keep, nb_keep,
+                        &bytes, &packets, &t);
+        best = FFMIN(best, t);
+    }
+
+    if (ret < 0) {
+        fprintf(stderr, "Failed to demux %s: %s\n", argv[optind], av_err2str(ret));
+        return 1;
+    }
+
+    printf("%"PRId64" bytes, %"PRId64" packets in %.3f ms: %.1f MB/s, %.0f packets/s\n",
+           bytes, packets, best / 1000.0, bytes / (double)best,
+           packets * 1000000.0 / best);
+    return 0;
+}
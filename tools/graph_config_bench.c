@@ -0,0 +1,148 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Measure the time taken by avfilter_graph_config() for linear video
+ * filtergraphs of increasing size.
+ */
+
+#include "config.h"
+#if HAVE_UNISTD_H
+#include <unistd.h>             /* getopt */
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/bprint.h"
+#include "libavutil/log.h"
+#include "libavutil/time.h"
+#include "libavfilter/avfilter.h"
+
+#if !HAVE_GETOPT
+#include "compat/getopt.c"
+#endif
+
+/* a mix of filters accepting any format and filters forcing a conversion,
+ * so that format lists are both merged and auto-scale filters inserted */
+static const char *const chain[] = {
+    "null", "hflip", "format=yuv420p|yuv444p", "vflip",
+    "null", "format=rgb24|bgr24", "hflip", "format=gray",
+};
+
+static void usage(void)
+{
+    printf("Measure filtergraph configuration time against graph size.\n");
+    printf("Usage: graph_config_bench [OPTIONS] [SIZE...]\n");
+    printf("\n"
+           "Options:\n"
+           "-r RUNS        set the number of runs per size, default 10\n"
+           "-h             print this help\n"
+           "Sizes default to 10 50 100 250 500 filters.\n");
+}
+
+static int build_graph(AVBPrint *bp, int size)
+{
+    int i;
+
+    av_bprint_clear(bp);
+    av_bprintf(bp, "nullsrc=s=64x64");
+    for (i = 0; i < size; i++)
+        av_bprintf(bp, ",%s", chain[i % FF_ARRAY_ELEMS(chain)]);
+    av_bprintf(bp, ",nullsink");
+
+    return av_bprint_is_complete(bp) ? 0 : AVERROR(ENOMEM);
+}
+
+static int bench_size(AVBPrint *bp, int size, int runs)
+{
+    int64_t total = 0, best = INT64_MAX;
+    int i, ret, nb_filters = 0;
+
+    if ((ret = build_graph(bp, size)) < 0)
+        return ret;
+
+    for (i = 0; i < runs; i++) {
+        AVFilterGraph *graph = avfilter_graph_alloc();
+        int64_t t;
+
+        if (!graph)
+            return AVERROR(ENOMEM);
+        if ((ret = avfilter_graph_parse_ptr(graph, bp->str, NULL, NULL, NULL)) < 0) {
+            avfilter_graph_free(&graph);
+            return ret;
+        }
+
+        t = av_gettime_relative();
+        ret = avfilter_graph_config(graph, NULL);
+        t = av_gettime_relative() - t;
+
+        nb_filters = graph->nb_filters;
+        avfilter_graph_free(&graph);
+        if (ret < 0)
+            return ret;
+
+        total += t;
+        best   = FFMIN(best, t);
+    }
+
+    printf("%6d filters (%6d after conversion): avg %10.3f ms, best %10.3f ms\n",
+           size, nb_filters, total / 1000.0 / runs, best / 1000.0);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    static const int default_sizes[] = { 10, 50, 100, 250, 500 };
+    AVBPrint bp;
+    int runs = 10;
+    int i, c, ret = 0;
+
+    av_log_set_level(AV_LOG_ERROR);
+
+    while ((c = getopt(argc, argv, "hr:")) != -1) {
+        switch (c) {
+        case 'h':
+            usage();
+            return 0;
+        case 'r':
+            runs = FFMAX(atoi(optarg), 1);
+            break;
+        case '?':
+            return 1;
+        }
+    }
+
+    av_bprint_init(&bp, 0, AV_BPRINT_SIZE_UNLIMITED);
+
+    if (optind < argc) {
+        for (i = optind; i < argc && ret >= 0; i++)
+            ret = bench_size(&bp, FFMAX(atoi(argv[i]), 1), runs);
+    } else {
+        for (i = 0; i < FF_ARRAY_ELEMS(default_sizes) && ret >= 0; i++)
+            ret = bench_size(&bp, default_sizes[i], runs);
+    }
+
+    av_bprint_finalize(&bp, NULL);
+
+    if (ret < 0) {
+        fprintf(stderr, "Failed to configure the graph: %s\n", av_err2str(ret));
+        return 1;
+    }
+    return 0;
+}